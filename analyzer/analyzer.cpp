@@ -0,0 +1,186 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../memtracer/include/snapshot_file.h"
+#include "../memtracer/include/snapshot_index.h"
+
+namespace
+{
+    constexpr size_t DEFAULT_RESULT_COUNT = 20;
+
+    const char* const USAGE =
+        "usage : analyzer <snapshot file> [command]\n"
+        "commands :\n"
+        "  top [-n N]                 functions with most live bytes beneath them\n"
+        "  beneath <pattern>          live bytes of stacks which pass through matching functions\n"
+        "  callers [-n N] <pattern>   direct callers of matching functions\n"
+        "  callees [-n N] <pattern>   direct callees of matching functions\n"
+        "  sites [-n N] <pattern>     functions whose symbol or file name matches\n"
+        "pattern is a substring of symbol name. without command, commands are read from stdin until quit.\n";
+
+    void print_size(const memtracer::SnapshotIndex::FunctionStatistics& function_statistics)
+    {
+        std::printf("%10.2f MB %10llu times", static_cast<double>(function_statistics.memory_allocation_) / 1024.0 / 1024.0
+            , static_cast<unsigned long long>(function_statistics.memory_allocation_count_));
+    }
+
+    void print_functions(const memtracer::SnapshotIndex& snapshot_index, const std::vector<memtracer::SnapshotIndex::FunctionStatistics>& function_statistics)
+    {
+        for (const memtracer::SnapshotIndex::FunctionStatistics& statistics : function_statistics)
+        {
+            print_size(statistics);
+
+            std::printf("  %s\n", snapshot_index.get_function_name(statistics.function_).c_str());
+        }
+    }
+
+    // "<command> [-n N] [pattern]". pattern is rest of line, so it can have spaces. (e.g. "operator new")
+    bool run_command(const memtracer::SnapshotIndex& snapshot_index, const std::string& line)
+    {
+        std::istringstream stream(line);
+
+        std::string command;
+
+        stream >> command;
+
+        size_t count = DEFAULT_RESULT_COUNT;
+
+        std::string pattern;
+
+        stream >> std::ws;
+
+        if (stream.peek() == '-')
+        {
+            std::string option;
+
+            stream >> option >> count;
+
+            if (option != "-n" || stream.fail() == true)
+            {
+                std::cerr << "Unknown option." << std::endl;
+
+                return false;
+            }
+
+            stream >> std::ws;
+        }
+
+        std::getline(stream, pattern);
+
+        const auto begin = std::chrono::steady_clock::now();
+
+        if (command == "top")
+        {
+            std::vector<uint32_t> functions(snapshot_index.get_function_count());
+
+            for (uint32_t i = 0; i < functions.size(); i++)
+            {
+                functions[i] = i;
+            }
+
+            print_functions(snapshot_index, snapshot_index.get_top_functions(functions, count));
+        }
+        else if (command == "beneath" || command == "callers" || command == "callees" || command == "sites")
+        {
+            if (pattern.empty() == true)
+            {
+                std::cerr << "Pattern is needed." << std::endl;
+
+                return false;
+            }
+
+            const std::vector<uint32_t> functions = snapshot_index.find_functions(pattern, command == "sites");
+
+            std::printf("%zu functions match.\n", functions.size());
+
+            if (command == "beneath")
+            {
+                print_size(snapshot_index.get_beneath(functions));
+
+                std::printf("\n");
+            }
+            else if (command == "sites")
+            {
+                print_functions(snapshot_index, snapshot_index.get_top_functions(functions, count));
+            }
+            else
+            {
+                print_functions(snapshot_index, snapshot_index.get_neighbors(functions, command == "callers", count));
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown command." << std::endl << USAGE;
+
+            return false;
+        }
+
+        std::printf("(%.3f ms)\n", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+
+        return true;
+    }
+}
+
+#if defined(_WIN32) && defined(_UNICODE)
+int wmain(int argc, wchar_t* argv[])
+#else
+int main(int argc, char* argv[])
+#endif
+{
+    if (argc < 2)
+    {
+        std::cerr << USAGE;
+
+        return 1;
+    }
+
+    const tstring snapshot_path = argv[1];
+
+    const auto begin = std::chrono::steady_clock::now();
+
+    memtracer::SnapshotFile snapshot_file;
+
+    if (snapshot_file.open(snapshot_path.c_str()) == false)
+    {
+        std::cerr << "Failed to open snapshot file." << std::endl;
+
+        return 1;
+    }
+
+    memtracer::SnapshotIndex snapshot_index;
+
+    snapshot_index.build(snapshot_file);
+
+    std::fprintf(stderr, "%llu stacks, %zu functions indexed in %.3f ms.\n"
+        , static_cast<unsigned long long>(snapshot_file.get_header().stack_count_), snapshot_index.get_function_count()
+        , std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+
+    if (argc > 2)
+    {
+        std::string line;
+
+        for (int i = 2; i < argc; i++)
+        {
+            line += i == 2 ? "" : " ";
+
+            line += memtracer::convert_to_utf8(argv[i]);
+        }
+
+        return run_command(snapshot_index, line) == true ? 0 : 1;
+    }
+
+    std::string line;
+
+    while (std::getline(std::cin, line) && line != "quit")
+    {
+        if (line.empty() == false)
+        {
+            run_command(snapshot_index, line);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,468 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../memtracer/include/memory_tracer_operators.h"
+
+#ifndef _WIN32
+#include <ctime>
+#endif
+
+#ifdef _MSC_VER
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+// every result is one csv record : benchmark,parameter,metric,value,unit
+namespace
+{
+    constexpr size_t DEFAULT_ITERATIONS_PER_THREAD = 200000;
+
+    // tcmalloc's default sampling interval.
+    constexpr size_t SAMPLING_INTERVAL = 512 * 1024;
+
+    constexpr size_t LATENCY_SIZES[] = { 16, 256, 4096, 65536 };
+
+    constexpr int IDLE_MILLISECONDS = 1000;
+
+    constexpr int WAKEUP_SAMPLES = 100;
+
+    // longer than tracer thread's spin, so every sample wakes a parked tracer thread.
+    constexpr int WAKEUP_INTERVAL_MILLISECONDS = 10;
+
+    // 4 ^ depth distinct call stacks.
+    constexpr int SNAPSHOT_STACK_DEPTHS[] = { 4, 5, 6, 7 };
+
+    // keeps compiler from eliding new / delete pairs.
+    void* volatile sink = nullptr;
+
+    void print_result(const char* benchmark, const std::string& parameter, const char* metric, double value, const char* unit)
+    {
+        std::printf("%s,%s,%s,%.3f,%s\n", benchmark, parameter.c_str(), metric, value, unit);
+    }
+
+    double get_seconds(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+    {
+        return std::chrono::duration<double>(end - begin).count();
+    }
+
+    double get_microseconds(memtracer::Timestamp duration)
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::duration(static_cast<std::chrono::steady_clock::rep>(duration))).count();
+    }
+
+    // cpu time of all threads of this process.
+    double get_process_cpu_seconds()
+    {
+#ifdef _WIN32
+        FILETIME creation_time, exit_time, kernel_time, user_time;
+
+        GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time, &kernel_time, &user_time);
+
+        const auto to_seconds = [](const FILETIME& file_time)
+            {
+                return static_cast<double>((static_cast<unsigned long long>(file_time.dwHighDateTime) << 32) | file_time.dwLowDateTime) * 1e-7;
+            };
+
+        return to_seconds(kernel_time) + to_seconds(user_time);
+#else
+        timespec cpu_time;
+
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_time);
+
+        return static_cast<double>(cpu_time.tv_sec) + static_cast<double>(cpu_time.tv_nsec) * 1e-9;
+#endif
+    }
+
+    void run_producer(size_t iterations)
+    {
+        for (size_t i = 0; i < iterations; i++)
+        {
+            int* value = new int(static_cast<int>(i));
+
+            sink = value;
+
+            delete value;
+        }
+    }
+
+    // sizes cycle through 16 bytes ~ 4 KB.
+    void run_mixed_size_producer(size_t iterations)
+    {
+        for (size_t i = 0; i < iterations; i++)
+        {
+            char* value = new char[16ull << (i % 9)];
+
+            sink = value;
+
+            delete[] value;
+        }
+    }
+
+    // cost that add_allocation / remove_allocation add over raw malloc / free. single thread.
+    void run_latency_benchmark(size_t iterations)
+    {
+        memtracer::MemoryTracer<>* memory_tracer = memtracer::MemoryTracer<>::get_instance();
+
+        for (size_t size : LATENCY_SIZES)
+        {
+            const std::string parameter = std::to_string(size) + "B";
+
+            auto begin = std::chrono::steady_clock::now();
+
+            for (size_t i = 0; i < iterations; i++)
+            {
+                void* block = std::malloc(size);
+
+                sink = block;
+
+                std::free(block);
+            }
+
+            const double raw_nanoseconds = get_seconds(begin, std::chrono::steady_clock::now()) * 1e9 / static_cast<double>(iterations);
+
+            memory_tracer->start();
+
+            begin = std::chrono::steady_clock::now();
+
+            for (size_t i = 0; i < iterations; i++)
+            {
+                void* block = memory_tracer->add_allocation(size);
+
+                sink = block;
+
+                memory_tracer->remove_allocation(block);
+            }
+
+            const double traced_nanoseconds = get_seconds(begin, std::chrono::steady_clock::now()) * 1e9 / static_cast<double>(iterations);
+
+            memory_tracer->stop();
+
+            print_result("latency", parameter, "raw", raw_nanoseconds, "ns/pair");
+
+            print_result("latency", parameter, "traced", traced_nanoseconds, "ns/pair");
+
+            print_result("latency", parameter, "added", traced_nanoseconds - raw_nanoseconds, "ns/pair");
+        }
+    }
+
+    // events/sec with 1..max_threads producers. one new + one delete is two events.
+    // a monitor thread samples tracer thread's lag while producers run.
+    void run_scaling_benchmark(size_t max_threads, size_t iterations)
+    {
+        memtracer::MemoryTracer<>* memory_tracer = memtracer::MemoryTracer<>::get_instance();
+
+        for (size_t thread_count = 1; ; thread_count *= 2)
+        {
+            thread_count = (std::min)(thread_count, max_threads);
+
+            const std::string parameter = std::to_string(thread_count) + "threads";
+
+            std::vector<std::thread> producers;
+
+            producers.reserve(thread_count);
+
+            memory_tracer->start();
+
+            std::atomic<bool> is_producing(true);
+
+            double lag_sum = 0.0;
+
+            double lag_max = 0.0;
+
+            size_t lag_samples = 0;
+
+            std::thread monitor([memory_tracer, &is_producing, &lag_sum, &lag_max, &lag_samples]()
+                {
+                    const memtracer::Timestamp begin = memtracer::get_timestamp();
+
+                    while (is_producing.load() == true)
+                    {
+                        const memtracer::TracerStatistics tracer_statistics = memory_tracer->get_tracer_statistics();
+
+                        const memtracer::Timestamp applied = (std::max)(tracer_statistics.applied_timestamp_, begin);
+
+                        const memtracer::Timestamp now = memtracer::get_timestamp();
+
+                        const double lag = get_microseconds(now > applied ? now - applied : 0);
+
+                        lag_sum += lag;
+
+                        lag_max = (std::max)(lag_max, lag);
+
+                        lag_samples++;
+
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                });
+
+            const auto begin = std::chrono::steady_clock::now();
+
+            for (size_t i = 0; i < thread_count; i++)
+            {
+                producers.emplace_back(run_producer, iterations);
+            }
+
+            for (std::thread& producer : producers)
+            {
+                producer.join();
+            }
+
+            const auto produced = std::chrono::steady_clock::now();
+
+            const size_t applied_while_producing = memory_tracer->get_tracer_statistics().applied_operation_count_;
+
+            is_producing = false;
+
+            monitor.join();
+
+            // stop returns after tracer thread applied every event published before it.
+            memory_tracer->stop();
+
+            const auto drained = std::chrono::steady_clock::now();
+
+            const size_t events = thread_count * iterations * 2;
+
+            const double events_per_second = static_cast<double>(events) / get_seconds(begin, drained);
+
+            print_result("scaling", parameter, "events", static_cast<double>(events), "events");
+
+            print_result("scaling", parameter, "produce", get_seconds(begin, produced), "s");
+
+            print_result("scaling", parameter, "drain_after_produce", get_seconds(produced, drained), "s");
+
+            print_result("scaling", parameter, "throughput", events_per_second, "events/s");
+
+            print_result("scaling", parameter, "throughput_per_thread", events_per_second / static_cast<double>(thread_count), "events/s");
+
+            print_result("scaling", parameter, "drain_rate", static_cast<double>(applied_while_producing) / get_seconds(begin, produced), "events/s");
+
+            print_result("scaling", parameter, "lag_mean", lag_samples != 0 ? lag_sum / static_cast<double>(lag_samples) : 0.0, "us");
+
+            print_result("scaling", parameter, "lag_max", lag_max, "us");
+
+            if (thread_count == max_threads)
+            {
+                break;
+            }
+        }
+    }
+
+    // per new / delete pair cost of full tracing and sampling. single thread.
+    void run_sampling_benchmark(size_t iterations)
+    {
+        double untraced_nanoseconds = 0.0;
+
+        const auto run = [iterations, &untraced_nanoseconds](const char* mode, bool is_in_trace, size_t sampling_interval)
+            {
+                memtracer::MemoryTracer<>::get_instance()->set_sampling_interval(sampling_interval);
+
+                if (is_in_trace == true)
+                {
+                    memtracer::MemoryTracer<>::get_instance()->start();
+                }
+
+                const auto begin = std::chrono::steady_clock::now();
+
+                run_mixed_size_producer(iterations);
+
+                const auto end = std::chrono::steady_clock::now();
+
+                if (is_in_trace == true)
+                {
+                    memtracer::MemoryTracer<>::get_instance()->stop();
+                }
+
+                const double nanoseconds = get_seconds(begin, end) * 1e9 / static_cast<double>(iterations);
+
+                if (is_in_trace == false)
+                {
+                    untraced_nanoseconds = nanoseconds;
+                }
+
+                print_result("sampling", mode, "latency", nanoseconds, "ns/pair");
+
+                print_result("sampling", mode, "overhead", nanoseconds / untraced_nanoseconds, "x");
+            };
+
+        run("untraced", false, 0);
+
+        run("full", true, 0);
+
+        run("sampled_512KB", true, SAMPLING_INTERVAL);
+
+        memtracer::MemoryTracer<>::get_instance()->set_sampling_interval(0);
+    }
+
+    // cpu used by tracer thread while nothing is allocated, and time until it applies an allocation after idle.
+    void run_idle_benchmark()
+    {
+        memtracer::MemoryTracer<>* memory_tracer = memtracer::MemoryTracer<>::get_instance();
+
+        memory_tracer->start();
+
+        const double cpu_begin = get_process_cpu_seconds();
+
+        const auto begin = std::chrono::steady_clock::now();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(IDLE_MILLISECONDS));
+
+        const double cpu_seconds = get_process_cpu_seconds() - cpu_begin;
+
+        print_result("idle", "tracer", "cpu", cpu_seconds * 100.0 / get_seconds(begin, std::chrono::steady_clock::now()), "%core");
+
+        double latency_sum = 0.0;
+
+        double latency_max = 0.0;
+
+        for (int i = 0; i < WAKEUP_SAMPLES; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(WAKEUP_INTERVAL_MILLISECONDS));
+
+            const size_t applied_operation_count = memory_tracer->get_tracer_statistics().applied_operation_count_;
+
+            const auto published = std::chrono::steady_clock::now();
+
+            void* block = memory_tracer->add_allocation(16);
+
+            sink = block;
+
+            while (memory_tracer->get_tracer_statistics().applied_operation_count_ == applied_operation_count)
+            {
+                std::this_thread::yield();
+            }
+
+            const double latency = get_seconds(published, std::chrono::steady_clock::now()) * 1e6;
+
+            latency_sum += latency;
+
+            latency_max = (std::max)(latency_max, latency);
+
+            memory_tracer->remove_allocation(block);
+        }
+
+        memory_tracer->stop();
+
+        print_result("idle", "wakeup", "latency_mean", latency_sum / WAKEUP_SAMPLES, "us");
+
+        print_result("idle", "wakeup", "latency_max", latency_max, "us");
+    }
+
+    void descend(int depth, unsigned int path, std::vector<char*>& blocks);
+
+    // each branch is a distinct return address, so each path of branches is a distinct call stack.
+    template <unsigned int Branch>
+    BENCH_NOINLINE void branch(int depth, unsigned int path, std::vector<char*>& blocks)
+    {
+        descend(depth - 1, path >> 2, blocks);
+
+        // not a tail call. Branch keeps instances from being folded into one function.
+        sink = &blocks[0] + Branch;
+    }
+
+    BENCH_NOINLINE void descend(int depth, unsigned int path, std::vector<char*>& blocks)
+    {
+        if (depth == 0)
+        {
+            blocks.push_back(new char[16]);
+
+            return;
+        }
+
+        switch (path & 3)
+        {
+        case 0: branch<0>(depth, path, blocks); break;
+        case 1: branch<1>(depth, path, blocks); break;
+        case 2: branch<2>(depth, path, blocks); break;
+        default: branch<3>(depth, path, blocks); break;
+        }
+    }
+
+    // snapshot latency by number of live call stacks. second snapshot reuses resolved symbols.
+    void run_snapshot_benchmark()
+    {
+        memtracer::MemoryTracer<>* memory_tracer = memtracer::MemoryTracer<>::get_instance();
+
+        for (int depth : SNAPSHOT_STACK_DEPTHS)
+        {
+            const unsigned int stack_count = 1u << (depth * 2);
+
+            const std::string parameter = std::to_string(stack_count) + "stacks";
+
+            std::vector<char*> blocks;
+
+            blocks.reserve(stack_count);
+
+            memory_tracer->start();
+
+            for (unsigned int path = 0; path < stack_count; path++)
+            {
+                descend(depth, path, blocks);
+            }
+
+            auto begin = std::chrono::steady_clock::now();
+
+            memory_tracer->take_snapshot().wait();
+
+            const double first_seconds = get_seconds(begin, std::chrono::steady_clock::now());
+
+            begin = std::chrono::steady_clock::now();
+
+            memory_tracer->take_snapshot().wait();
+
+            const double second_seconds = get_seconds(begin, std::chrono::steady_clock::now());
+
+            for (char* block : blocks)
+            {
+                delete[] block;
+            }
+
+            memory_tracer->stop();
+
+            print_result("snapshot", parameter, "first", first_seconds * 1e3, "ms");
+
+            print_result("snapshot", parameter, "cached_symbols", second_seconds * 1e3, "ms");
+        }
+    }
+}
+
+// usage : bench [max threads] [iterations per thread] [tracer threads]
+// prints csv. (benchmark,parameter,metric,value,unit)
+int main(int argc, char* argv[])
+{
+    size_t max_threads = (std::max)(std::thread::hardware_concurrency(), 1u);
+
+    size_t iterations = DEFAULT_ITERATIONS_PER_THREAD;
+
+    if (argc > 1)
+    {
+        max_threads = (std::max)(std::stoul(argv[1]), 1ul);
+    }
+
+    if (argc > 2)
+    {
+        iterations = std::stoul(argv[2]);
+    }
+
+    if (argc > 3)
+    {
+        memtracer::MemoryTracer<>::get_instance()->set_tracer_thread_count(static_cast<unsigned int>(std::stoul(argv[3])));
+    }
+
+    std::printf("benchmark,parameter,metric,value,unit\n");
+
+    run_latency_benchmark(iterations);
+
+    run_scaling_benchmark(max_threads, iterations);
+
+    run_sampling_benchmark(iterations);
+
+    run_idle_benchmark();
+
+    run_snapshot_benchmark();
+}
@@ -0,0 +1,834 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../memtracer/include/calling_context_tree.h"
+#include "../memtracer/include/file_writer.h"
+#include "../memtracer/include/snapshot_file.h"
+
+#ifdef MEMTRACER_HAS_RAPIDJSON
+#include <rapidjson/writer.h>
+#endif
+
+namespace
+{
+    bool is_diff_snapshot(const memtracer::SnapshotFile& snapshot_file)
+    {
+        return snapshot_file.get_header().snapshot_type_ == memtracer::SNAPSHOT_FILE_TYPE_DIFF;
+    }
+
+    // stacks of full snapshot are sorted by live bytes, stacks of diff snapshot by growth.
+    std::vector<size_t> get_sorted_stacks(const memtracer::SnapshotFile& snapshot_file)
+    {
+        std::vector<size_t> stacks(static_cast<size_t>(snapshot_file.get_header().stack_count_));
+
+        for (size_t i = 0; i < stacks.size(); i++)
+        {
+            stacks[i] = i;
+        }
+
+        if (is_diff_snapshot(snapshot_file) == true)
+        {
+            std::stable_sort(stacks.begin(), stacks.end(), [&snapshot_file](size_t first, size_t second)
+                {
+                    return snapshot_file.get_stack(first).memory_allocation_delta_ > snapshot_file.get_stack(second).memory_allocation_delta_;
+                });
+        }
+        else
+        {
+            std::stable_sort(stacks.begin(), stacks.end(), [&snapshot_file](size_t first, size_t second)
+                {
+                    return snapshot_file.get_stack(first).memory_allocation_ > snapshot_file.get_stack(second).memory_allocation_;
+                });
+        }
+
+        return stacks;
+    }
+
+    const char* get_buffer_policy_name(uint32_t buffer_policy)
+    {
+        switch (buffer_policy)
+        {
+        case memtracer::SNAPSHOT_FILE_BUFFER_POLICY_DROP_AND_COUNT: return "drop-and-count";
+        case memtracer::SNAPSHOT_FILE_BUFFER_POLICY_DEGRADE: return "degrade";
+        default: return "block";
+        }
+    }
+
+    const char* get_trigger_name(uint32_t trigger)
+    {
+        switch (trigger)
+        {
+        case memtracer::SNAPSHOT_FILE_TRIGGER_THRESHOLD: return "threshold";
+        case memtracer::SNAPSHOT_FILE_TRIGGER_GROWTH: return "growth";
+        case memtracer::SNAPSHOT_FILE_TRIGGER_PEAK: return "peak";
+        case memtracer::SNAPSHOT_FILE_TRIGGER_INTERVAL: return "interval";
+        default: return "none";
+        }
+    }
+
+    void* get_pointer(uint64_t address)
+    {
+        return reinterpret_cast<void*>(static_cast<uintptr_t>(address));
+    }
+
+    // outermost frame first. same frame lines as reports written by MemoryTracer before the binary format.
+    void write_frames(const memtracer::SnapshotFile& snapshot_file, const memtracer::SnapshotFileStack& stack, memtracer::FileWriter& file_writer)
+    {
+        constexpr size_t buffer_size = 1024;
+
+        char buffer[buffer_size] = { 0 };
+
+        const auto write_line = [&file_writer, &buffer](int length)
+            {
+                file_writer.write(buffer, static_cast<size_t>((std::min)(std::max(length, 0), static_cast<int>(buffer_size) - 1)));
+            };
+
+        // overflow stack of full StackTable.
+        if (stack.frame_count_ == 0)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "Call stack is not recorded.\r\n"));
+
+            return;
+        }
+
+        for (size_t i = stack.frame_count_; i > 0; i--)
+        {
+            const memtracer::SnapshotFileFrame& frame = snapshot_file.get_stack_frame(stack, i - 1);
+
+            if ((frame.flags_ & memtracer::SNAPSHOT_FILE_FRAME_HAS_LINE) != 0)
+            {
+                write_line(std::snprintf(buffer, buffer_size, "%p - %s : %s (%u)\r\n"
+                    , get_pointer(frame.symbol_address_), snapshot_file.get_string(frame.symbol_name_), snapshot_file.get_string(frame.file_name_), frame.line_number_));
+            }
+            else if ((frame.flags_ & memtracer::SNAPSHOT_FILE_FRAME_HAS_SYMBOL) != 0)
+            {
+                write_line(std::snprintf(buffer, buffer_size, "%p - %s : Failed to get file info.\r\n"
+                    , get_pointer(frame.symbol_address_), snapshot_file.get_string(frame.symbol_name_)));
+            }
+            else
+            {
+                write_line(std::snprintf(buffer, buffer_size, "%p : Failed to get symbol info.\r\n", get_pointer(frame.address_)));
+            }
+        }
+    }
+
+    // same text as reports written by MemoryTracer before the binary format.
+    bool write_text(const memtracer::SnapshotFile& snapshot_file, memtracer::FileWriter& file_writer)
+    {
+        constexpr size_t buffer_size = 1024;
+
+        char buffer[buffer_size] = { 0 };
+
+        const auto write_line = [&file_writer, &buffer](int length)
+            {
+                file_writer.write(buffer, static_cast<size_t>((std::min)(std::max(length, 0), static_cast<int>(buffer_size) - 1)));
+            };
+
+        const memtracer::SnapshotFileHeader& header = snapshot_file.get_header();
+
+        if (header.trigger_ != memtracer::SNAPSHOT_FILE_TRIGGER_NONE)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "Taken automatically by %s trigger.\r\n", get_trigger_name(header.trigger_)));
+        }
+
+        if (header.sampling_interval_ != 0)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "Sampled every %llu bytes on average. Sizes and counts are estimates.\r\n"
+                , static_cast<unsigned long long>(header.sampling_interval_)));
+        }
+
+        if (header.overflowed_sample_count_ != 0)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "%llu samples were not traced, because sampled address set was full. Estimates are low.\r\n"
+                , static_cast<unsigned long long>(header.overflowed_sample_count_)));
+        }
+
+        write_line(std::snprintf(buffer, buffer_size, "Buffer policy : %s. Dropped %llu allocations / %llu frees. Degraded %llu allocations.\r\n"
+            , get_buffer_policy_name(header.buffer_policy_)
+            , static_cast<unsigned long long>(header.dropped_allocation_count_)
+            , static_cast<unsigned long long>(header.dropped_free_count_)
+            , static_cast<unsigned long long>(header.degraded_allocation_count_)));
+
+        write_line(std::snprintf(buffer, buffer_size, "Tracer memory : %.2f MB used / %.2f MB mapped.\r\n"
+            , static_cast<double>(header.tracer_used_memory_) / 1024.0 / 1024.0
+            , static_cast<double>(header.tracer_mapped_memory_) / 1024.0 / 1024.0));
+
+        const bool is_diff = is_diff_snapshot(snapshot_file);
+
+        if (is_diff == true && header.baseline_name_ != memtracer::SNAPSHOT_FILE_NO_STRING)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "Changes since baseline \"%s\".\r\n", snapshot_file.get_string(header.baseline_name_)));
+        }
+        else if (is_diff == true)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "Changes since previous snapshot.\r\n"));
+        }
+
+        const bool is_leak = header.snapshot_type_ == memtracer::SNAPSHOT_FILE_TYPE_LEAK;
+
+        if (is_leak == true)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "Live allocations which are not reachable from stacks and data of the program.\r\n"));
+        }
+
+        const std::vector<size_t> stacks = get_sorted_stacks(snapshot_file);
+
+        // full snapshot keeps stacks whose allocations are all freed for their lifetimes. they are not reported.
+        const bool has_live_stack = std::any_of(stacks.begin(), stacks.end(), [&snapshot_file](size_t stack_index)
+            {
+                return snapshot_file.get_stack(stack_index).memory_allocation_count_ != 0;
+            });
+
+        if (stacks.empty() == true || (is_diff == false && has_live_stack == false))
+        {
+            write_line(std::snprintf(buffer, buffer_size, is_diff == true ? "Don't have any changes." : (is_leak == true ? "Don't have any unreachable allocations." : "Don't have any memory allocations.")));
+        }
+
+        for (size_t stack_index : stacks)
+        {
+            const memtracer::SnapshotFileStack& stack = snapshot_file.get_stack(stack_index);
+
+            if (is_diff == false && stack.memory_allocation_count_ == 0)
+            {
+                continue;
+            }
+
+            if (is_diff == true)
+            {
+                write_line(std::snprintf(buffer, buffer_size, "------- %+.2f MB / %+lld times (live %.2f MB / %llu times) -------\r\n"
+                    , static_cast<float>(stack.memory_allocation_delta_) / 1024.0f / 1024.0f
+                    , static_cast<long long>(stack.memory_allocation_count_delta_)
+                    , static_cast<float>(stack.memory_allocation_) / 1024ull / 1024ull
+                    , static_cast<unsigned long long>(stack.memory_allocation_count_)));
+            }
+            else
+            {
+                write_line(std::snprintf(buffer, buffer_size, "------- %.2f MB / %llu times -------\r\n"
+                    , static_cast<float>(stack.memory_allocation_) / 1024ull / 1024ull
+                    , static_cast<unsigned long long>(stack.memory_allocation_count_)));
+            }
+
+            write_frames(snapshot_file, stack, file_writer);
+        }
+
+        return file_writer.close();
+    }
+
+    // one line per calling context. "main;foo;bar 1024" (bytes)
+    bool write_folded(const memtracer::SnapshotFile& snapshot_file, memtracer::FileWriter& file_writer)
+    {
+        memtracer::CallingContextTree calling_context_tree;
+
+        calling_context_tree.build(snapshot_file);
+
+        calling_context_tree.write_folded(file_writer);
+
+        return file_writer.close();
+    }
+
+    // callers and callees of each function.
+    bool write_call_graph(const memtracer::SnapshotFile& snapshot_file, memtracer::FileWriter& file_writer)
+    {
+        memtracer::CallingContextTree calling_context_tree;
+
+        calling_context_tree.build(snapshot_file);
+
+        calling_context_tree.write_call_graph(file_writer);
+
+        return file_writer.close();
+    }
+
+    // call sites ranked by allocation rate and by frees of short lived allocations per second.
+    bool write_churn(const memtracer::SnapshotFile& snapshot_file, memtracer::FileWriter& file_writer)
+    {
+        // lifetimes under 2^20 ns (about 1 ms) are short.
+        constexpr uint32_t short_lifetime_bucket_count = 11;
+
+        constexpr size_t site_count = 50;
+
+        constexpr size_t buffer_size = 1024;
+
+        char buffer[buffer_size] = { 0 };
+
+        const auto write_line = [&file_writer, &buffer](int length)
+            {
+                file_writer.write(buffer, static_cast<size_t>((std::min)(std::max(length, 0), static_cast<int>(buffer_size) - 1)));
+            };
+
+        const memtracer::SnapshotFileHeader& header = snapshot_file.get_header();
+
+        const double traced_seconds = (std::max)(static_cast<double>(header.traced_time_) / 1000000000.0, 1e-9);
+
+        const uint32_t short_bucket_count = (std::min)(short_lifetime_bucket_count, header.lifetime_bucket_count_);
+
+        std::vector<uint64_t> short_lived_counts(static_cast<size_t>(header.stack_count_), 0);
+
+        std::vector<uint64_t> freed_counts(static_cast<size_t>(header.stack_count_), 0);
+
+        for (size_t i = 0; i < short_lived_counts.size(); i++)
+        {
+            const uint64_t* lifetime_buckets = snapshot_file.get_stack_lifetime_buckets(i);
+
+            for (uint32_t bucket = 0; bucket < header.lifetime_bucket_count_; bucket++)
+            {
+                freed_counts[i] += lifetime_buckets[bucket];
+
+                short_lived_counts[i] += bucket < short_bucket_count ? lifetime_buckets[bucket] : 0;
+            }
+        }
+
+        write_line(std::snprintf(buffer, buffer_size, "Traced for %.3f seconds. Short lived is under %.2f ms.\r\n"
+            , traced_seconds, static_cast<double>(memtracer::get_lifetime_bucket_lower_bound(short_bucket_count)) / 1000000.0));
+
+        if (header.sampling_interval_ != 0)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "Sampled every %llu bytes on average. Totals are estimates, lifetimes are of sampled allocations.\r\n"
+                , static_cast<unsigned long long>(header.sampling_interval_)));
+        }
+
+        if (header.overflowed_sample_count_ != 0)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "%llu samples were not traced, because sampled address set was full. Estimates are low.\r\n"
+                , static_cast<unsigned long long>(header.overflowed_sample_count_)));
+        }
+
+        const auto write_sites = [&](const char* title, const std::vector<uint64_t>& keys)
+            {
+                std::vector<size_t> stacks;
+
+                for (size_t i = 0; i < keys.size(); i++)
+                {
+                    if (keys[i] != 0)
+                    {
+                        stacks.push_back(i);
+                    }
+                }
+
+                const auto more_key = [&keys](size_t first, size_t second)
+                    {
+                        return keys[first] != keys[second] ? keys[first] > keys[second] : first < second;
+                    };
+
+                const size_t count = (std::min)(stacks.size(), site_count);
+
+                std::partial_sort(stacks.begin(), stacks.begin() + count, stacks.end(), more_key);
+
+                write_line(std::snprintf(buffer, buffer_size, "\r\n======= %s =======\r\n", title));
+
+                if (count == 0)
+                {
+                    write_line(std::snprintf(buffer, buffer_size, "Don't have any call sites.\r\n"));
+                }
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    const memtracer::SnapshotFileStack& stack = snapshot_file.get_stack(stacks[i]);
+
+                    write_line(std::snprintf(buffer, buffer_size, "------- %.1f allocs/s / %.2f MB/s (total %llu times, freed %llu, short lived %.1f%%, %.1f/s) -------\r\n"
+                        , static_cast<double>(stack.total_allocation_count_) / traced_seconds
+                        , static_cast<double>(stack.total_memory_allocation_) / 1024.0 / 1024.0 / traced_seconds
+                        , static_cast<unsigned long long>(stack.total_allocation_count_)
+                        , static_cast<unsigned long long>(freed_counts[stacks[i]])
+                        , freed_counts[stacks[i]] == 0 ? 0.0 : static_cast<double>(short_lived_counts[stacks[i]]) * 100.0 / static_cast<double>(freed_counts[stacks[i]])
+                        , static_cast<double>(short_lived_counts[stacks[i]]) / traced_seconds));
+
+                    write_frames(snapshot_file, stack, file_writer);
+                }
+            };
+
+        std::vector<uint64_t> total_counts(static_cast<size_t>(header.stack_count_), 0);
+
+        for (size_t i = 0; i < total_counts.size(); i++)
+        {
+            total_counts[i] = snapshot_file.get_stack(i).total_allocation_count_;
+        }
+
+        write_sites("Allocation rate", total_counts);
+
+        write_sites("Short lived frees", short_lived_counts);
+
+        return file_writer.close();
+    }
+
+    // "<= 64 B", "<= 4 KB". last class has no bound.
+    std::string get_size_class_name(uint32_t size_class, uint32_t size_class_count)
+    {
+        const bool is_last = size_class + 1 == size_class_count;
+
+        unsigned long long size = memtracer::get_size_class_upper_bound(is_last == true ? size_class - 1 : size_class);
+
+        const char* unit = "B";
+
+        for (const char* next_unit : { "KB", "MB", "GB", "TB" })
+        {
+            if (size < 1024)
+            {
+                break;
+            }
+
+            size /= 1024;
+
+            unit = next_unit;
+        }
+
+        char buffer[32] = { 0 };
+
+        std::snprintf(buffer, sizeof(buffer), "%s %llu %s", is_last == true ? ">" : "<=", size, unit);
+
+        return buffer;
+    }
+
+    // size class histogram of all call sites, then of call sites which allocate most often.
+    bool write_sizes(const memtracer::SnapshotFile& snapshot_file, memtracer::FileWriter& file_writer)
+    {
+        constexpr size_t site_count = 50;
+
+        constexpr size_t buffer_size = 1024;
+
+        char buffer[buffer_size] = { 0 };
+
+        const auto write_line = [&file_writer, &buffer](int length)
+            {
+                file_writer.write(buffer, static_cast<size_t>((std::min)(std::max(length, 0), static_cast<int>(buffer_size) - 1)));
+            };
+
+        const memtracer::SnapshotFileHeader& header = snapshot_file.get_header();
+
+        const uint32_t size_class_count = header.size_class_count_;
+
+        if (header.sampling_interval_ != 0)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "Sampled every %llu bytes on average. Sizes and counts are estimates.\r\n"
+                , static_cast<unsigned long long>(header.sampling_interval_)));
+        }
+
+        if (header.overflowed_sample_count_ != 0)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "%llu samples were not traced, because sampled address set was full. Estimates are low.\r\n"
+                , static_cast<unsigned long long>(header.overflowed_sample_count_)));
+        }
+
+        const uint64_t* size_classes = snapshot_file.get_size_classes();
+
+        write_line(std::snprintf(buffer, buffer_size, "======= All call sites =======\r\n%12s %12s %14s %14s\r\n", "size", "live MB", "live times", "total times"));
+
+        for (uint32_t size_class = 0; size_class < size_class_count; size_class++)
+        {
+            if (size_classes[size_class_count * 2 + size_class] == 0)
+            {
+                continue;
+            }
+
+            write_line(std::snprintf(buffer, buffer_size, "%12s %12.2f %14llu %14llu\r\n"
+                , get_size_class_name(size_class, size_class_count).c_str()
+                , static_cast<double>(size_classes[size_class]) / 1024.0 / 1024.0
+                , static_cast<unsigned long long>(size_classes[size_class_count + size_class])
+                , static_cast<unsigned long long>(size_classes[size_class_count * 2 + size_class])));
+        }
+
+        std::vector<size_t> stacks;
+
+        for (size_t i = 0; i < header.stack_count_; i++)
+        {
+            if (snapshot_file.get_stack(i).total_allocation_count_ != 0)
+            {
+                stacks.push_back(i);
+            }
+        }
+
+        const size_t count = (std::min)(stacks.size(), site_count);
+
+        std::partial_sort(stacks.begin(), stacks.begin() + count, stacks.end(), [&snapshot_file](size_t first, size_t second)
+            {
+                const uint64_t first_count = snapshot_file.get_stack(first).total_allocation_count_;
+
+                const uint64_t second_count = snapshot_file.get_stack(second).total_allocation_count_;
+
+                return first_count != second_count ? first_count > second_count : first < second;
+            });
+
+        write_line(std::snprintf(buffer, buffer_size, "\r\n======= Call sites by allocation count =======\r\n"));
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const memtracer::SnapshotFileStack& stack = snapshot_file.get_stack(stacks[i]);
+
+            const uint64_t* stack_size_classes = snapshot_file.get_stack_size_classes(stacks[i]);
+
+            write_line(std::snprintf(buffer, buffer_size, "------- total %.2f MB / %llu times (live %.2f MB / %llu times) -------\r\n"
+                , static_cast<double>(stack.total_memory_allocation_) / 1024.0 / 1024.0
+                , static_cast<unsigned long long>(stack.total_allocation_count_)
+                , static_cast<double>(stack.memory_allocation_) / 1024.0 / 1024.0
+                , static_cast<unsigned long long>(stack.memory_allocation_count_)));
+
+            for (uint32_t size_class = 0; size_class < size_class_count; size_class++)
+            {
+                if (stack_size_classes[size_class_count + size_class] != 0)
+                {
+                    write_line(std::snprintf(buffer, buffer_size, "%12s : live %llu / total %llu times\r\n"
+                        , get_size_class_name(size_class, size_class_count).c_str()
+                        , static_cast<unsigned long long>(stack_size_classes[size_class])
+                        , static_cast<unsigned long long>(stack_size_classes[size_class_count + size_class])));
+                }
+            }
+
+            write_frames(snapshot_file, stack, file_writer);
+        }
+
+        return file_writer.close();
+    }
+
+#ifdef MEMTRACER_HAS_RAPIDJSON
+    const char* get_snapshot_type_name(uint32_t snapshot_type)
+    {
+        switch (snapshot_type)
+        {
+        case memtracer::SNAPSHOT_FILE_TYPE_DIFF: return "diff";
+        case memtracer::SNAPSHOT_FILE_TYPE_LEAK: return "leak";
+        default: return "full";
+        }
+    }
+
+    // rapidjson output stream on top of FileWriter.
+    class JsonOutputStream
+    {
+    public:
+        typedef char Ch;
+
+        explicit JsonOutputStream(memtracer::FileWriter& file_writer) :
+            file_writer_(file_writer)
+        {
+        }
+
+        void Put(Ch character)
+        {
+            file_writer_.write(&character, 1);
+        }
+
+        void Flush()
+        {
+        }
+
+    private:
+        memtracer::FileWriter& file_writer_;
+    };
+
+    // addresses are strings. JSON numbers lose precision above 2^53.
+    void write_json_address(rapidjson::Writer<JsonOutputStream>& writer, uint64_t address)
+    {
+        char buffer[32] = { 0 };
+
+        const int length = std::snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(address));
+
+        writer.String(buffer, static_cast<rapidjson::SizeType>(length));
+    }
+
+    bool write_json(const memtracer::SnapshotFile& snapshot_file, memtracer::FileWriter& file_writer)
+    {
+        JsonOutputStream output_stream(file_writer);
+
+        rapidjson::Writer<JsonOutputStream> writer(output_stream);
+
+        const memtracer::SnapshotFileHeader& header = snapshot_file.get_header();
+
+        writer.StartObject();
+
+        writer.Key("version");
+        writer.Uint(header.version_);
+
+        writer.Key("snapshot_index");
+        writer.Uint64(header.snapshot_index_);
+
+        writer.Key("snapshot_type");
+        writer.String(get_snapshot_type_name(header.snapshot_type_));
+
+        writer.Key("trigger");
+        writer.String(get_trigger_name(header.trigger_));
+
+        writer.Key("sampling_interval");
+        writer.Uint64(header.sampling_interval_);
+
+        writer.Key("buffer_policy");
+        writer.String(get_buffer_policy_name(header.buffer_policy_));
+
+        writer.Key("dropped_allocations");
+        writer.Uint64(header.dropped_allocation_count_);
+
+        writer.Key("dropped_frees");
+        writer.Uint64(header.dropped_free_count_);
+
+        writer.Key("degraded_allocations");
+        writer.Uint64(header.degraded_allocation_count_);
+
+        writer.Key("overflowed_samples");
+        writer.Uint64(header.overflowed_sample_count_);
+
+        writer.Key("traced_time_ns");
+        writer.Uint64(header.traced_time_);
+
+        writer.Key("tracer_used_memory");
+        writer.Uint64(header.tracer_used_memory_);
+
+        writer.Key("tracer_mapped_memory");
+        writer.Uint64(header.tracer_mapped_memory_);
+
+        // live bytes, live counts and total counts of all stacks. class 0 is up to 16 bytes, class i is (2^(i + 3), 2^(i + 4)] bytes.
+        const uint64_t* size_classes = snapshot_file.get_size_classes();
+
+        writer.Key("size_classes");
+        writer.StartObject();
+
+        const char* const size_class_keys[] = { "live_bytes", "live_count", "total_count" };
+
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            writer.Key(size_class_keys[i]);
+            writer.StartArray();
+
+            for (uint32_t size_class = 0; size_class < header.size_class_count_; size_class++)
+            {
+                writer.Uint64(size_classes[header.size_class_count_ * i + size_class]);
+            }
+
+            writer.EndArray();
+        }
+
+        writer.EndObject();
+
+        writer.Key("type");
+        writer.String(is_diff_snapshot(snapshot_file) == true ? "diff" : "full");
+
+        if (header.baseline_name_ != memtracer::SNAPSHOT_FILE_NO_STRING)
+        {
+            writer.Key("baseline");
+            writer.String(snapshot_file.get_string(header.baseline_name_));
+        }
+
+        writer.Key("stacks");
+        writer.StartArray();
+
+        for (size_t stack_index : get_sorted_stacks(snapshot_file))
+        {
+            const memtracer::SnapshotFileStack& stack = snapshot_file.get_stack(stack_index);
+
+            writer.StartObject();
+
+            writer.Key("bytes");
+            writer.Uint64(stack.memory_allocation_);
+
+            writer.Key("count");
+            writer.Uint64(stack.memory_allocation_count_);
+
+            writer.Key("bytes_delta");
+            writer.Int64(stack.memory_allocation_delta_);
+
+            writer.Key("count_delta");
+            writer.Int64(stack.memory_allocation_count_delta_);
+
+            writer.Key("total_bytes");
+            writer.Uint64(stack.total_memory_allocation_);
+
+            writer.Key("total_count");
+            writer.Uint64(stack.total_allocation_count_);
+
+            // frees by lifetime. bucket 0 is under 2^10 ns, bucket i is [2^(i + 9), 2^(i + 10)) ns.
+            writer.Key("lifetime_buckets");
+            writer.StartArray();
+
+            const uint64_t* lifetime_buckets = snapshot_file.get_stack_lifetime_buckets(stack_index);
+
+            for (uint32_t bucket = 0; bucket < header.lifetime_bucket_count_; bucket++)
+            {
+                writer.Uint64(lifetime_buckets[bucket]);
+            }
+
+            writer.EndArray();
+
+            const uint64_t* stack_size_classes = snapshot_file.get_stack_size_classes(stack_index);
+
+            writer.Key("size_class_live_counts");
+            writer.StartArray();
+
+            for (uint32_t size_class = 0; size_class < header.size_class_count_; size_class++)
+            {
+                writer.Uint64(stack_size_classes[size_class]);
+            }
+
+            writer.EndArray();
+
+            writer.Key("size_class_total_counts");
+            writer.StartArray();
+
+            for (uint32_t size_class = 0; size_class < header.size_class_count_; size_class++)
+            {
+                writer.Uint64(stack_size_classes[header.size_class_count_ + size_class]);
+            }
+
+            writer.EndArray();
+
+            // outermost frame first, same as text report.
+            writer.Key("frames");
+            writer.StartArray();
+
+            for (size_t i = stack.frame_count_; i > 0; i--)
+            {
+                const memtracer::SnapshotFileFrame& frame = snapshot_file.get_stack_frame(stack, i - 1);
+
+                writer.StartObject();
+
+                writer.Key("address");
+                write_json_address(writer, frame.address_);
+
+                if ((frame.flags_ & memtracer::SNAPSHOT_FILE_FRAME_HAS_SYMBOL) != 0)
+                {
+                    writer.Key("symbol_address");
+                    write_json_address(writer, frame.symbol_address_);
+
+                    writer.Key("symbol");
+                    writer.String(snapshot_file.get_string(frame.symbol_name_));
+                }
+
+                if ((frame.flags_ & memtracer::SNAPSHOT_FILE_FRAME_HAS_LINE) != 0)
+                {
+                    writer.Key("file");
+                    writer.String(snapshot_file.get_string(frame.file_name_));
+
+                    writer.Key("line");
+                    writer.Uint(frame.line_number_);
+                }
+
+                writer.EndObject();
+            }
+
+            writer.EndArray();
+
+            writer.EndObject();
+        }
+
+        writer.EndArray();
+
+        writer.EndObject();
+
+        return file_writer.close();
+    }
+#endif
+}
+
+// usage : converter <snapshot file> [text | json | folded | callgraph | churn | sizes] [output file]
+// output file is <snapshot file>.txt, .json, .folded, .callgraph.txt, .churn.txt or .sizes.txt by default.
+#if defined(_WIN32) && defined(_UNICODE)
+int wmain(int argc, wchar_t* argv[])
+#else
+int main(int argc, char* argv[])
+#endif
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage : converter <snapshot file> [text | json | folded | callgraph | churn | sizes] [output file]" << std::endl;
+
+        return 1;
+    }
+
+    const tstring snapshot_path = argv[1];
+
+    const tstring format = argc > 2 ? argv[2] : TEXT("text");
+
+    if (format != TEXT("text") && format != TEXT("json") && format != TEXT("folded") && format != TEXT("callgraph") && format != TEXT("churn") && format != TEXT("sizes"))
+    {
+        std::cerr << "Unknown output format." << std::endl;
+
+        return 1;
+    }
+
+#ifndef MEMTRACER_HAS_RAPIDJSON
+    if (format == TEXT("json"))
+    {
+        std::cerr << "JSON output needs rapidjson. Rebuild with rapidjson in include path." << std::endl;
+
+        return 1;
+    }
+#endif
+
+    tstring extension = TEXT(".txt");
+
+    if (format == TEXT("json"))
+    {
+        extension = TEXT(".json");
+    }
+    else if (format == TEXT("folded"))
+    {
+        extension = TEXT(".folded");
+    }
+    else if (format == TEXT("callgraph"))
+    {
+        extension = TEXT(".callgraph.txt");
+    }
+    else if (format == TEXT("churn"))
+    {
+        extension = TEXT(".churn.txt");
+    }
+    else if (format == TEXT("sizes"))
+    {
+        extension = TEXT(".sizes.txt");
+    }
+
+    const tstring output_path = argc > 3 ? argv[3] : snapshot_path + extension;
+
+    memtracer::SnapshotFile snapshot_file;
+
+    if (snapshot_file.open(snapshot_path.c_str()) == false)
+    {
+        std::cerr << "Failed to open snapshot file." << std::endl;
+
+        return 1;
+    }
+
+    memtracer::FileWriter file_writer;
+
+    if (file_writer.open(output_path.c_str()) == false)
+    {
+        std::cerr << "Failed to create output file." << std::endl;
+
+        return 1;
+    }
+
+    bool is_written = false;
+
+    if (format == TEXT("folded"))
+    {
+        is_written = write_folded(snapshot_file, file_writer);
+    }
+    else if (format == TEXT("callgraph"))
+    {
+        is_written = write_call_graph(snapshot_file, file_writer);
+    }
+    else if (format == TEXT("churn"))
+    {
+        is_written = write_churn(snapshot_file, file_writer);
+    }
+    else if (format == TEXT("sizes"))
+    {
+        is_written = write_sizes(snapshot_file, file_writer);
+    }
+#ifdef MEMTRACER_HAS_RAPIDJSON
+    else if (format == TEXT("json"))
+    {
+        is_written = write_json(snapshot_file, file_writer);
+    }
+#endif
+    else
+    {
+        is_written = write_text(snapshot_file, file_writer);
+    }
+
+    if (is_written == false)
+    {
+        std::cerr << "Failed to write output file." << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "core_define.h"
+
+namespace memtracer
+{
+	// estimates have this many fraction bits. weights of samples are summed without rounding,
+	// and sums are rounded to bytes and counts by round_estimate when they are reported.
+	constexpr unsigned int ESTIMATE_FRACTION_BITS = 8;
+
+	inline size_t round_estimate(size_t estimate)
+	{
+		return (estimate + (static_cast<size_t>(1) << (ESTIMATE_FRACTION_BITS - 1))) >> ESTIMATE_FRACTION_BITS;
+	}
+
+	inline long long round_estimate_delta(long long estimate)
+	{
+		return estimate < 0 ? -static_cast<long long>(round_estimate(static_cast<size_t>(-estimate))) : static_cast<long long>(round_estimate(static_cast<size_t>(estimate)));
+	}
+
+	// tcmalloc style sampling by allocated bytes.
+	// each thread samples the allocation which crosses a geometric random interval of bytes.
+	// allocation of size s is sampled with probability p = 1 - exp(-s / sampling interval),
+	// so a sampled allocation stands for s / p bytes and 1 / p allocations.
+	class AllocationSampler final
+	{
+	public:
+		AllocationSampler();
+
+		~AllocationSampler();
+
+		DELETE_CLASS_COPY_MOVE(AllocationSampler)
+
+		// mean bytes between samples. 0 disables sampling.
+		void set_sampling_interval(size_t sampling_interval);
+
+		size_t get_sampling_interval() const;
+
+		bool is_enabled() const;
+
+		// fast path is only thread local counter decrement.
+		bool should_sample(size_t size);
+
+		// fixed point with ESTIMATE_FRACTION_BITS fraction bits.
+		size_t get_estimated_size(size_t size) const;
+
+		// fixed point with ESTIMATE_FRACTION_BITS fraction bits.
+		size_t get_estimated_count(size_t size) const;
+
+#pragma region sampled_addresses
+		// set of live sampled addresses. lets free skip addresses which are never sampled.
+		// an address whose bucket is full goes to next level, which has twice the buckets. levels are added on demand.
+		// returns false when buckets of all MAX_LEVEL_COUNT levels are full. the allocation is not sampled then, and caller counts it.
+		bool mark_sampled(void* address);
+
+		// called on free. returns true if address was sampled.
+		bool unmark_sampled(void* address);
+#pragma endregion
+
+	private:
+		// one bucket is one cache line of addresses.
+		static constexpr size_t BUCKET_SIZE = CACHE_LINE_SIZE / sizeof(void*);
+
+		// buckets of first level. level i has FIRST_LEVEL_BUCKET_COUNT << i buckets.
+		static constexpr size_t FIRST_LEVEL_BUCKET_COUNT = 1ull << 14;
+
+		// about 33M samples. last level is 128 MB.
+		static constexpr size_t MAX_LEVEL_COUNT = 8;
+
+		struct SampledAddressLevel
+		{
+			size_t bucket_count_;
+
+			std::atomic<void*>* addresses_;
+
+			// bucket was full when an address was marked, so the address may be in next level. never cleared.
+			std::atomic<bool>* is_spilled_;
+		};
+
+		bool pick_next_sample(size_t size);
+
+		long long get_next_interval();
+
+		// created when it is first needed. nullptr when level can't be allocated.
+		SampledAddressLevel* get_or_create_level(size_t level);
+
+		static SampledAddressLevel* create_level(size_t bucket_count);
+
+		static size_t get_bucket_index(const SampledAddressLevel& sampled_level, void* address);
+
+		size_t sampling_interval_;
+
+		// filled in order. a level is never removed until destructor.
+		std::atomic<SampledAddressLevel*> sampled_address_levels_[MAX_LEVEL_COUNT];
+
+		// guards creation of levels.
+		std::mutex level_mutex_;
+
+		static thread_local long long bytes_until_sample_;
+
+		static thread_local bool is_thread_initialized_;
+
+		static thread_local unsigned long long random_state_;
+	};
+
+	inline bool AllocationSampler::should_sample(size_t size)
+	{
+		bytes_until_sample_ -= static_cast<long long>(size);
+
+		if (bytes_until_sample_ >= 0)
+		{
+			return false;
+		}
+
+		return pick_next_sample(size);
+	}
+}
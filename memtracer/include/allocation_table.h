@@ -0,0 +1,73 @@
+#pragma once
+#include "core_define.h"
+
+namespace memtracer
+{
+	struct Allocation
+	{
+		// nullptr is empty entry.
+		void* address_;
+
+		size_t size_;
+
+		StackId stack_id_;
+
+		// this allocation took the address while older allocation of it was still live.
+		// happens when realloc's old address is reused before realloc's record is published.
+		bool is_replaced_;
+
+		// publish time of allocate record. lifetime is measured from it on free.
+		Timestamp timestamp_;
+	};
+
+	// open addressing table of live allocations. only used in tracer thread.
+	// linear probing with backward shift deletion, so there are no tombstones.
+	class AllocationTable final
+	{
+	public:
+		AllocationTable();
+
+		~AllocationTable();
+
+		DELETE_CLASS_COPY_MOVE(AllocationTable)
+
+		// returns entry of address. is_inserted is false when address was already live.
+		Allocation* emplace(void* address, bool& is_inserted);
+
+		// returns false for unknown address.
+		bool erase(void* address, Allocation& allocation);
+
+		// nullptr for unknown address.
+		const Allocation* find(void* address) const;
+
+		size_t get_count() const;
+
+		template <typename Function>
+		void for_each(const Function& function) const;
+
+	private:
+		static constexpr size_t INITIAL_CAPACITY = 1ull << 12;
+
+		size_t get_home_index(void* address) const;
+
+		void grow();
+
+		Allocation* entries_;
+
+		size_t capacity_;
+
+		size_t count_;
+	};
+
+	template <typename Function>
+	void AllocationTable::for_each(const Function& function) const
+	{
+		for (size_t i = 0; i < capacity_; i++)
+		{
+			if (entries_[i].address_ != nullptr)
+			{
+				function(entries_[i]);
+			}
+		}
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include "core_define.h"
+#include "memory_tracer_allocation.h"
+#include "platform.h"
+
+namespace memtracer
+{
+	// private memory of the tracer, mapped from os. tracer never shares allocator locks or heap with the program.
+	// small blocks come from slabs of size classes, cached per thread. large blocks are mapped one by one.
+	// slabs are kept for reuse and not returned to os.
+	class Arena final
+	{
+	public:
+		// constructed at first use and never destroyed. blocks can be freed at any point of process exit.
+		static Arena& get_instance();
+
+		DELETE_CLASS_COPY_MOVE(Arena)
+
+		// 16 byte aligned. blocks of size class multiple of CACHE_LINE_SIZE are cache line aligned.
+		void* allocate(size_t size);
+
+		// block can be from other thread.
+		void deallocate(void* block);
+
+		ArenaStatistics get_statistics() const;
+
+	private:
+		// slab and large block are aligned to this, so header of a block is found by masking its address.
+		static constexpr size_t SLAB_SIZE = PAGE_ALLOCATION_ALIGNMENT;
+
+		// one cache line, so blocks keep cache line alignment.
+		static constexpr size_t HEADER_SIZE = CACHE_LINE_SIZE;
+
+		static constexpr size_t SIZE_CLASS_COUNT = 20;
+
+		static constexpr size_t LARGE_SIZE_CLASS = SIZE_CLASS_COUNT;
+
+		// bytes kept per size class in a thread cache. half of it moves at once.
+		static constexpr size_t THREAD_CACHE_BYTES = 32 * 1024;
+
+		static constexpr size_t SIZE_CLASS_SIZES[SIZE_CLASS_COUNT] =
+		{
+			16, 32, 48, 64, 80, 96, 112, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192
+		};
+
+		// at start of slab or large block.
+		struct Header
+		{
+			size_t size_class_;
+
+			// bytes from os. SLAB_SIZE for slab.
+			size_t mapped_size_;
+		};
+
+		struct FreeBlock
+		{
+			FreeBlock* next_;
+		};
+
+		// shared free list of a size class.
+		struct alignas(CACHE_LINE_SIZE) CentralList
+		{
+			std::atomic<bool> is_locked_;
+
+			FreeBlock* head_;
+
+			void lock();
+
+			void unlock();
+		};
+
+		struct ThreadCache
+		{
+			ThreadCache();
+
+			// returns cached blocks to central lists when the thread exits.
+			~ThreadCache();
+
+			FreeBlock* heads_[SIZE_CLASS_COUNT];
+
+			size_t counts_[SIZE_CLASS_COUNT];
+		};
+
+		Arena();
+
+		~Arena();
+
+		static size_t get_size_class(size_t size);
+
+		static size_t get_cache_limit(size_t size_class);
+
+		static Header& get_header(void* block);
+
+		// moves up to count blocks from central list to head. maps new slab when central list is empty.
+		size_t refill(size_t size_class, FreeBlock*& head, size_t count);
+
+		// moves count blocks of head to central list.
+		void flush(size_t size_class, FreeBlock*& head, size_t count);
+
+		void* allocate_large(size_t size);
+
+		CentralList central_lists_[SIZE_CLASS_COUNT];
+
+		std::atomic<size_t> used_memory_;
+
+		std::atomic<size_t> mapped_memory_;
+
+		static thread_local ThreadCache thread_cache_;
+
+		// trivially destructible, so still readable after thread_cache_ is destroyed at thread exit.
+		static thread_local bool is_thread_cache_destroyed_;
+	};
+}
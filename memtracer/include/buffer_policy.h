@@ -0,0 +1,28 @@
+#pragma once
+#include "core_define.h"
+
+namespace memtracer
+{
+	// what a producer does when tracer thread is behind and its ring fills up.
+	// snapshot and stop records always wait, they are never dropped.
+	enum class EBufferPolicy : unsigned char
+	{
+		// wait until tracer thread frees a slot. nothing is lost. (default)
+		Block,
+		// discard allocate / free records of a full ring and count them.
+		DropAndCount,
+		// record size only, without call stack, while ring is above EVENT_RING_DEGRADE_COUNT. waits when ring is full.
+		Degrade
+	};
+
+	// counted by producer threads since start.
+	struct BufferStatistics
+	{
+		size_t dropped_allocation_count_;
+
+		size_t dropped_free_count_;
+
+		// recorded under StackTable::OVERFLOW_STACK_ID.
+		size_t degraded_allocation_count_;
+	};
+}
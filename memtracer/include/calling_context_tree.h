@@ -0,0 +1,90 @@
+#pragma once
+#include "core_define.h"
+#include "file_writer.h"
+#include "snapshot_file.h"
+
+namespace memtracer
+{
+	// trie of call stacks of a snapshot file. children of a node are its callees.
+	// frames of same function under same parent share a node, so a node is one calling context of a function.
+	// values are live bytes and counts of the stacks in the file.
+	class CallingContextTree final
+	{
+	public:
+		static constexpr uint32_t ROOT_NODE = 0;
+
+		static constexpr uint32_t NO_NODE = 0xFFFFFFFFu;
+
+		struct Node
+		{
+			// index of get_function. NO_NODE for root.
+			uint32_t function_;
+
+			uint32_t parent_;
+
+			uint32_t first_child_;
+
+			uint32_t next_sibling_;
+
+			// this node and its callees.
+			uint64_t inclusive_memory_allocation_;
+
+			uint64_t inclusive_memory_allocation_count_;
+
+			// stacks which end at this node. root has stacks without call stack.
+			uint64_t exclusive_memory_allocation_;
+
+			uint64_t exclusive_memory_allocation_count_;
+		};
+
+		struct Function
+		{
+			// symbol address, or return address when frame has no symbol.
+			uint64_t address_;
+
+			// string offset in snapshot file. SNAPSHOT_FILE_NO_STRING when frame has no symbol.
+			uint32_t name_;
+		};
+
+		CallingContextTree();
+
+		~CallingContextTree();
+
+		DELETE_CLASS_COPY_MOVE(CallingContextTree)
+
+		// one pass over frames and one over stacks. snapshot_file must outlive the tree.
+		void build(const SnapshotFile& snapshot_file);
+
+		size_t get_node_count() const;
+
+		const Node& get_node(uint32_t index) const;
+
+		size_t get_function_count() const;
+
+		const Function& get_function(uint32_t index) const;
+
+		// symbol name, or hex address when frame has no symbol.
+		std::string get_function_name(uint32_t index) const;
+
+		// "outer;...;inner bytes" line per calling context with exclusive bytes. input of flame graph tools.
+		// write errors are returned by file_writer.close().
+		void write_folded(FileWriter& file_writer) const;
+
+		// inclusive and self bytes of each function with its callers and callees, sorted by inclusive bytes.
+		// recursive calls of a function are counted once in its inclusive bytes.
+		void write_call_graph(FileWriter& file_writer) const;
+
+	private:
+		// existing child of parent for function, or new one.
+		uint32_t get_child(uint32_t parent, uint32_t function);
+
+		const SnapshotFile* snapshot_file_;
+
+		std::vector<Node> nodes_;
+
+		std::vector<Function> functions_;
+
+		// (parent << 32 | function) to child node.
+		std::unordered_map<uint64_t, uint32_t> children_;
+	};
+}
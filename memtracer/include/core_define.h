@@ -1,34 +1,101 @@
 #pragma once
-#include <concrt.h>
 #include <cassert>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
 #include <thread>
-#include <concurrent_queue.h>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
 #include <algorithm>
 #include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdio>
 
-#include <windows.h>
-#include <tchar.h>
-#include <dbghelp.h>
+#ifdef _WIN32
+#	include <windows.h>
+#	include <tchar.h>
+#	include <dbghelp.h>
 
-#pragma comment(lib, "dbghelp.lib")
+#	pragma comment(lib, "dbghelp.lib")
+#else // _WIN32
+#	include <climits>
+#endif // _WIN32
 
 namespace memtracer
 {
-	// TODO : can be set user side.
+	// frames stored per call stack. upper bound of TracerPolicy's stack depth, which is set user side.
 	constexpr unsigned int MAX_STACK_FRAMES = 32;
 
-	constexpr unsigned int FRAMES_TO_SKIP = 2;
+	// records per producer thread ring. must be power of two.
+	constexpr size_t EVENT_RING_CAPACITY = 4096;
 
-	using AllocFunc = std::function<void* (size_t)>;
+	// EBufferPolicy::Degrade skips call stacks while more records than this are pending in a ring.
+	constexpr size_t EVENT_RING_DEGRADE_COUNT = EVENT_RING_CAPACITY * 3 / 4;
 
-	using FreeFunc = std::function<void(void*)>;
+	// max records taken from one ring per drain pass.
+	constexpr size_t EVENT_DRAIN_BATCH = 256;
 
-	using FrameCount = WORD;
+	// empty drain passes before tracer thread parks until a producer wakes it.
+	constexpr unsigned int TRACER_SPIN_PASSES = 128;
 
-	using CallStackHash = DWORD;
+	// first tracer thread checks snapshot triggers at most this often. it also wakes up this often while parked
+	// when interval trigger is set.
+	constexpr unsigned int SNAPSHOT_TRIGGER_CHECK_MILLISECONDS = 10;
+
+	// payload bytes of an event log block. tracer thread hands a full block to event log thread.
+	constexpr size_t EVENT_LOG_BLOCK_SIZE = 64 * 1024;
+
+	// event log blocks which are filled and not written yet. tracer threads wait for event log thread beyond it.
+	constexpr size_t EVENT_LOG_MAX_BLOCKS = 64;
+
+	// upper bound of MemoryTracer::set_tracer_thread_count.
+	constexpr unsigned int MAX_TRACER_THREADS = 64;
+
+	constexpr size_t CACHE_LINE_SIZE = 64;
+
+	// distinct call stacks kept by StackTable. must be power of two.
+	constexpr unsigned int MAX_CALL_STACKS = 1u << 18;
+
+	// keeps tracer's own helpers out of captured call stacks.
+#ifdef _MSC_VER
+#	define MEMTRACER_FORCEINLINE __forceinline
+#else
+#	define MEMTRACER_FORCEINLINE inline __attribute__((always_inline))
+#endif
+
+	using FrameCount = unsigned short;
+
+	// computed from frames. collisions are resolved by comparing frames.
+	using CallStackHash = unsigned long long;
+
+	// index of interned call stack in StackTable.
+	using StackId = unsigned int;
+
+	using Timestamp = unsigned long long;
+
+	// monotonic and consistent between threads. used to order events of different rings.
+	inline Timestamp get_timestamp()
+	{
+		return static_cast<Timestamp>(std::chrono::steady_clock::now().time_since_epoch().count());
+	}
+
+	inline unsigned long long get_timestamp_nanoseconds(Timestamp timestamp)
+	{
+		return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::duration(timestamp)).count());
+	}
+
+	// length of milliseconds in Timestamp units.
+	inline Timestamp get_timestamp_duration(unsigned long long milliseconds)
+	{
+		return static_cast<Timestamp>(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::milliseconds(milliseconds)).count());
+	}
 }
 
 #define DELETE_CLASS_COPY(Class)				\
@@ -43,22 +110,34 @@ namespace memtracer
 	DELETE_CLASS_COPY(Class)					\
 	DELETE_CLASS_MOVE(Class)					\
 
-#define DEFAULT_REPORT_PATH TEXT(".\\MemoryTracer_Report")
+#ifdef _WIN32
+#	define DEFAULT_REPORT_PATH TEXT(".\\MemoryTracer_Report")
+#	define PATH_SEPARATOR TEXT("\\")
 
-#ifdef _UNICODE
+#	ifdef _UNICODE
 	using tstring = std::wstring;
 	using TSYMBOL_INFO = SYMBOL_INFOW;
 	using TIMAGEHLP_LINE64 = IMAGEHLP_LINEW64;
 
-#	define stprintf_s swprintf_s
-#	define TSymFromAddr SymFromAddrW
-#	define TSymGetLineFromAddr64 SymGetLineFromAddrW64
-#else // _UNICODE
+#		define stprintf_s swprintf_s
+#		define TSymFromAddr SymFromAddrW
+#		define TSymGetLineFromAddr64 SymGetLineFromAddrW64
+#	else // _UNICODE
 	using tstring = std::string;
 	using TSYMBOL_INFO = SYMBOL_INFO;
-	using TIMAGEHLP_LINE64 = IMAGEHLP_LINE64
+	using TIMAGEHLP_LINE64 = IMAGEHLP_LINE64;
+
+#		define stprintf_s sprintf_s
+#		define TSymFromAddr SymFromAddr
+#		define TSymGetLineFromAddr64 SymGetLineFromAddr64
+#	endif // _UNICODE
+#else // _WIN32
+	using TCHAR = char;
+	using tstring = std::string;
 
-#	define stprintf sprintf_s
-#	define TSymFromAddr SymFromAddr
-#	define TSymGetLineFromAddr64 SymGetLineFromAddr64
-#endif // _UNICODE
\ No newline at end of file
+#	define TEXT(text) text
+#	define MAX_PATH PATH_MAX
+#	define DEFAULT_REPORT_PATH TEXT("./MemoryTracer_Report")
+#	define PATH_SEPARATOR TEXT("/")
+#	define stprintf_s snprintf
+#endif // _WIN32
\ No newline at end of file
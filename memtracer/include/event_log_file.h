@@ -0,0 +1,268 @@
+#pragma once
+#include "core_define.h"
+#include "event_log_format.h"
+#include "file_writer.h"
+#include "memory_tracer_allocator.h"
+#include "stack_table.h"
+#include "symbol_cache.h"
+
+namespace memtracer
+{
+	// events of one tracer shard, filled by its tracer thread and written by event log thread.
+	struct EventLogBlock final
+	{
+		EventLogBlock();
+
+		~EventLogBlock();
+
+		DELETE_CLASS_COPY_MOVE(EventLogBlock)
+
+		void* operator new(size_t size);
+
+		void operator delete(void* p);
+
+		uint32_t shard_index_;
+
+		// ns since start of trace.
+		uint64_t first_timestamp_;
+
+		uint32_t event_count_;
+
+		std::vector<uint8_t, MemoryTracerAllocator<uint8_t>> payload_;
+
+		// stacks which events of this block use first in the shard. event log thread writes the ones not written yet.
+		std::vector<StackId, MemoryTracerAllocator<StackId>> stack_ids_;
+	};
+
+	// background writer of event log. tracer threads only encode events into blocks, file and symbols are
+	// handled by event log thread, which runs run() between open and request_close.
+	class EventLogWriter final
+	{
+	public:
+		// symbol_cache is shared with snapshots, so it is used under symbol_cache_mutex.
+		EventLogWriter(const StackTable& stack_table, SymbolCache& symbol_cache, std::mutex& symbol_cache_mutex);
+
+		~EventLogWriter();
+
+		DELETE_CLASS_COPY_MOVE(EventLogWriter)
+
+		// creates file and writes its header. event timestamps are counted from start_timestamp.
+		bool open(const TCHAR* path, uint32_t shard_count, uint64_t sampling_interval, Timestamp start_timestamp);
+
+		// body of event log thread. writes submitted blocks until close is requested, then end block.
+		void run();
+
+		// called after tracer threads submitted their last blocks.
+		void request_close(Timestamp end_timestamp);
+
+		// empty block. waits while EVENT_LOG_MAX_BLOCKS blocks are filled and not written yet.
+		EventLogBlock* acquire_block();
+
+		void submit_block(EventLogBlock* block);
+
+		// ns since start of trace.
+		uint64_t get_log_timestamp(Timestamp timestamp) const;
+
+	private:
+		void write_block(EventLogBlock& block);
+
+		// stack block and frame block for stacks of block which are not written yet.
+		void write_stacks(const EventLogBlock& block);
+
+		void write_block_header(uint32_t block_type, uint32_t shard_index, uint64_t first_timestamp, uint32_t record_count, uint32_t payload_size);
+
+		const StackTable& stack_table_;
+
+		SymbolCache& symbol_cache_;
+
+		std::mutex& symbol_cache_mutex_;
+
+		FileWriter file_writer_;
+
+		Timestamp start_timestamp_;
+
+		std::mutex blocks_mutex_;
+
+		std::condition_variable blocks_condition_;
+
+		// guarded by blocks_mutex_.
+		std::deque<EventLogBlock*, MemoryTracerAllocator<EventLogBlock*>> submitted_blocks_;
+
+		std::vector<EventLogBlock*, MemoryTracerAllocator<EventLogBlock*>> free_blocks_;
+
+		// blocks which exist. guarded by blocks_mutex_.
+		size_t block_count_;
+
+		bool is_close_requested_;
+
+		Timestamp end_timestamp_;
+
+#pragma region only_used_in_event_log_thread
+		// indexed by StackId.
+		std::vector<bool, MemoryTracerAllocator<bool>> is_stack_written_;
+
+		std::unordered_set<void*, std::hash<void*>, std::equal_to<void*>, MemoryTracerAllocator<void*>> written_frames_;
+
+		// frames of stacks of current block which are not written yet.
+		std::vector<void*, MemoryTracerAllocator<void*>> new_frames_;
+
+		std::vector<uint8_t, MemoryTracerAllocator<uint8_t>> stack_payload_;
+
+		std::vector<uint8_t, MemoryTracerAllocator<uint8_t>> frame_payload_;
+#pragma endregion
+	};
+
+	// encodes events of one tracer shard. only used by its tracer thread.
+	class EventLogStream final
+	{
+	public:
+		EventLogStream();
+
+		~EventLogStream();
+
+		DELETE_CLASS_COPY_MOVE(EventLogStream)
+
+		void open(EventLogWriter* event_log_writer, uint32_t shard_index);
+
+		// submits buffered events. writer must still be open.
+		void close();
+
+		bool is_open() const;
+
+		void add_allocation(Timestamp timestamp, const void* address, size_t size, StackId stack_id);
+
+		void add_free(Timestamp timestamp, const void* address);
+
+		void add_reallocation(Timestamp timestamp, const void* previous_address, const void* address, size_t size, StackId stack_id);
+
+		// submits buffered events, so they reach the file while tracer thread sleeps.
+		void flush();
+
+	private:
+		// an event is never larger than this.
+		static constexpr size_t MAX_EVENT_SIZE = 64;
+
+		void begin_event(Timestamp timestamp, uint32_t event_type);
+
+		void add_address(const void* address);
+
+		void add_stack_id(StackId stack_id);
+
+		void add_varint(uint64_t value);
+
+		// submits block when it is full.
+		void end_event();
+
+		EventLogWriter* event_log_writer_;
+
+		uint32_t shard_index_;
+
+		EventLogBlock* block_;
+
+		uint64_t previous_timestamp_;
+
+		uint64_t previous_address_;
+
+		// indexed by StackId. stacks which blocks of this stream already listed.
+		std::vector<bool, MemoryTracerAllocator<bool>> is_stack_listed_;
+	};
+
+	struct EventLogEvent
+	{
+		uint32_t event_type_;
+
+		uint32_t shard_index_;
+
+		// ns since start of trace.
+		uint64_t timestamp_;
+
+		// EVENT_LOG_REALLOCATE only.
+		uint64_t previous_address_;
+
+		uint64_t address_;
+
+		// 0 for EVENT_LOG_FREE.
+		uint64_t size_;
+
+		uint32_t stack_id_;
+	};
+
+	struct EventLogStack
+	{
+		uint32_t stack_id_;
+
+		// innermost first.
+		std::vector<uint64_t> frames_;
+	};
+
+	struct EventLogFrame
+	{
+		uint64_t symbol_address_;
+
+		uint32_t line_number_;
+
+		// SNAPSHOT_FILE_FRAME_*
+		uint32_t flags_;
+
+		std::string symbol_name_;
+
+		std::string file_name_;
+	};
+
+	// read only, memory mapped event log.
+	class EventLogFile final
+	{
+	public:
+		EventLogFile();
+
+		~EventLogFile();
+
+		DELETE_CLASS_COPY_MOVE(EventLogFile)
+
+		// maps file, reads stacks and frames and indexes event blocks. returns false for unknown version or broken header.
+		// a block cut at end of file (e.g. crash while writing) and blocks after it are ignored.
+		bool open(const TCHAR* path);
+
+		void close();
+
+		const EventLogFileHeader& get_header() const;
+
+		// false when trace was not stopped. (e.g. crash)
+		bool is_complete() const;
+
+		// ns of end of trace, or of last event when log is not complete.
+		uint64_t get_end_timestamp() const;
+
+		uint64_t get_event_count() const;
+
+		const std::vector<EventLogStack>& get_stacks() const;
+
+		// nullptr when frame has no symbol.
+		const EventLogFrame* find_frame(uint64_t address) const;
+
+		// events of all shards in timestamp order, until visitor returns false. returns false when a block is broken.
+		bool read_events(const std::function<bool(const EventLogEvent&)>& visitor) const;
+
+	private:
+		bool read_stacks(const uint8_t* payload, const uint8_t* end, uint32_t record_count);
+
+		bool read_frames(const uint8_t* payload, const uint8_t* end, uint32_t record_count);
+
+		const char* data_;
+
+		size_t size_;
+
+		bool is_complete_;
+
+		uint64_t end_timestamp_;
+
+		uint64_t event_count_;
+
+		std::vector<EventLogStack> stacks_;
+
+		std::unordered_map<uint64_t, EventLogFrame> frames_;
+
+		// offsets of event block headers by shard, in file order.
+		std::vector<std::vector<size_t>> event_blocks_;
+	};
+}
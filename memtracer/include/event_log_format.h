@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+
+namespace memtracer
+{
+	// streamed record of every traced allocate / free / reallocate. (MemoryTracer::set_event_log_path)
+	// blocks are appended while trace runs, so a log cut by a crash is read up to its last whole block.
+	//
+	// [EventLogFileHeader]
+	// [EventLogBlockHeader, payload] x N
+	//
+	// all integers of payloads are LEB128 varints. signed values are zigzag encoded.
+	//
+	// EVENT_LOG_BLOCK_STACKS : call stacks before the first event block which uses them.
+	//   stack id, frame count, frames as signed delta from previous frame of the stack.
+	// EVENT_LOG_BLOCK_FRAMES : symbols of frames before the first stack block which uses them.
+	//   address, symbol address, line number, flags (SNAPSHOT_FILE_FRAME_*), then null terminated
+	//   UTF-8 symbol name and file name. (empty when unknown)
+	// EVENT_LOG_BLOCK_EVENTS : events of one tracer shard in applied order. addresses of a shard never
+	//   move to another shard, so order between shards only matters for peak.
+	//   (timestamp delta << 2 | event type), then by type
+	//   EVENT_LOG_ALLOCATE : address delta, size, stack id
+	//   EVENT_LOG_FREE : address delta
+	//   EVENT_LOG_REALLOCATE : address delta of old block, delta of new block from old one, size, stack id
+	//   timestamp delta is from previous event of the block, first one from first_timestamp_.
+	//   address delta is signed, from previous address of the block. (0 at block start)
+	// EVENT_LOG_BLOCK_END : written at stop. no payload. first_timestamp_ is end of trace.
+	constexpr char EVENT_LOG_FILE_MAGIC[8] = { 'M', 'T', 'E', 'V', 'L', 'O', 'G', '\0' };
+
+	constexpr uint32_t EVENT_LOG_FILE_VERSION = 1;
+
+	// the file is written and read by the same kind of machine.
+	constexpr uint32_t EVENT_LOG_FILE_ENDIAN_TAG = 0x01020304u;
+
+	// EventLogBlockHeader::block_type_
+	constexpr uint32_t EVENT_LOG_BLOCK_STACKS = 0;
+
+	constexpr uint32_t EVENT_LOG_BLOCK_FRAMES = 1;
+
+	constexpr uint32_t EVENT_LOG_BLOCK_EVENTS = 2;
+
+	constexpr uint32_t EVENT_LOG_BLOCK_END = 3;
+
+	// type in low 2 bits of first varint of an event.
+	constexpr uint32_t EVENT_LOG_ALLOCATE = 0;
+
+	constexpr uint32_t EVENT_LOG_FREE = 1;
+
+	// release of old block and allocation of new one. also when they have same address.
+	constexpr uint32_t EVENT_LOG_REALLOCATE = 2;
+
+	struct EventLogFileHeader
+	{
+		char magic_[8];
+
+		uint32_t version_;
+
+		uint32_t endian_tag_;
+
+		uint32_t shard_count_;
+
+		uint32_t reserved_;
+
+		// 0 when all allocations are traced. sizes in events are not estimated.
+		uint64_t sampling_interval_;
+	};
+
+	struct EventLogBlockHeader
+	{
+		uint32_t block_type_;
+
+		// tracer shard of EVENT_LOG_BLOCK_EVENTS. 0 for others.
+		uint32_t shard_index_;
+
+		// ns since start of trace.
+		uint64_t first_timestamp_;
+
+		// events or stacks or frames in payload.
+		uint32_t record_count_;
+
+		uint32_t payload_size_;
+	};
+}
@@ -0,0 +1,161 @@
+#pragma once
+#include "core_define.h"
+#include "memory_tracer_allocation.h"
+
+namespace memtracer
+{
+	// single producer, single consumer ring of inline records.
+	// producer is the thread that owns the ring, consumer is the tracer thread.
+	template <typename T, size_t Capacity>
+	class EventRing final
+	{
+		static_assert((Capacity & (Capacity - 1)) == 0, "EventRing capacity must be power of two.");
+
+	public:
+		EventRing();
+
+		~EventRing();
+
+		DELETE_CLASS_COPY_MOVE(EventRing)
+
+		void* operator new(size_t size);
+
+		void operator delete(void* block);
+
+#pragma region producer
+		// returns nullptr when ring is full.
+		T* try_reserve();
+
+		// publish reserved record to consumer.
+		void commit();
+
+		// true when more than count records are not consumed yet.
+		bool is_pending_over(size_t count);
+
+		// owner thread is exiting. consumer releases ring after draining it.
+		void retire();
+#pragma endregion
+
+#pragma region consumer
+		size_t get_readable_count() const;
+
+		T& get_readable(size_t offset);
+
+		void consume(size_t count);
+
+		bool is_retired() const;
+#pragma endregion
+
+	private:
+		static constexpr size_t INDEX_MASK = Capacity - 1;
+
+		// written by producer.
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_;
+
+		// producer's last seen tail_. avoids touching consumer's cache line on every reserve.
+		size_t cached_tail_;
+
+		// written by consumer.
+		alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_;
+
+		std::atomic<bool> is_retired_;
+
+		alignas(CACHE_LINE_SIZE) T records_[Capacity];
+	};
+
+	template <typename T, size_t Capacity>
+	EventRing<T, Capacity>::EventRing() :
+		head_(0)
+		, cached_tail_(0)
+		, tail_(0)
+		, is_retired_(false)
+		, records_()
+	{
+	}
+
+	template <typename T, size_t Capacity>
+	EventRing<T, Capacity>::~EventRing()
+	{
+	}
+
+	template <typename T, size_t Capacity>
+	void* EventRing<T, Capacity>::operator new(size_t size)
+	{
+		return memtracer_alloc(size);
+	}
+
+	template <typename T, size_t Capacity>
+	void EventRing<T, Capacity>::operator delete(void* block)
+	{
+		memtracer_free(block);
+	}
+
+	template <typename T, size_t Capacity>
+	T* EventRing<T, Capacity>::try_reserve()
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+
+		if (head - cached_tail_ >= Capacity)
+		{
+			cached_tail_ = tail_.load(std::memory_order_acquire);
+
+			if (head - cached_tail_ >= Capacity)
+			{
+				return nullptr;
+			}
+		}
+
+		return &records_[head & INDEX_MASK];
+	}
+
+	template <typename T, size_t Capacity>
+	void EventRing<T, Capacity>::commit()
+	{
+		head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	template <typename T, size_t Capacity>
+	bool EventRing<T, Capacity>::is_pending_over(size_t count)
+	{
+		const size_t head = head_.load(std::memory_order_relaxed);
+
+		if (head - cached_tail_ <= count)
+		{
+			return false;
+		}
+
+		cached_tail_ = tail_.load(std::memory_order_acquire);
+
+		return head - cached_tail_ > count;
+	}
+
+	template <typename T, size_t Capacity>
+	void EventRing<T, Capacity>::retire()
+	{
+		is_retired_.store(true, std::memory_order_release);
+	}
+
+	template <typename T, size_t Capacity>
+	size_t EventRing<T, Capacity>::get_readable_count() const
+	{
+		return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed);
+	}
+
+	template <typename T, size_t Capacity>
+	T& EventRing<T, Capacity>::get_readable(size_t offset)
+	{
+		return records_[(tail_.load(std::memory_order_relaxed) + offset) & INDEX_MASK];
+	}
+
+	template <typename T, size_t Capacity>
+	void EventRing<T, Capacity>::consume(size_t count)
+	{
+		tail_.store(tail_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+	}
+
+	template <typename T, size_t Capacity>
+	bool EventRing<T, Capacity>::is_retired() const
+	{
+		return is_retired_.load(std::memory_order_acquire);
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "core_define.h"
+#include "platform.h"
+
+namespace memtracer
+{
+	// buffered, sequential file output.
+	class FileWriter final
+	{
+	public:
+		FileWriter();
+
+		~FileWriter();
+
+		DELETE_CLASS_COPY_MOVE(FileWriter)
+
+		bool open(const TCHAR* path);
+
+		// returns false once any write failed.
+		bool write(const void* data, size_t size);
+
+		// writes zero bytes until offset is multiple of alignment.
+		bool align(size_t alignment);
+
+		// flushes and closes. returns false when any write failed.
+		bool close();
+
+		// bytes written since open.
+		size_t get_offset() const;
+
+	private:
+		static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+		bool flush();
+
+		FileHandle file_handle_;
+
+		char* buffer_;
+
+		size_t buffer_size_;
+
+		size_t offset_;
+
+		bool is_failed_;
+	};
+}
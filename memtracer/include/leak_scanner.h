@@ -0,0 +1,105 @@
+#pragma once
+#include "core_define.h"
+#include "memory_tracer_allocator.h"
+#include "platform.h"
+
+namespace memtracer
+{
+	// live allocation copied out of a shard for leak scan.
+	struct LeakBlock
+	{
+		void* address_;
+
+		size_t size_;
+
+		StackId stack_id_;
+
+		// publish time of allocate record. tells the block from a later allocation of the same address.
+		Timestamp timestamp_;
+	};
+
+	using LeakBlockList = std::vector<LeakBlock, MemoryTracerAllocator<LeakBlock>>;
+
+	// conservative mark phase of leak scan. a block is reached when any aligned pointer sized value
+	// in roots or in reached blocks points into it, so integers which look like addresses keep blocks too.
+	// memory is copied by read_memory, so blocks freed and stacks unmapped during the scan are skipped instead of faulting.
+	class LeakScanner final
+	{
+	public:
+		// leak_blocks are sorted by address and don't overlap. they must outlive the scanner.
+		// init_worker_thread is called first on each worker thread, so allocations of the worker aren't traced.
+		LeakScanner(const LeakBlockList& leak_blocks, unsigned int worker_count, void (*init_worker_thread)());
+
+		~LeakScanner();
+
+		DELETE_CLASS_COPY_MOVE(LeakScanner)
+
+		// marks blocks reached from roots, by worker_count threads. marks are kept, so it can be called again with more roots.
+		// false when memory of the process can't be read. (e.g. process_vm_readv is not allowed)
+		bool mark(const MemoryRangeList& roots);
+
+		bool is_marked(size_t index) const;
+
+	private:
+		// bytes copied at once. roots are split into work items of this size.
+		static constexpr size_t SCAN_CHUNK_SIZE = 1ull << 16;
+
+		// small blocks are copied together by one read_memory_ranges.
+		static constexpr size_t READ_BATCH_COUNT = MAX_READ_MEMORY_RANGES;
+
+		// a worker with more pending blocks than this gives half of them to idle workers.
+		static constexpr size_t SHARE_THRESHOLD = 256;
+
+		using IndexList = std::vector<size_t, MemoryTracerAllocator<size_t>>;
+
+		using WordBuffer = std::vector<uintptr_t, MemoryTracerAllocator<uintptr_t>>;
+
+		// index of block which has address. SIZE_MAX when no block has it.
+		size_t find_block(uintptr_t address) const;
+
+		// newly marked blocks are added to work_list.
+		void scan_words(const uintptr_t* words, size_t word_count, IndexList& work_list);
+
+		void scan_range(uintptr_t begin, uintptr_t end, WordBuffer& word_buffer, IndexList& work_list);
+
+		// ranges are word aligned and fit in word_buffer together.
+		void scan_ranges(const MemoryRangeList& ranges, WordBuffer& word_buffer, IndexList& work_list);
+
+		// scans blocks of work_list until it is empty.
+		void scan_work_list(WordBuffer& word_buffer, IndexList& work_list);
+
+		// waits until other worker shares blocks. false when every worker is idle, which ends the mark.
+		bool take_shared_work(IndexList& work_list);
+
+		void worker_update(const MemoryRangeList& root_chunks);
+
+		// body of worker threads other than the caller of mark.
+		void worker_thread_update(const MemoryRangeList& root_chunks);
+
+		const LeakBlockList& leak_blocks_;
+
+		unsigned int worker_count_;
+
+		void (*init_worker_thread_)();
+
+		// any value out of [min_address_, max_address_) is skipped without search.
+		uintptr_t min_address_;
+
+		uintptr_t max_address_;
+
+		std::vector<std::atomic<bool>, MemoryTracerAllocator<std::atomic<bool>>> is_marked_;
+
+		// next item of root_chunks to scan.
+		std::atomic<size_t> next_root_chunk_;
+
+		std::mutex shared_work_mutex_;
+
+		std::condition_variable shared_work_condition_;
+
+		// guarded by shared_work_mutex_.
+		IndexList shared_work_list_;
+
+		// guarded by shared_work_mutex_ when written. read without it to decide whether to share.
+		std::atomic<unsigned int> idle_worker_count_;
+	};
+}
@@ -1,61 +1,38 @@
 #pragma once
 #include <cstddef>
 
+#include "core_define.h"
+
 namespace memtracer
 {
-	class StackBackTrace;
-
 	enum class EOperationType : unsigned char
 	{
 		None,
 		Allocate,
 		Free,
+		// release of previous_address_ and allocation of address_. either can be nullptr.
+		Reallocate,
 		Snapshot,
 		Stop
 	};
 
-	class IMemoryOperation
-	{
-	protected:
-		IMemoryOperation(EOperationType type);
-
-	public:
-		EOperationType operation_type_;
-
-		void* operator new(size_t size);
-
-		void operator delete(void* block);
-	};
-
-	class AllocateOperation : public IMemoryOperation
+	// fixed size record written inline in producer thread's ring. no heap allocation per event.
+	struct MemoryOperation
 	{
-	public:
-		AllocateOperation(void* address, size_t size, class memtracer::StackBackTrace* stack_back_trace);
+		// taken when the record is published. orders records of different rings.
+		Timestamp timestamp_;
 
 		void* address_;
 
+		// size of sized delete for EOperationType::Free. 0 when unknown.
 		size_t size_;
 
-		class memtracer::StackBackTrace* stack_back_trace_;
-	};
+		// only valid for EOperationType::Reallocate.
+		void* previous_address_;
 
-	class FreeOperation : public IMemoryOperation
-	{
-	public:
-		FreeOperation(void* address);
+		// interned by producer thread. only valid for EOperationType::Allocate and Reallocate.
+		StackId stack_id_;
 
-		void* address_;
-	};
-
-	class SnapshotOperation : public IMemoryOperation
-	{
-	public:
-		SnapshotOperation();
-	};
-
-	class StopOperation : public IMemoryOperation
-	{
-	public:
-		StopOperation();
+		EOperationType operation_type_;
 	};
 }
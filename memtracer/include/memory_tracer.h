@@ -1,19 +1,29 @@
 #pragma once
 #include "core_define.h"
+#include "allocation_sampler.h"
+#include "allocation_table.h"
+#include "buffer_policy.h"
+#include "event_log_file.h"
+#include "event_ring.h"
+#include "leak_scanner.h"
 #include "memory_operation.h"
 #include "memory_tracer_allocator.h"
+#include "platform.h"
+#include "site_statistics.h"
+#include "snapshot_file.h"
+#include "snapshot_request.h"
+#include "snapshot_trigger.h"
+#include "symbol_cache.h"
+#include "thread_counters.h"
+#include "tracer_policy.h"
+#include "tracer_statistics.h"
 #include "stack_back_trace.h"
+#include "stack_statistics.h"
+#include "stack_table.h"
 
 namespace memtracer
 {
-	class StackBackTrace;
-
-	struct MemoryOperation;
-
-	template <void*(*Alloc)(size_t) = malloc
-		, void*(*ArrayAlloc)(size_t) = malloc
-		, void(*Free)(void*) = free
-		, void(*ArrayFree)(void*) = free>
+	template <typename Policy = TracerPolicy<>>
 	class MemoryTracer final
 	{
 	public:
@@ -22,509 +32,3138 @@ namespace memtracer
 
 		void start();
 
-		void take_snapshot() const;
+		// report is written by snapshot thread. future becomes true when it is written,
+		// false when trace is not running or writing failed.
+		std::future<bool> take_snapshot() const;
+
+		// reports only stacks whose live bytes or count changed, with their deltas.
+		// compares with previous snapshot (of any type) when baseline_name is nullptr.
+		std::future<bool> take_diff_snapshot(const TCHAR* baseline_name = nullptr) const;
+
+		// names this point of trace for take_diff_snapshot. same name replaces old baseline.
+		void mark_baseline(const TCHAR* baseline_name);
+
+		// reports live allocations which are not reachable, by stack. snapshot thread scans roots conservatively
+		// (stacks of producer threads, data and bss of modules) and then reached allocations, by all cores.
+		// allocations which were not reached are checked again after the scan, so ones freed or newly referenced meanwhile are not reported.
+		// registers and thread local storage are not scanned, and neither is memory which is not traced.
+		// false when sampling is enabled, because untraced allocations would hide the references in them.
+		std::future<bool> take_leak_snapshot() const;
+
+		void stop();
+
+		void set_report_path(const TCHAR* path);
+
+		// streams every traced allocate / free / reallocate to a compressed log while trace runs. must be set before start.
+		// each start truncates the log. replay tool rebuilds live allocations and reports of any point of it.
+		// nullptr turns it off. (default)
+		void set_event_log_path(const TCHAR* path);
+
+		// sample allocations by bytes instead of tracing all of them. 0 traces all allocations. (default)
+		// must be set before start. report shows estimated bytes and counts.
+		// samples which the sampled address set has no room for are counted in TracerStatistics.
+		// ignored when Policy::IS_SAMPLING_ENABLED is false.
+		void set_sampling_interval(size_t sampling_interval);
+
+		// what producers do when tracer thread can't keep up. must be set before start.
+		// counters of dropped and degraded records are in TracerStatistics and every report.
+		void set_buffer_policy(EBufferPolicy buffer_policy);
+
+		// automatic snapshots on live bytes, peak or interval. must be set before start. none by default.
+		// reports show their trigger. a trigger is a Full snapshot, written like take_snapshot.
+		void set_snapshot_triggers(const SnapshotTriggers& snapshot_triggers);
+
+		// live allocations are sharded by address across tracer threads. 1 by default.
+		// must be set before first start. every producer thread has a ring per tracer thread.
+		void set_tracer_thread_count(unsigned int tracer_thread_count);
+
+		// memory_tracer_operators.h routes every global operator new / delete here.
+		void* add_allocation(size_t size);
+
+		void* add_array_allocation(size_t size);
+
+		// alignment is power of two. block is over allocated by Policy::allocate and must be freed by remove_aligned_allocation.
+		void* add_aligned_allocation(size_t size, size_t alignment);
+
+		void* add_aligned_array_allocation(size_t size, size_t alignment);
+
+		// calloc. nullptr when count * size overflows.
+		void* add_zeroed_allocation(size_t count, size_t size);
+
+		// one record for release of old block and allocation of new one. block must be from add_allocation or reallocate.
+		// nullptr block allocates, 0 size frees and returns nullptr.
+		void* reallocate(void* block, size_t size);
+
+		// size is size of sized delete, 0 when unknown. freed bytes of sized frees are counted in real time by get_totals.
+		void remove_allocation(void* block, size_t size = 0);
+
+		void remove_array_allocation(void* block, size_t size = 0);
+
+		void remove_aligned_allocation(void* block, size_t size = 0);
+
+		void remove_aligned_array_allocation(void* block, size_t size = 0);
+
+		TracerStatistics get_tracer_statistics() const;
+
+		// call sites at the point of the call, most by sort_key first. at most count.
+		// tracer threads copy their counters when they reach the request in their rings, so they are never blocked.
+		// empty when trace is not running.
+		std::vector<SiteStatistics> query_top_sites(size_t count, ESiteSortKey sort_key) const;
+
+		// lock free and real time. allocations are counted by producer threads, frees as tracer threads apply them.
+		MemoryTotals get_totals() const;
+
+		// symbols of site's frames, innermost first. symbol_name_ is empty for a frame without symbol.
+		// each frame is resolved once and shared with reports.
+		std::vector<FrameSymbol> resolve_site_frames(const SiteStatistics& site_statistics);
+#pragma endregion
+
+		void* operator new[](size_t size) = delete;
+
+		void operator delete[](void* block) = delete;
+
+	private:
+		MemoryTracer();
+
+		~MemoryTracer();
+
+		static void init_instance();
+
+		static void finalize_instance();
+
+		static std::once_flag init_flag_;
+
+		static std::once_flag finalize_flag_;
+
+		static MemoryTracer* instance_;
+
+		void* operator new(size_t size);
+
+		void operator delete(void* block);
+
+		using OperationRing = EventRing<MemoryOperation, EVENT_RING_CAPACITY>;
+
+		struct TracerShard;
+
+		// releases thread's rings and counters when the thread exits.
+		struct ThreadExitGuard
+		{
+			~ThreadExitGuard();
+		};
+
+		// first call of each thread registers ThreadExitGuard's destructor.
+		static void register_thread_exit_guard();
+
+		// run first on helper threads, such as leak scan workers, so their allocations and exit aren't traced.
+		static void init_tracer_thread();
+
+		// allocate and free of an address always go to the same shard, so they stay in order.
+		TracerShard& get_shard(const void* address);
+
+		// thread's ring of the shard. nullptr after the thread released its rings.
+		OperationRing* get_thread_event_ring(TracerShard& tracer_shard);
+
+		// nullptr after the thread released its counters.
+		ThreadCounters* get_thread_counters();
+
+		// estimated size and count when sampling is enabled. same values as tracer threads add.
+		// is_added false undoes a count whose record could not be pushed.
+		void update_thread_counters(size_t size, bool is_free, bool is_added);
+
+		// publishes allocation of block which is already allocated. block can be nullptr.
+		void trace_allocation(void* block, size_t size);
+
+		// publishes free of block before it is released. size is 0 when unknown.
+		void trace_free(void* block, size_t size);
+
+		// true when the allocation is traced. (not skipped by sampler)
+		bool should_trace_allocation(void* block, size_t size);
+
+		// constant false without Policy::IS_SAMPLING_ENABLED, so sampler branches are compiled out.
+		bool is_sampling() const;
+
+		// captures and interns call stack, or degrades to StackTable::OVERFLOW_STACK_ID.
+		// always StackTable::OVERFLOW_STACK_ID without Policy::IS_STACK_CAPTURE_ENABLED.
+		StackId capture_stack(TracerShard& tracer_shard);
+
+		// raw block of allocate is stored right before returned block.
+		static void* allocate_aligned(void* (*alloc)(size_t), size_t size, size_t alignment);
+
+		static void free_aligned(void (*free)(void*), void* block);
+
+		// writer fills the record. returns false when trace is stopped while waiting for free slot.
+		// with EBufferPolicy::DropAndCount, a record of full ring is dropped and counted in dropped_count.
+		// nullptr always waits.
+		template <typename Writer>
+		bool push_operation(TracerShard& tracer_shard, const Writer& writer, std::atomic<size_t>* dropped_count = nullptr);
+
+		template <typename Writer>
+		bool write_operation(TracerShard& tracer_shard, OperationRing* ring, const Writer& writer, std::atomic<size_t>* dropped_count);
+
+		// EBufferPolicy::Degrade and thread's ring of the shard is above EVENT_RING_DEGRADE_COUNT.
+		bool should_degrade(TracerShard& tracer_shard);
+
+		// shard count is fixed at first start, because live allocations are kept across traces.
+		void create_tracer_shards();
+
+		void thread_update(TracerShard* tracer_shard);
+
+		// applies published records of all rings in timestamp order. returns false after stop operation.
+		bool drain_event_rings(TracerShard& tracer_shard, size_t& applied_operation_count);
+
+		// any ring has records which are not applied yet.
+		bool has_pending_operations(TracerShard& tracer_shard);
+
+		// sleeps until a producer publishes a record. first tracer thread also wakes up for snapshot triggers.
+		void park_tracer_thread(TracerShard& tracer_shard);
+
+		// any condition of snapshot_triggers_ is on.
+		bool has_snapshot_triggers() const;
+
+		// first tracer thread. bases of conditions are the values at start.
+		void reset_snapshot_triggers();
+
+		// first tracer thread. a fired trigger is handed to snapshot thread, which pushes the snapshot request.
+		// tracer thread can't push it itself, because it would wait for its own ring when the ring is full.
+		void check_snapshot_triggers();
+
+		// called by producer after publishing. only locks when tracer thread is parked.
+		void wake_tracer_thread(TracerShard& tracer_shard);
+
+		void refresh_drain_rings(TracerShard& tracer_shard);
+
+		void release_event_ring(TracerShard& tracer_shard, OperationRing* ring);
+
+		// returns false for stop operation.
+		bool apply_operation(TracerShard& tracer_shard, const MemoryOperation& memory_operation);
+
+		void apply_allocation(TracerShard& tracer_shard, const MemoryOperation& memory_operation);
+
+		void apply_free(TracerShard& tracer_shard, const MemoryOperation& memory_operation);
+
+		void apply_reallocate(TracerShard& tracer_shard, const MemoryOperation& memory_operation);
+
+		// lifetime of allocation ends at timestamp.
+		void release_allocation(TracerShard& tracer_shard, const Allocation& allocation, Timestamp timestamp);
+
+		StackStatistics& get_stack_statistics(TracerShard& tracer_shard, StackId stack_id);
+
+		void mark_stack_dirty(TracerShard& tracer_shard, StackId stack_id);
+
+		std::future<bool> push_snapshot_request(ESnapshotType snapshot_type, const TCHAR* baseline_name);
+
+		// every shard takes its part at the point of the request in its own rings.
+		// returns false without pushing when stop operations are pushed already. caller fails the request then.
+		bool push_snapshot_request_to_shards(SnapshotRequest* snapshot_request);
+
+		// after tracer thread of the shard exited. fails requests which are left in its rings.
+		void fail_pending_snapshot_requests(TracerShard& tracer_shard);
+
+		std::vector<SiteStatistics> query_sites(size_t count, ESiteSortKey sort_key);
+
+		// writes shard's totals for get_totals.
+		void publish_totals(TracerShard& tracer_shard);
+
+		// adds shard's live stacks or changed stacks to request.
+		void request_snapshot(TracerShard& tracer_shard, SnapshotRequest* snapshot_request);
+
+		// first pass copies shard's live allocations. second pass keeps unreachable blocks which are still live,
+		// and copies allocations since first pass.
+		void collect_leak_blocks(TracerShard& tracer_shard, const SnapshotRequest& snapshot_request);
+
+		// called once per shard. adds shard's stacks to request, last one queues request to snapshot thread.
+		// tracer_shard is nullptr when the request could not be pushed to that shard.
+		void complete_shard_snapshot(SnapshotRequest* snapshot_request, TracerShard* tracer_shard, bool is_valid);
+
+		// index and tracer state of report. snapshot_requests_mutex_ is held.
+		void prepare_report(SnapshotRequest& snapshot_request);
+
+		SnapshotStack make_snapshot_stack(const TracerShard& tracer_shard, StackId stack_id, const StackStatistics& compared_stack_statistics) const;
+
+		struct Baseline;
+
+		// nullptr when baseline is not marked.
+		Baseline* find_baseline(TracerShard& tracer_shard, const BaselineName& baseline_name);
+
+		void snapshot_thread_update();
+
+		// writes blocks which tracer threads filled, and symbols of their new stacks.
+		void event_log_thread_update();
+
+		// snapshot thread. takes a Full snapshot for trigger, unless trace is stopping.
+		void push_triggered_snapshot(ESnapshotTrigger trigger);
+
+		// snapshot thread. deletes oldest automatic reports over max_report_count_.
+		void retain_automatic_report(const TCHAR* snapshot_path);
+
+		// stops snapshot thread after pending requests are written.
+		void stop_snapshot_thread();
+
+		// estimated size and count are added when sampling is enabled.
+		void add_allocation_statistics(TracerShard& tracer_shard, StackId stack_id, size_t size);
+
+		void remove_allocation_statistics(TracerShard& tracer_shard, StackId stack_id, size_t size);
+
+		// only function that uses symbols. runs in snapshot thread. merges stacks of shards first.
+		bool make_snapshot(SnapshotRequest& snapshot_request);
+
+		void get_leak_roots(MemoryRangeList& roots) const;
+
+		// first scan of Leak in snapshot thread, then request goes through shards again.
+		// false when memory can't be scanned or trace is stopped.
+		bool scan_leaks(SnapshotRequest& snapshot_request);
+
+		// second scan, from roots and allocations since first pass. adds stacks of blocks which are not reached either.
+		bool make_leak_stacks(SnapshotRequest& snapshot_request);
+
+#pragma region internal
+		TCHAR report_path[MAX_PATH];
+
+		// empty when event log is off.
+		TCHAR event_log_path_[MAX_PATH];
+
+		std::atomic<bool> is_in_trace_;
+
+		// indexed by TracerShard::index_. created on first use.
+		static thread_local OperationRing* thread_event_rings_[MAX_TRACER_THREADS];
+
+		static thread_local bool is_thread_event_ring_retired_;
+
+		static thread_local ThreadCounters* thread_counters_;
+
+		// traced allocations counted by producer threads. read by get_totals.
+		ThreadCounterList thread_counter_list_;
+
+		static thread_local bool is_tracer_thread_;
+
+		// tracer threads. set before first start.
+		unsigned int tracer_thread_count_;
+
+		// created at first start, not changed after it.
+		std::vector<TracerShard*, memtracer::MemoryTracerAllocator<TracerShard*>> tracer_shards_;
+
+		// orders pushes of snapshot requests and stop operations, so a request is never behind stop in a ring.
+		std::mutex shard_requests_mutex_;
+
+		// stop operations are pushed. guarded by shard_requests_mutex_.
+		bool is_stop_pushed_;
+
+		// symbolizes and writes reports so that tracer threads keep draining.
+		std::thread snapshot_thread_;
+
+		std::mutex snapshot_requests_mutex_;
+
+		std::condition_variable snapshot_requests_condition_;
+
+		// guarded by snapshot_requests_mutex_.
+		std::deque<SnapshotRequest*, memtracer::MemoryTracerAllocator<SnapshotRequest*>> snapshot_requests_;
+
+		// guarded by snapshot_requests_mutex_.
+		bool is_snapshot_thread_stopping_;
+
+		// guarded by snapshot_requests_mutex_.
+		size_t snapshot_index;
+
+		// fired by first tracer thread, not pushed by snapshot thread yet. guarded by snapshot_requests_mutex_.
+		ESnapshotTrigger pending_trigger_;
+
+		// written by producer threads, read by tracer threads.
+		StackTable stack_table_;
+
+		AllocationSampler allocation_sampler_;
+
+		EBufferPolicy buffer_policy_;
+
+		// set before start.
+		SnapshotTriggers snapshot_triggers_;
+
+		// bases of snapshot triggers.
+		struct SnapshotTriggerState
+		{
+			Timestamp next_check_timestamp_;
+
+			// interval is counted from it. start or previous automatic snapshot.
+			Timestamp interval_start_timestamp_;
+
+			// 0 before first automatic snapshot, which isn't rate limited.
+			Timestamp last_snapshot_timestamp_;
+
+			// live bytes at start or previous automatic snapshot.
+			size_t growth_base_memory_allocation_;
+
+			size_t peak_base_memory_allocation_;
+
+			// live bytes were below threshold since previous threshold snapshot.
+			bool is_threshold_armed_;
+		};
+
+		// only written by first tracer thread.
+		SnapshotTriggerState snapshot_trigger_state_;
+
+		// from fire of a trigger until its report is written or failed. triggers don't fire meanwhile.
+		std::atomic<bool> is_triggered_snapshot_pending_;
+
+		// automatic reports of this process, oldest first. only used by snapshot thread.
+		std::deque<ReportPath, memtracer::MemoryTracerAllocator<ReportPath>> automatic_report_paths_;
+
+		// written by producer threads.
+		std::atomic<size_t> dropped_allocation_count_;
+
+		std::atomic<size_t> dropped_free_count_;
+
+		std::atomic<size_t> degraded_allocation_count_;
+
+		std::atomic<size_t> overflowed_sample_count_;
+
+		std::recursive_mutex memory_information_mutex_;
+
+		// set at start. allocation rates of reports are per traced time.
+		Timestamp start_timestamp_;
+
+		// time of previous traces. added at stop.
+		Timestamp traced_time_;
+
+		struct DrainCursor
+		{
+			OperationRing* ring_;
+
+			size_t readable_count_;
+
+			size_t offset_;
+
+			// ring has more records than this pass takes.
+			bool is_truncated_;
+		};
+
+		struct Baseline
+		{
+			BaselineName name_;
+
+			// copy on write. a stack is added with its baseline value when it changes first time after baseline.
+			std::unordered_map<StackId, StackStatistics, std::hash<StackId>, std::equal_to<StackId>, memtracer::MemoryTracerAllocator<std::pair<const StackId, StackStatistics>>> stack_statistics_;
+		};
+
+		// one tracer thread and the addresses which hash to it. each producer thread has a ring per shard.
+		struct TracerShard
+		{
+			TracerShard();
+
+			~TracerShard();
+
+			DELETE_CLASS_COPY_MOVE(TracerShard)
+
+			void* operator new(size_t size);
+
+			void operator delete(void* block);
+
+			size_t index_;
+
+			std::mutex event_rings_mutex_;
+
+			// guarded by event_rings_mutex_.
+			std::vector<OperationRing*, memtracer::MemoryTracerAllocator<OperationRing*>> event_rings_;
+
+			std::atomic<size_t> event_rings_version_;
+
+			// used by threads which already released their rings. (thread exit)
+			OperationRing* orphan_event_ring_;
+
+			std::mutex orphan_event_ring_mutex_;
+
+			std::thread tracer_thread_;
+
+			// set by tracer thread before it parks. producers read it after every publish.
+			std::atomic<bool> is_tracer_sleeping_;
+
+			std::mutex tracer_wakeup_mutex_;
+
+			std::condition_variable tracer_wakeup_condition_;
+
+			// written by tracer thread, read by any thread.
+			std::atomic<size_t> applied_operation_count_;
+
+			std::atomic<Timestamp> applied_timestamp_;
+
+			// seqlock of totals published after each drain pass. odd while tracer thread writes them.
+			std::atomic<size_t> totals_sequence_;
+
+			// frees which producers did not count. (cumulative - live - sized frees) - unmatched sized frees. wraps.
+			std::atomic<size_t> published_freed_memory_allocation_;
+
+			std::atomic<size_t> published_free_count_;
+
+			std::atomic<size_t> published_peak_memory_allocation_;
+
+#pragma region only_write_in_tracer_thread
+			std::vector<OperationRing*, memtracer::MemoryTracerAllocator<OperationRing*>> drain_rings_;
+
+			size_t drain_rings_version_;
+
+			std::vector<DrainCursor, memtracer::MemoryTracerAllocator<DrainCursor>> drain_cursors_;
+
+			// min heap of drain_cursors_ indices by next record's timestamp.
+			std::vector<size_t, memtracer::MemoryTracerAllocator<size_t>> drain_heap_;
+
+			// address to size and stack id of live allocations.
+			AllocationTable allocation_table_;
+
+			// dense, indexed by StackId.
+			std::vector<StackStatistics, memtracer::MemoryTracerAllocator<StackStatistics>> stack_statistics_;
+
+			size_t total_memory_allocation_;
+
+			size_t total_memory_allocation_count_;
+
+			// allocated since first start, freed or not.
+			size_t cumulative_memory_allocation_;
+
+			size_t cumulative_allocation_count_;
+
+			// highest total_memory_allocation_ in applied order.
+			size_t peak_memory_allocation_;
+
+			// sized frees, already counted by producers. estimated by sizes of the frees.
+			size_t sized_freed_memory_allocation_;
+
+			size_t sized_free_count_;
+
+			// sized frees which matched no live allocation. producers counted them, so they are taken back.
+			size_t unmatched_freed_memory_allocation_;
+
+			size_t unmatched_free_count_;
+
+			// dense, indexed by StackId. same size as stack_statistics_.
+			std::vector<StackLifetime, memtracer::MemoryTracerAllocator<StackLifetime>> stack_lifetimes_;
+
+			// dense, indexed by StackId. same size as stack_statistics_.
+			std::vector<StackSizeClasses, memtracer::MemoryTracerAllocator<StackSizeClasses>> stack_size_classes_;
+
+			// all stacks of this shard.
+			SizeClassStatistics size_class_statistics_;
+
+			// values at previous snapshot. dense, indexed by StackId.
+			std::vector<StackStatistics, memtracer::MemoryTracerAllocator<StackStatistics>> snapshot_stack_statistics_;
+
+			std::vector<bool, memtracer::MemoryTracerAllocator<bool>> is_stack_dirty_;
+
+			// stacks changed since previous snapshot.
+			std::vector<StackId, memtracer::MemoryTracerAllocator<StackId>> dirty_stack_ids_;
+
+			std::vector<Baseline, memtracer::MemoryTracerAllocator<Baseline>> baselines_;
+
+			// this shard's part of a request. added to request at once under snapshot_requests_mutex_.
+			std::vector<SnapshotStack, memtracer::MemoryTracerAllocator<SnapshotStack>> snapshot_stacks_;
+
+			// this shard's part of a Leak request.
+			LeakBlockList leak_blocks_;
+
+			LeakBlockList young_blocks_;
+
+			// open while event log is written.
+			EventLogStream event_log_stream_;
+#pragma endregion
+		};
+
+		// kept across snapshots. used by snapshot thread and resolve_site_frames.
+		SymbolCache symbol_cache_;
+
+		// guards symbol_cache_ and platform symbolization, which is not thread safe.
+		std::mutex symbol_cache_mutex_;
+
+		EventLogWriter event_log_writer_;
+
+		// runs while trace runs with event log.
+		std::thread event_log_thread_;
+#pragma endregion
+	};
+
+	template <typename Policy>
+	MemoryTracer<Policy>* MemoryTracer<Policy>::instance_ = nullptr;
+
+	template <typename Policy>
+	std::once_flag MemoryTracer<Policy>::init_flag_;
+
+	template <typename Policy>
+	std::once_flag MemoryTracer<Policy>::finalize_flag_;
+
+	template <typename Policy>
+	thread_local typename MemoryTracer<Policy>::OperationRing* MemoryTracer<Policy>::thread_event_rings_[MAX_TRACER_THREADS] = {};
+
+	template <typename Policy>
+	thread_local bool MemoryTracer<Policy>::is_thread_event_ring_retired_ = false;
+
+	template <typename Policy>
+	thread_local ThreadCounters* MemoryTracer<Policy>::thread_counters_ = nullptr;
+
+	template <typename Policy>
+	thread_local bool MemoryTracer<Policy>::is_tracer_thread_ = false;
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::start()
+	{
+		assert(instance_ != nullptr);
+
+		if (instance_->tracer_shards_.empty() == true)
+		{
+			instance_->create_tracer_shards();
+		}
+
+		for (TracerShard* tracer_shard : instance_->tracer_shards_)
+		{
+			tracer_shard->applied_operation_count_ = 0;
+		}
+
+		instance_->dropped_allocation_count_ = 0;
+
+		instance_->dropped_free_count_ = 0;
+
+		instance_->degraded_allocation_count_ = 0;
+
+		instance_->overflowed_sample_count_ = 0;
+
+		instance_->is_snapshot_thread_stopping_ = false;
+
+		instance_->pending_trigger_ = ESnapshotTrigger::None;
+
+		instance_->is_triggered_snapshot_pending_ = false;
+
+		{
+			std::lock_guard<std::mutex> lock(instance_->shard_requests_mutex_);
+
+			instance_->is_stop_pushed_ = false;
+		}
+
+		instance_->snapshot_thread_ = std::thread(&MemoryTracer<Policy>::snapshot_thread_update, this);
+
+		if (instance_->event_log_path_[0] != TEXT('\0'))
+		{
+			const uint64_t sampling_interval = instance_->is_sampling() == true ? instance_->allocation_sampler_.get_sampling_interval() : 0;
+
+			if (instance_->event_log_writer_.open(instance_->event_log_path_, static_cast<uint32_t>(instance_->tracer_shards_.size()), sampling_interval, get_timestamp()) == true)
+			{
+				for (TracerShard* tracer_shard : instance_->tracer_shards_)
+				{
+					tracer_shard->event_log_stream_.open(&instance_->event_log_writer_, static_cast<uint32_t>(tracer_shard->index_));
+				}
+
+				instance_->event_log_thread_ = std::thread(&MemoryTracer<Policy>::event_log_thread_update, this);
+			}
+			else
+			{
+				std::cerr << "Failed to open event log." << std::endl;
+			}
+		}
+
+		for (TracerShard* tracer_shard : instance_->tracer_shards_)
+		{
+			tracer_shard->tracer_thread_ = std::thread(&MemoryTracer<Policy>::thread_update, this, tracer_shard);
+		}
+
+		instance_->start_timestamp_ = get_timestamp();
+
+		instance_->is_in_trace_ = true;
+	}
+
+	template <typename Policy>
+	std::future<bool> MemoryTracer<Policy>::take_snapshot() const
+	{
+		assert(instance_ != nullptr);
+
+		return instance_->push_snapshot_request(ESnapshotType::Full, nullptr);
+	}
+
+	template <typename Policy>
+	std::future<bool> MemoryTracer<Policy>::take_diff_snapshot(const TCHAR* baseline_name) const
+	{
+		assert(instance_ != nullptr);
+
+		return instance_->push_snapshot_request(ESnapshotType::Diff, baseline_name);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::mark_baseline(const TCHAR* baseline_name)
+	{
+		assert(instance_ != nullptr);
+
+		assert(baseline_name != nullptr);
+
+		instance_->push_snapshot_request(ESnapshotType::Baseline, baseline_name);
+	}
+
+	template <typename Policy>
+	std::future<bool> MemoryTracer<Policy>::take_leak_snapshot() const
+	{
+		assert(instance_ != nullptr);
+
+		if (instance_->is_sampling() == true)
+		{
+			std::cerr << "Leak scan needs all allocations traced." << std::endl;
+
+			std::promise<bool> promise;
+
+			promise.set_value(false);
+
+			return promise.get_future();
+		}
+
+		return instance_->push_snapshot_request(ESnapshotType::Leak, nullptr);
+	}
+
+	template <typename Policy>
+	std::future<bool> MemoryTracer<Policy>::push_snapshot_request(ESnapshotType snapshot_type, const TCHAR* baseline_name)
+	{
+		SnapshotRequest* snapshot_request = new SnapshotRequest();
+
+		snapshot_request->snapshot_type_ = snapshot_type;
+
+		if (baseline_name != nullptr)
+		{
+			snapshot_request->baseline_name_ = baseline_name;
+		}
+
+		std::future<bool> future = snapshot_request->promise_.get_future();
+
+		if (is_in_trace_ == false || is_tracer_thread_ == true)
+		{
+			snapshot_request->promise_.set_value(false);
+
+			delete snapshot_request;
+
+			return future;
+		}
+
+		if (push_snapshot_request_to_shards(snapshot_request) == false)
+		{
+			snapshot_request->promise_.set_value(false);
+
+			delete snapshot_request;
+		}
+
+		return future;
+	}
+
+	template <typename Policy>
+	bool MemoryTracer<Policy>::push_snapshot_request_to_shards(SnapshotRequest* snapshot_request)
+	{
+		// held while pushing, so stop() can't put its operations in front of some shards' part.
+		std::lock_guard<std::mutex> lock(shard_requests_mutex_);
+
+		if (is_stop_pushed_ == true)
+		{
+			return false;
+		}
+
+		snapshot_request->pending_shard_count_ = tracer_shards_.size();
+
+		for (TracerShard* tracer_shard : tracer_shards_)
+		{
+			const bool is_pushed = push_operation(*tracer_shard, [snapshot_request](MemoryOperation& memory_operation)
+				{
+					memory_operation.operation_type_ = EOperationType::Snapshot;
+
+					memory_operation.address_ = snapshot_request;
+				});
+
+			if (is_pushed == false)
+			{
+				complete_shard_snapshot(snapshot_request, nullptr, false);
+			}
+		}
+
+		return true;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::fail_pending_snapshot_requests(TracerShard& tracer_shard)
+	{
+		std::lock_guard<std::mutex> lock(tracer_shard.event_rings_mutex_);
+
+		for (OperationRing* ring : tracer_shard.event_rings_)
+		{
+			const size_t readable_count = ring->get_readable_count();
+
+			for (size_t i = 0; i < readable_count; i++)
+			{
+				MemoryOperation& memory_operation = ring->get_readable(i);
+
+				if (memory_operation.operation_type_ != EOperationType::Snapshot)
+				{
+					continue;
+				}
+
+				// other records stay for next start. this one is skipped by then.
+				memory_operation.operation_type_ = EOperationType::None;
+
+				complete_shard_snapshot(static_cast<SnapshotRequest*>(memory_operation.address_), nullptr, false);
+			}
+		}
+	}
+
+	template <typename Policy>
+	std::vector<SiteStatistics> MemoryTracer<Policy>::query_sites(size_t count, ESiteSortKey sort_key)
+	{
+		std::vector<SiteStatistics> site_statistics;
+
+		if (is_in_trace_ == false || is_tracer_thread_ == true)
+		{
+			return site_statistics;
+		}
+
+		SnapshotRequest* snapshot_request = new SnapshotRequest();
+
+		snapshot_request->snapshot_type_ = ESnapshotType::Query;
+
+		// merge_snapshot_stacks rounds estimates of sampled stacks.
+		snapshot_request->sampling_interval_ = is_sampling() == true ? allocation_sampler_.get_sampling_interval() : 0;
+
+		std::future<bool> future = snapshot_request->promise_.get_future();
+
+		// trace is stopping. nobody would complete the request.
+		if (push_snapshot_request_to_shards(snapshot_request) == false)
+		{
+			delete snapshot_request;
+
+			return site_statistics;
+		}
+
+		if (future.get() == true)
+		{
+			snapshot_request->merge_snapshot_stacks();
+
+			const auto get_key = [sort_key](const SnapshotStack& snapshot_stack) -> size_t
+				{
+					switch (sort_key)
+					{
+					case ESiteSortKey::LiveCount: return snapshot_stack.stack_statistics_.memory_allocation_count_;
+					case ESiteSortKey::TotalBytes: return snapshot_stack.stack_lifetime_.total_memory_allocation_;
+					case ESiteSortKey::TotalCount: return snapshot_stack.stack_lifetime_.total_allocation_count_;
+					default: return snapshot_stack.stack_statistics_.memory_allocation_;
+					}
+				};
+
+			auto& snapshot_stacks = snapshot_request->snapshot_stacks_;
+
+			auto end = std::remove_if(snapshot_stacks.begin(), snapshot_stacks.end(), [&get_key](const SnapshotStack& snapshot_stack)
+				{
+					return get_key(snapshot_stack) == 0;
+				});
+
+			snapshot_stacks.erase(end, snapshot_stacks.end());
+
+			const size_t site_count = (std::min)(count, snapshot_stacks.size());
+
+			std::partial_sort(snapshot_stacks.begin(), snapshot_stacks.begin() + site_count, snapshot_stacks.end(), [&get_key](const SnapshotStack& first, const SnapshotStack& second)
+				{
+					const size_t first_key = get_key(first);
+
+					const size_t second_key = get_key(second);
+
+					return first_key != second_key ? first_key > second_key : first.stack_id_ < second.stack_id_;
+				});
+
+			site_statistics.resize(site_count);
+
+			for (size_t i = 0; i < site_count; i++)
+			{
+				const SnapshotStack& snapshot_stack = snapshot_stacks[i];
+
+				SiteStatistics& site = site_statistics[i];
+
+				site.stack_id_ = snapshot_stack.stack_id_;
+
+				site.memory_allocation_ = snapshot_stack.stack_statistics_.memory_allocation_;
+
+				site.memory_allocation_count_ = snapshot_stack.stack_statistics_.memory_allocation_count_;
+
+				site.total_memory_allocation_ = snapshot_stack.stack_lifetime_.total_memory_allocation_;
+
+				site.total_allocation_count_ = snapshot_stack.stack_lifetime_.total_allocation_count_;
+
+				const StackBackTrace& stack_back_trace = stack_table_.get_stack_back_trace(snapshot_stack.stack_id_);
+
+				site.frames_.resize(stack_back_trace.get_frame_count());
+
+				for (FrameCount frame = 0; frame < stack_back_trace.get_frame_count(); frame++)
+				{
+					site.frames_[frame] = stack_back_trace.get_stack_frame(frame);
+				}
+			}
+		}
+
+		delete snapshot_request;
+
+		return site_statistics;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::stop()
+	{
+		assert(instance_ != nullptr);
+
+		if (instance_->tracer_shards_.empty() == false && instance_->tracer_shards_[0]->tracer_thread_.joinable() == true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(instance_->shard_requests_mutex_);
+
+				instance_->is_stop_pushed_ = true;
+
+				for (TracerShard* tracer_shard : instance_->tracer_shards_)
+				{
+					instance_->push_operation(*tracer_shard, [](MemoryOperation& memory_operation)
+						{
+							memory_operation.operation_type_ = EOperationType::Stop;
+						});
+				}
+			}
+
+			for (TracerShard* tracer_shard : instance_->tracer_shards_)
+			{
+				tracer_shard->tracer_thread_.join();
+			}
+
+			// a request which tracer thread didn't reach before stop would never be completed.
+			for (TracerShard* tracer_shard : instance_->tracer_shards_)
+			{
+				instance_->fail_pending_snapshot_requests(*tracer_shard);
+			}
+
+			instance_->is_in_trace_ = false;
+
+			instance_->traced_time_ += get_timestamp() - instance_->start_timestamp_;
+
+			if (instance_->event_log_thread_.joinable() == true)
+			{
+				// tracer threads submitted their last blocks before they exited.
+				for (TracerShard* tracer_shard : instance_->tracer_shards_)
+				{
+					tracer_shard->event_log_stream_.close();
+				}
+
+				instance_->event_log_writer_.request_close(get_timestamp());
+
+				instance_->event_log_thread_.join();
+			}
+
+			instance_->stop_snapshot_thread();
+		}
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::set_report_path(const TCHAR* path)
+	{
+		assert(instance_ != nullptr);
+
+		const tstring report_path = path;
+
+		const size_t length = (std::min)(report_path.length(), static_cast<size_t>(MAX_PATH - 1));
+
+		std::copy(report_path.begin(), report_path.begin() + length, instance_->report_path);
+
+		instance_->report_path[length] = TEXT('\0');
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::set_event_log_path(const TCHAR* path)
+	{
+		assert(instance_ != nullptr);
+
+		assert(instance_->is_in_trace_ == false);
+
+		const tstring event_log_path = path != nullptr ? path : TEXT("");
+
+		const size_t length = (std::min)(event_log_path.length(), static_cast<size_t>(MAX_PATH - 1));
+
+		std::copy(event_log_path.begin(), event_log_path.begin() + length, instance_->event_log_path_);
+
+		instance_->event_log_path_[length] = TEXT('\0');
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::set_sampling_interval(size_t sampling_interval)
+	{
+		assert(instance_ != nullptr);
+
+		assert(instance_->is_in_trace_ == false);
+
+		instance_->allocation_sampler_.set_sampling_interval(sampling_interval);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::set_buffer_policy(EBufferPolicy buffer_policy)
+	{
+		assert(instance_ != nullptr);
+
+		assert(instance_->is_in_trace_ == false);
+
+		instance_->buffer_policy_ = buffer_policy;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::set_snapshot_triggers(const SnapshotTriggers& snapshot_triggers)
+	{
+		assert(instance_ != nullptr);
+
+		assert(instance_->is_in_trace_ == false);
+
+		instance_->snapshot_triggers_ = snapshot_triggers;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::set_tracer_thread_count(unsigned int tracer_thread_count)
+	{
+		assert(instance_ != nullptr);
+
+		assert(instance_->tracer_shards_.empty() == true);
+
+		assert(tracer_thread_count >= 1 && tracer_thread_count <= MAX_TRACER_THREADS);
+
+		instance_->tracer_thread_count_ = (std::min)((std::max)(tracer_thread_count, 1u), MAX_TRACER_THREADS);
+	}
+
+	template <typename Policy>
+	MemoryTracer<Policy>* MemoryTracer<Policy>::get_instance()
+	{
+		std::call_once(init_flag_, &MemoryTracer<Policy>::init_instance);
+
+		return instance_;
+	}
+
+	template <typename Policy>
+	void* MemoryTracer<Policy>::add_allocation(size_t size)
+	{
+		assert(instance_ != nullptr);
+
+		void* block = Policy::allocate(size);
+
+		instance_->trace_allocation(block, size);
+
+		return block;
+	}
+
+	template <typename Policy>
+	void* MemoryTracer<Policy>::add_array_allocation(size_t size)
+	{
+		assert(instance_ != nullptr);
+
+		void* block = Policy::allocate_array(size);
+
+		instance_->trace_allocation(block, size);
+
+		return block;
+	}
+
+	template <typename Policy>
+	void* MemoryTracer<Policy>::add_aligned_allocation(size_t size, size_t alignment)
+	{
+		assert(instance_ != nullptr);
+
+		void* block = allocate_aligned(&Policy::allocate, size, alignment);
+
+		instance_->trace_allocation(block, size);
+
+		return block;
+	}
+
+	template <typename Policy>
+	void* MemoryTracer<Policy>::add_aligned_array_allocation(size_t size, size_t alignment)
+	{
+		assert(instance_ != nullptr);
+
+		void* block = allocate_aligned(&Policy::allocate_array, size, alignment);
+
+		instance_->trace_allocation(block, size);
+
+		return block;
+	}
+
+	template <typename Policy>
+	void* MemoryTracer<Policy>::add_zeroed_allocation(size_t count, size_t size)
+	{
+		assert(instance_ != nullptr);
+
+		if (size != 0 && count > SIZE_MAX / size)
+		{
+			return nullptr;
+		}
+
+		void* block = Policy::allocate(count * size);
+
+		if (block != nullptr)
+		{
+			std::memset(block, 0, count * size);
+		}
+
+		instance_->trace_allocation(block, count * size);
+
+		return block;
+	}
+
+	template <typename Policy>
+	void* MemoryTracer<Policy>::reallocate(void* block, size_t size)
+	{
+		assert(instance_ != nullptr);
+
+		if (block == nullptr)
+		{
+			return add_allocation(size);
+		}
+
+		if (size == 0)
+		{
+			remove_allocation(block);
+
+			return nullptr;
+		}
+
+		const bool is_tracing = instance_->is_in_trace_ == true && is_tracer_thread_ == false;
+
+		const bool is_sampled = instance_->is_sampling();
+
+		// unmarked before reallocate releases the address. other thread can mark it right after.
+		const bool is_block_traced = is_tracing == true && (is_sampled == false || instance_->allocation_sampler_.unmark_sampled(block) == true);
+
+		void* new_block = Policy::reallocate(block, size);
+
+		if (new_block == nullptr)
+		{
+			// old block is still live. when its bucket filled up meanwhile, tracer releases it, because its free would be skipped.
+			if (is_block_traced == true && is_sampled == true && instance_->allocation_sampler_.mark_sampled(block) == false)
+			{
+				instance_->overflowed_sample_count_.fetch_add(1, std::memory_order_relaxed);
+
+				instance_->push_operation(instance_->get_shard(block), [block](MemoryOperation& memory_operation)
+					{
+						memory_operation.operation_type_ = EOperationType::Free;
+
+						memory_operation.address_ = block;
+
+						memory_operation.size_ = 0;
+					}, &instance_->dropped_free_count_);
+			}
+
+			return nullptr;
+		}
+
+		if (is_tracing == false)
+		{
+			return new_block;
+		}
+
+		const bool is_new_block_traced = instance_->should_trace_allocation(new_block, size);
+
+		TracerShard& tracer_shard = instance_->get_shard(new_block);
+
+		TracerShard& block_tracer_shard = instance_->get_shard(block);
+
+		// one record releases old block and allocates new one, unless they are in different shards.
+		const bool is_one_record = is_block_traced == true && is_new_block_traced == true && &tracer_shard == &block_tracer_shard;
+
+		if (is_block_traced == true && is_one_record == false)
+		{
+			instance_->push_operation(block_tracer_shard, [block](MemoryOperation& memory_operation)
+				{
+					memory_operation.operation_type_ = EOperationType::Reallocate;
+
+					memory_operation.address_ = nullptr;
+
+					memory_operation.previous_address_ = block;
+				}, &instance_->dropped_free_count_);
+		}
+
+		if (is_new_block_traced == true)
+		{
+			const StackId stack_id = instance_->capture_stack(tracer_shard);
+
+			void* previous_address = is_one_record == true ? block : nullptr;
+
+			instance_->update_thread_counters(size, false, true);
+
+			const bool is_pushed = instance_->push_operation(tracer_shard, [new_block, previous_address, size, stack_id](MemoryOperation& memory_operation)
+				{
+					memory_operation.operation_type_ = EOperationType::Reallocate;
+
+					memory_operation.address_ = new_block;
+
+					memory_operation.previous_address_ = previous_address;
+
+					memory_operation.size_ = size;
+
+					memory_operation.stack_id_ = stack_id;
+				}, &instance_->dropped_allocation_count_);
+
+			if (is_pushed == false)
+			{
+				instance_->update_thread_counters(size, false, false);
+			}
+		}
+
+		return new_block;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::remove_allocation(void* block, size_t size)
+	{
+		assert(instance_ != nullptr);
+
+		instance_->trace_free(block, size);
+
+		Policy::deallocate(block);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::remove_array_allocation(void* block, size_t size)
+	{
+		assert(instance_ != nullptr);
+
+		instance_->trace_free(block, size);
+
+		Policy::deallocate_array(block);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::remove_aligned_allocation(void* block, size_t size)
+	{
+		assert(instance_ != nullptr);
+
+		instance_->trace_free(block, size);
+
+		free_aligned(&Policy::deallocate, block);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::remove_aligned_array_allocation(void* block, size_t size)
+	{
+		assert(instance_ != nullptr);
+
+		instance_->trace_free(block, size);
+
+		free_aligned(&Policy::deallocate_array, block);
+	}
+
+	template <typename Policy>
+	TracerStatistics MemoryTracer<Policy>::get_tracer_statistics() const
+	{
+		assert(instance_ != nullptr);
+
+		TracerStatistics tracer_statistics;
+
+		tracer_statistics.applied_operation_count_ = 0;
+
+		tracer_statistics.applied_timestamp_ = 0;
+
+		for (const TracerShard* tracer_shard : tracer_shards_)
+		{
+			tracer_statistics.applied_operation_count_ += tracer_shard->applied_operation_count_.load(std::memory_order_relaxed);
+
+			tracer_statistics.applied_timestamp_ = (std::max)(tracer_statistics.applied_timestamp_, tracer_shard->applied_timestamp_.load(std::memory_order_relaxed));
+		}
+
+		tracer_statistics.buffer_statistics_.dropped_allocation_count_ = dropped_allocation_count_.load(std::memory_order_relaxed);
+
+		tracer_statistics.buffer_statistics_.dropped_free_count_ = dropped_free_count_.load(std::memory_order_relaxed);
+
+		tracer_statistics.buffer_statistics_.degraded_allocation_count_ = degraded_allocation_count_.load(std::memory_order_relaxed);
+
+		tracer_statistics.overflowed_sample_count_ = overflowed_sample_count_.load(std::memory_order_relaxed);
+
+		tracer_statistics.arena_statistics_ = get_arena_statistics();
+
+		return tracer_statistics;
+	}
+
+	template <typename Policy>
+	std::vector<SiteStatistics> MemoryTracer<Policy>::query_top_sites(size_t count, ESiteSortKey sort_key) const
+	{
+		assert(instance_ != nullptr);
+
+		return instance_->query_sites(count, sort_key);
+	}
+
+	template <typename Policy>
+	MemoryTotals MemoryTracer<Policy>::get_totals() const
+	{
+		assert(instance_ != nullptr);
+
+		MemoryTotals memory_totals = { 0, 0, 0, 0, 0, 0 };
+
+		size_t freed_memory_allocation = 0;
+
+		size_t free_count = 0;
+
+		// frees are read first. allocations of applied frees are counted before them, so live values don't wrap.
+		for (const TracerShard* tracer_shard : tracer_shards_)
+		{
+			size_t shard_freed_memory_allocation = 0;
+
+			size_t shard_free_count = 0;
+
+			size_t shard_peak_memory_allocation = 0;
+
+			size_t sequence = 0;
+
+			do
+			{
+				sequence = tracer_shard->totals_sequence_.load(std::memory_order_acquire);
+
+				shard_freed_memory_allocation = tracer_shard->published_freed_memory_allocation_.load(std::memory_order_relaxed);
+
+				shard_free_count = tracer_shard->published_free_count_.load(std::memory_order_relaxed);
+
+				shard_peak_memory_allocation = tracer_shard->published_peak_memory_allocation_.load(std::memory_order_relaxed);
+
+				// values are read before sequence is read again.
+				std::atomic_thread_fence(std::memory_order_acquire);
+			} while ((sequence & 1) != 0 || sequence != tracer_shard->totals_sequence_.load(std::memory_order_relaxed));
+
+			freed_memory_allocation += shard_freed_memory_allocation;
+
+			free_count += shard_free_count;
+
+			memory_totals.peak_memory_allocation_upper_bound_ += shard_peak_memory_allocation;
+		}
+
+		size_t sized_freed_memory_allocation = 0;
+
+		size_t sized_free_count = 0;
+
+		thread_counter_list_.get_sums(memory_totals.total_memory_allocation_, memory_totals.total_allocation_count_, sized_freed_memory_allocation, sized_free_count);
+
+		// published values wrap when unmatched sized frees are more than others, so difference is taken as signed.
+		const long long memory_allocation = static_cast<long long>(memory_totals.total_memory_allocation_ - sized_freed_memory_allocation - freed_memory_allocation);
+
+		const long long memory_allocation_count = static_cast<long long>(memory_totals.total_allocation_count_ - sized_free_count - free_count);
+
+		memory_totals.memory_allocation_ = memory_allocation > 0 ? static_cast<size_t>(memory_allocation) : 0;
+
+		memory_totals.memory_allocation_count_ = memory_allocation_count > 0 ? static_cast<size_t>(memory_allocation_count) : 0;
+
+		// live values include allocations which tracer threads didn't apply yet.
+		memory_totals.peak_memory_allocation_upper_bound_ = (std::max)(memory_totals.peak_memory_allocation_upper_bound_, memory_totals.memory_allocation_);
+
+		if (is_sampling() == true)
+		{
+			memory_totals.memory_allocation_ = round_estimate(memory_totals.memory_allocation_);
+
+			memory_totals.memory_allocation_count_ = round_estimate(memory_totals.memory_allocation_count_);
+
+			memory_totals.total_memory_allocation_ = round_estimate(memory_totals.total_memory_allocation_);
+
+			memory_totals.total_allocation_count_ = round_estimate(memory_totals.total_allocation_count_);
+
+			memory_totals.peak_memory_allocation_upper_bound_ = round_estimate(memory_totals.peak_memory_allocation_upper_bound_);
+		}
+
+		memory_totals.timestamp_ = get_timestamp();
+
+		return memory_totals;
+	}
+
+	template <typename Policy>
+	std::vector<FrameSymbol> MemoryTracer<Policy>::resolve_site_frames(const SiteStatistics& site_statistics)
+	{
+		assert(instance_ != nullptr);
+
+		std::vector<FrameSymbol> frame_symbols(site_statistics.frames_.size(), FrameSymbol{ nullptr, tstring(), tstring(), 0, false });
+
+		std::lock_guard<std::mutex> lock(instance_->symbol_cache_mutex_);
+
+		// strings of cache live as long as the cache, like those resolved by snapshot thread.
+		const bool was_tracer_thread = is_tracer_thread_;
+
+		is_tracer_thread_ = true;
+
+		for (void* frame : site_statistics.frames_)
+		{
+			instance_->symbol_cache_.add_frame(frame);
+		}
+
+		instance_->symbol_cache_.resolve_pending_frames();
+
+		is_tracer_thread_ = was_tracer_thread;
+
+		for (size_t i = 0; i < frame_symbols.size(); i++)
+		{
+			const FrameSymbol* frame_symbol = instance_->symbol_cache_.find_frame_symbol(site_statistics.frames_[i]);
+
+			if (frame_symbol != nullptr)
+			{
+				frame_symbols[i] = *frame_symbol;
+			}
+		}
+
+		return frame_symbols;
+	}
+
+	template <typename Policy>
+	MemoryTracer<Policy>::MemoryTracer() :
+		report_path(DEFAULT_REPORT_PATH)
+		, event_log_path_()
+		, is_in_trace_(false)
+		, thread_counter_list_()
+		, tracer_thread_count_(1)
+		, tracer_shards_()
+		, shard_requests_mutex_()
+		, is_stop_pushed_(false)
+		, snapshot_thread_()
+		, snapshot_requests_mutex_()
+		, snapshot_requests_condition_()
+		, snapshot_requests_()
+		, is_snapshot_thread_stopping_(false)
+		, snapshot_index(0)
+		, pending_trigger_(ESnapshotTrigger::None)
+		, stack_table_()
+		, allocation_sampler_()
+		, buffer_policy_(EBufferPolicy::Block)
+		, snapshot_triggers_()
+		, snapshot_trigger_state_()
+		, is_triggered_snapshot_pending_(false)
+		, automatic_report_paths_()
+		, dropped_allocation_count_(0)
+		, dropped_free_count_(0)
+		, degraded_allocation_count_(0)
+		, overflowed_sample_count_(0)
+		, start_timestamp_(0)
+		, traced_time_(0)
+		, symbol_cache_()
+		, symbol_cache_mutex_()
+		, event_log_writer_(stack_table_, symbol_cache_, symbol_cache_mutex_)
+		, event_log_thread_()
+	{
+	}
+
+	template <typename Policy>
+	MemoryTracer<Policy>::~MemoryTracer()
+	{
+		for (TracerShard* tracer_shard : tracer_shards_)
+		{
+			delete tracer_shard;
+		}
+	}
+
+	template <typename Policy>
+	MemoryTracer<Policy>::TracerShard::TracerShard() :
+		index_(0)
+		, event_rings_mutex_()
+		, event_rings_()
+		, event_rings_version_(0)
+		, orphan_event_ring_(new OperationRing())
+		, orphan_event_ring_mutex_()
+		, tracer_thread_()
+		, is_tracer_sleeping_(false)
+		, tracer_wakeup_mutex_()
+		, tracer_wakeup_condition_()
+		, applied_operation_count_(0)
+		, applied_timestamp_(0)
+		, totals_sequence_(0)
+		, published_freed_memory_allocation_(0)
+		, published_free_count_(0)
+		, published_peak_memory_allocation_(0)
+		, drain_rings_()
+		, drain_rings_version_(0)
+		, drain_cursors_()
+		, drain_heap_()
+		, allocation_table_()
+		, stack_statistics_()
+		, total_memory_allocation_(0)
+		, total_memory_allocation_count_(0)
+		, cumulative_memory_allocation_(0)
+		, cumulative_allocation_count_(0)
+		, peak_memory_allocation_(0)
+		, sized_freed_memory_allocation_(0)
+		, sized_free_count_(0)
+		, unmatched_freed_memory_allocation_(0)
+		, unmatched_free_count_(0)
+		, stack_lifetimes_()
+		, stack_size_classes_()
+		, size_class_statistics_()
+		, snapshot_stack_statistics_()
+		, is_stack_dirty_()
+		, dirty_stack_ids_()
+		, baselines_()
+		, snapshot_stacks_()
+		, leak_blocks_()
+		, young_blocks_()
+		, event_log_stream_()
+	{
+		event_rings_.push_back(orphan_event_ring_);
+
+		event_rings_version_ = 1;
+	}
+
+	template <typename Policy>
+	MemoryTracer<Policy>::TracerShard::~TracerShard()
+	{
+		for (OperationRing* ring : event_rings_)
+		{
+			delete ring;
+		}
+	}
+
+	template <typename Policy>
+	void* MemoryTracer<Policy>::TracerShard::operator new(size_t size)
+	{
+		return memtracer_alloc(size);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::TracerShard::operator delete(void* block)
+	{
+		memtracer_free(block);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::create_tracer_shards()
+	{
+		for (unsigned int i = 0; i < tracer_thread_count_; i++)
+		{
+			TracerShard* tracer_shard = new TracerShard();
+
+			tracer_shard->index_ = i;
+
+			tracer_shards_.push_back(tracer_shard);
+		}
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::init_instance()
+	{
+		instance_ = new MemoryTracer<Policy>();
+
+		if (initialize_symbols() == false)
+		{
+			std::cerr << "Failed to initialize symbols." << std::endl;
+		}
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::finalize_instance()
+	{
+		finalize_symbols();
+
+		delete instance_;
+	}
+
+	template <typename Policy>
+	void* MemoryTracer<Policy>::operator new(size_t size)
+	{
+		return memtracer_alloc(sizeof(MemoryTracer<Policy>));
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::operator delete(void* block)
+	{
+		memtracer_free(instance_);
+	}
+
+	template <typename Policy>
+	MemoryTracer<Policy>::ThreadExitGuard::~ThreadExitGuard()
+	{
+		for (OperationRing*& ring : thread_event_rings_)
+		{
+			if (ring != nullptr)
+			{
+				ring->retire();
+
+				ring = nullptr;
+			}
+		}
+
+		is_thread_event_ring_retired_ = true;
+
+		if (thread_counters_ != nullptr)
+		{
+			instance_->thread_counter_list_.release(thread_counters_);
+
+			thread_counters_ = nullptr;
+		}
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::register_thread_exit_guard()
+	{
+		static thread_local ThreadExitGuard thread_exit_guard;
+
+		(void)thread_exit_guard;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::init_tracer_thread()
+	{
+		is_tracer_thread_ = true;
+	}
+
+	template <typename Policy>
+	typename MemoryTracer<Policy>::TracerShard& MemoryTracer<Policy>::get_shard(const void* address)
+	{
+		if (tracer_shards_.size() == 1)
+		{
+			return *tracer_shards_[0];
+		}
+
+		// fibonacci hashing, then high bits are scaled to shard count. low bits of address are zero by alignment.
+		const unsigned long long hash = (static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(address)) * 0x9E3779B97F4A7C15ull) >> 32;
+
+		return *tracer_shards_[static_cast<size_t>((hash * tracer_shards_.size()) >> 32)];
+	}
+
+	template <typename Policy>
+	typename MemoryTracer<Policy>::OperationRing* MemoryTracer<Policy>::get_thread_event_ring(TracerShard& tracer_shard)
+	{
+		OperationRing*& thread_event_ring = thread_event_rings_[tracer_shard.index_];
+
+		if (thread_event_ring != nullptr)
+		{
+			return thread_event_ring;
+		}
+
+		if (is_thread_event_ring_retired_ == true)
+		{
+			return nullptr;
+		}
+
+		register_thread_exit_guard();
+
+		OperationRing* ring = new OperationRing();
+
+		{
+			std::lock_guard<std::mutex> lock(tracer_shard.event_rings_mutex_);
+
+			tracer_shard.event_rings_.push_back(ring);
+
+			tracer_shard.event_rings_version_.fetch_add(1, std::memory_order_release);
+		}
+
+		thread_event_ring = ring;
+
+		return ring;
+	}
+
+	template <typename Policy>
+	ThreadCounters* MemoryTracer<Policy>::get_thread_counters()
+	{
+		if (thread_counters_ != nullptr || is_thread_event_ring_retired_ == true)
+		{
+			return thread_counters_;
+		}
+
+		register_thread_exit_guard();
+
+		thread_counters_ = thread_counter_list_.acquire();
+
+		return thread_counters_;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::update_thread_counters(size_t size, bool is_free, bool is_added)
+	{
+		const bool is_sampled = is_sampling();
+
+		const size_t estimated_size = is_sampled == true ? allocation_sampler_.get_estimated_size(size) : size;
+
+		const size_t estimated_count = is_sampled == true ? allocation_sampler_.get_estimated_count(size) : 1;
+
+		ThreadCounters* thread_counters = get_thread_counters();
+
+		if (thread_counters == nullptr)
+		{
+			thread_counter_list_.add_shared(is_free, is_added == true ? estimated_size : 0 - estimated_size, is_added == true ? estimated_count : 0 - estimated_count);
+		}
+		else
+		{
+			thread_counters->add(is_free, is_added == true ? estimated_size : 0 - estimated_size, is_added == true ? estimated_count : 0 - estimated_count);
+		}
+	}
+
+	template <typename Policy>
+	MEMTRACER_FORCEINLINE void MemoryTracer<Policy>::trace_allocation(void* block, size_t size)
+	{
+		if (is_in_trace_ == false || is_tracer_thread_ == true || should_trace_allocation(block, size) == false)
+		{
+			return;
+		}
+
+		TracerShard& tracer_shard = get_shard(block);
+
+		const StackId stack_id = capture_stack(tracer_shard);
+
+		// counted before publishing, so totals always include the allocations tracer threads applied.
+		update_thread_counters(size, false, true);
+
+		const bool is_pushed = push_operation(tracer_shard, [block, size, stack_id](MemoryOperation& memory_operation)
+			{
+				memory_operation.operation_type_ = EOperationType::Allocate;
+
+				memory_operation.address_ = block;
+
+				memory_operation.size_ = size;
+
+				memory_operation.stack_id_ = stack_id;
+			}, &dropped_allocation_count_);
+
+		if (is_pushed == false)
+		{
+			update_thread_counters(size, false, false);
+		}
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::trace_free(void* block, size_t size)
+	{
+		// publish before free. address can be reused by other thread right after Free.
+		if (block == nullptr || is_in_trace_ == false || is_tracer_thread_ == true ||
+			(is_sampling() == true && allocation_sampler_.unmark_sampled(block) == false))
+		{
+			return;
+		}
+
+		// sized free is counted right away. tracer thread takes back the ones which match no live allocation.
+		if (size != 0)
+		{
+			update_thread_counters(size, true, true);
+		}
+
+		const bool is_pushed = push_operation(get_shard(block), [block, size](MemoryOperation& memory_operation)
+			{
+				memory_operation.operation_type_ = EOperationType::Free;
+
+				memory_operation.address_ = block;
+
+				memory_operation.size_ = size;
+			}, &dropped_free_count_);
+
+		if (is_pushed == false && size != 0)
+		{
+			update_thread_counters(size, true, false);
+		}
+	}
+
+	template <typename Policy>
+	bool MemoryTracer<Policy>::should_trace_allocation(void* block, size_t size)
+	{
+		if (block == nullptr)
+		{
+			return false;
+		}
+
+		if (is_sampling() == false)
+		{
+			return true;
+		}
+
+		if (allocation_sampler_.should_sample(size) == false)
+		{
+			return false;
+		}
+
+		// bucket of the address is full. the picked sample is lost, so it is counted.
+		if (allocation_sampler_.mark_sampled(block) == false)
+		{
+			overflowed_sample_count_.fetch_add(1, std::memory_order_relaxed);
+
+			return false;
+		}
+
+		return true;
+	}
+
+	template <typename Policy>
+	bool MemoryTracer<Policy>::is_sampling() const
+	{
+		if constexpr (Policy::IS_SAMPLING_ENABLED == true)
+		{
+			return allocation_sampler_.is_enabled();
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	template <typename Policy>
+	MEMTRACER_FORCEINLINE StackId MemoryTracer<Policy>::capture_stack(TracerShard& tracer_shard)
+	{
+		if constexpr (Policy::IS_STACK_CAPTURE_ENABLED == false)
+		{
+			return StackTable::OVERFLOW_STACK_ID;
+		}
+		else
+		{
+			// capturing and interning is most of the cost. skip it until tracer thread catches up.
+			if (should_degrade(tracer_shard) == true)
+			{
+				degraded_allocation_count_.fetch_add(1, std::memory_order_relaxed);
+
+				return StackTable::OVERFLOW_STACK_ID;
+			}
+
+			StackBackTrace stack_back_trace;
+
+			stack_back_trace.capture(Policy::FRAMES_TO_SKIP, Policy::STACK_DEPTH, Policy::CALL_STACK_HASH_BITS);
+
+			return stack_table_.intern(stack_back_trace);
+		}
+	}
+
+	template <typename Policy>
+	void* MemoryTracer<Policy>::allocate_aligned(void* (*alloc)(size_t), size_t size, size_t alignment)
+	{
+		assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+		alignment = (std::max)(alignment, sizeof(void*));
+
+		if (size > SIZE_MAX - alignment - sizeof(void*))
+		{
+			return nullptr;
+		}
+
+		void* raw_block = alloc(size + alignment - 1 + sizeof(void*));
+
+		if (raw_block == nullptr)
+		{
+			return nullptr;
+		}
+
+		const uintptr_t address = (reinterpret_cast<uintptr_t>(raw_block) + sizeof(void*) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+
+		reinterpret_cast<void**>(address)[-1] = raw_block;
+
+		return reinterpret_cast<void*>(address);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::free_aligned(void (*free)(void*), void* block)
+	{
+		if (block != nullptr)
+		{
+			free(static_cast<void**>(block)[-1]);
+		}
+	}
+
+	template <typename Policy>
+	template <typename Writer>
+	bool MemoryTracer<Policy>::push_operation(TracerShard& tracer_shard, const Writer& writer, std::atomic<size_t>* dropped_count)
+	{
+		OperationRing* ring = get_thread_event_ring(tracer_shard);
+
+		if (ring == nullptr)
+		{
+			std::lock_guard<std::mutex> lock(tracer_shard.orphan_event_ring_mutex_);
+
+			return write_operation(tracer_shard, tracer_shard.orphan_event_ring_, writer, dropped_count);
+		}
+
+		return write_operation(tracer_shard, ring, writer, dropped_count);
+	}
+
+	template <typename Policy>
+	template <typename Writer>
+	bool MemoryTracer<Policy>::write_operation(TracerShard& tracer_shard, OperationRing* ring, const Writer& writer, std::atomic<size_t>* dropped_count)
+	{
+		MemoryOperation* memory_operation = ring->try_reserve();
+
+		if (memory_operation == nullptr && dropped_count != nullptr && buffer_policy_ == EBufferPolicy::DropAndCount)
+		{
+			dropped_count->fetch_add(1, std::memory_order_relaxed);
+
+			return false;
+		}
+
+		// tracer thread is behind. wait until it drains this ring.
+		while (memory_operation == nullptr)
+		{
+			if (is_in_trace_ == false)
+			{
+				return false;
+			}
+
+			std::this_thread::yield();
+
+			memory_operation = ring->try_reserve();
+		}
+
+		writer(*memory_operation);
+
+		memory_operation->timestamp_ = get_timestamp();
+
+		ring->commit();
+
+		wake_tracer_thread(tracer_shard);
+
+		return true;
+	}
+
+	template <typename Policy>
+	bool MemoryTracer<Policy>::should_degrade(TracerShard& tracer_shard)
+	{
+		if (buffer_policy_ != EBufferPolicy::Degrade)
+		{
+			return false;
+		}
+
+		OperationRing* ring = get_thread_event_ring(tracer_shard);
+
+		// orphan ring is shared by exiting threads. it is only read under its lock.
+		return ring != nullptr && ring->is_pending_over(EVENT_RING_DEGRADE_COUNT);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::thread_update(TracerShard* tracer_shard)
+	{
+		is_tracer_thread_ = true;
+
+		unsigned int idle_pass_count = 0;
+
+		size_t applied_operation_count = 0;
+
+		const bool is_trigger_thread = tracer_shard->index_ == 0 && has_snapshot_triggers() == true;
+
+		if (is_trigger_thread == true)
+		{
+			reset_snapshot_triggers();
+		}
+
+		while (drain_event_rings(*tracer_shard, applied_operation_count) == true)
+		{
+			if (is_trigger_thread == true)
+			{
+				check_snapshot_triggers();
+			}
+
+			if (applied_operation_count != 0)
+			{
+				idle_pass_count = 0;
+			}
+			else if (++idle_pass_count < TRACER_SPIN_PASSES)
+			{
+				std::this_thread::yield();
+			}
+			else
+			{
+				// events reach the file while this thread sleeps.
+				if (tracer_shard->event_log_stream_.is_open() == true)
+				{
+					tracer_shard->event_log_stream_.flush();
+				}
+
+				park_tracer_thread(*tracer_shard);
+
+				idle_pass_count = 0;
+			}
+		}
+
+		if (tracer_shard->event_log_stream_.is_open() == true)
+		{
+			tracer_shard->event_log_stream_.flush();
+		}
+	}
+
+	template <typename Policy>
+	bool MemoryTracer<Policy>::has_pending_operations(TracerShard& tracer_shard)
+	{
+		refresh_drain_rings(tracer_shard);
+
+		for (OperationRing* ring : tracer_shard.drain_rings_)
+		{
+			if (ring->get_readable_count() != 0)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::park_tracer_thread(TracerShard& tracer_shard)
+	{
+		std::unique_lock<std::mutex> lock(tracer_shard.tracer_wakeup_mutex_);
+
+		tracer_shard.is_tracer_sleeping_.store(true, std::memory_order_relaxed);
+
+		// pairs with producer's fence. either producer sees the flag, or this sees its record.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		const auto is_woken = [&tracer_shard]()
+			{
+				return tracer_shard.is_tracer_sleeping_.load(std::memory_order_relaxed) == false;
+			};
+
+		if (has_pending_operations(tracer_shard) == false)
+		{
+			// interval and rate limited conditions fire without any record.
+			if (tracer_shard.index_ == 0 && has_snapshot_triggers() == true)
+			{
+				tracer_shard.tracer_wakeup_condition_.wait_for(lock, std::chrono::milliseconds(SNAPSHOT_TRIGGER_CHECK_MILLISECONDS), is_woken);
+			}
+			else
+			{
+				tracer_shard.tracer_wakeup_condition_.wait(lock, is_woken);
+			}
+		}
+
+		tracer_shard.is_tracer_sleeping_.store(false, std::memory_order_relaxed);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::wake_tracer_thread(TracerShard& tracer_shard)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (tracer_shard.is_tracer_sleeping_.load(std::memory_order_relaxed) == false)
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(tracer_shard.tracer_wakeup_mutex_);
+
+			tracer_shard.is_tracer_sleeping_.store(false, std::memory_order_relaxed);
+		}
+
+		tracer_shard.tracer_wakeup_condition_.notify_one();
+	}
+
+	template <typename Policy>
+	bool MemoryTracer<Policy>::has_snapshot_triggers() const
+	{
+		return snapshot_triggers_.live_bytes_threshold_ != 0 || snapshot_triggers_.growth_percent_ != 0 ||
+			snapshot_triggers_.is_peak_enabled_ == true || snapshot_triggers_.interval_milliseconds_ != 0;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::reset_snapshot_triggers()
+	{
+		const MemoryTotals memory_totals = get_totals();
+
+		snapshot_trigger_state_.next_check_timestamp_ = 0;
+
+		snapshot_trigger_state_.interval_start_timestamp_ = memory_totals.timestamp_;
+
+		snapshot_trigger_state_.last_snapshot_timestamp_ = 0;
+
+		snapshot_trigger_state_.growth_base_memory_allocation_ = memory_totals.memory_allocation_;
+
+		snapshot_trigger_state_.peak_base_memory_allocation_ = memory_totals.peak_memory_allocation_upper_bound_;
+
+		snapshot_trigger_state_.is_threshold_armed_ = memory_totals.memory_allocation_ < snapshot_triggers_.live_bytes_threshold_;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::check_snapshot_triggers()
+	{
+		SnapshotTriggerState& state = snapshot_trigger_state_;
+
+		const Timestamp timestamp = get_timestamp();
+
+		if (timestamp < state.next_check_timestamp_)
+		{
+			return;
+		}
+
+		state.next_check_timestamp_ = timestamp + get_timestamp_duration(SNAPSHOT_TRIGGER_CHECK_MILLISECONDS);
+
+		const MemoryTotals memory_totals = get_totals();
+
+		const size_t memory_allocation = memory_totals.memory_allocation_;
+
+		if (memory_allocation < snapshot_triggers_.live_bytes_threshold_)
+		{
+			state.is_threshold_armed_ = true;
+		}
+
+		// no growth from 0 bytes. base starts at first live bytes.
+		if (state.growth_base_memory_allocation_ == 0)
+		{
+			state.growth_base_memory_allocation_ = memory_allocation;
+		}
+
+		if (is_triggered_snapshot_pending_.load(std::memory_order_acquire) == true ||
+			(state.last_snapshot_timestamp_ != 0 && timestamp - state.last_snapshot_timestamp_ < get_timestamp_duration(snapshot_triggers_.min_interval_milliseconds_)))
+		{
+			return;
+		}
+
+		ESnapshotTrigger trigger = ESnapshotTrigger::None;
+
+		if (snapshot_triggers_.live_bytes_threshold_ != 0 && state.is_threshold_armed_ == true && memory_allocation >= snapshot_triggers_.live_bytes_threshold_)
+		{
+			trigger = ESnapshotTrigger::Threshold;
+
+			state.is_threshold_armed_ = false;
+		}
+		else if (snapshot_triggers_.growth_percent_ != 0 && state.growth_base_memory_allocation_ != 0 && memory_allocation > state.growth_base_memory_allocation_ &&
+			static_cast<double>(memory_allocation - state.growth_base_memory_allocation_) * 100.0 >= static_cast<double>(state.growth_base_memory_allocation_) * snapshot_triggers_.growth_percent_)
+		{
+			trigger = ESnapshotTrigger::Growth;
+		}
+		else if (snapshot_triggers_.is_peak_enabled_ == true && memory_totals.peak_memory_allocation_upper_bound_ > state.peak_base_memory_allocation_)
+		{
+			trigger = ESnapshotTrigger::Peak;
+		}
+		else if (snapshot_triggers_.interval_milliseconds_ != 0 && timestamp - state.interval_start_timestamp_ >= get_timestamp_duration(snapshot_triggers_.interval_milliseconds_))
+		{
+			trigger = ESnapshotTrigger::Interval;
+		}
+
+		if (trigger == ESnapshotTrigger::None)
+		{
+			return;
+		}
+
+		// every condition is compared with this snapshot from now on.
+		state.interval_start_timestamp_ = timestamp;
+
+		state.last_snapshot_timestamp_ = timestamp;
+
+		state.growth_base_memory_allocation_ = memory_allocation;
+
+		state.peak_base_memory_allocation_ = memory_totals.peak_memory_allocation_upper_bound_;
+
+		is_triggered_snapshot_pending_.store(true, std::memory_order_release);
+
+		{
+			std::lock_guard<std::mutex> lock(snapshot_requests_mutex_);
+
+			pending_trigger_ = trigger;
+		}
+
+		snapshot_requests_condition_.notify_one();
+	}
+
+	template <typename Policy>
+	bool MemoryTracer<Policy>::drain_event_rings(TracerShard& tracer_shard, size_t& applied_operation_count)
+	{
+		refresh_drain_rings(tracer_shard);
+
+		// records published after this point are applied in next pass.
+		// a record's causal predecessors (e.g. allocation of freed address) are always published before it.
+		const Timestamp watermark = get_timestamp();
+
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		tracer_shard.drain_cursors_.clear();
+
+		tracer_shard.drain_heap_.clear();
+
+		for (size_t i = 0; i < tracer_shard.drain_rings_.size(); )
+		{
+			OperationRing* ring = tracer_shard.drain_rings_[i];
+
+			// read retire flag before count. owner doesn't publish after retire.
+			const bool is_retired = ring->is_retired();
+
+			const size_t total_readable_count = ring->get_readable_count();
+
+			const size_t readable_count = (std::min)(total_readable_count, EVENT_DRAIN_BATCH);
+
+			if (readable_count == 0 && is_retired == true)
+			{
+				release_event_ring(tracer_shard, ring);
+
+				continue;
+			}
+
+			if (readable_count != 0 && ring->get_readable(0).timestamp_ <= watermark)
+			{
+				tracer_shard.drain_cursors_.push_back({ ring, readable_count, 0, total_readable_count > readable_count });
+			}
+
+			i++;
+		}
+
+		const auto later = [&tracer_shard](size_t first, size_t second)
+			{
+				const DrainCursor& first_cursor = tracer_shard.drain_cursors_[first];
+
+				const DrainCursor& second_cursor = tracer_shard.drain_cursors_[second];
+
+				return first_cursor.ring_->get_readable(first_cursor.offset_).timestamp_
+					> second_cursor.ring_->get_readable(second_cursor.offset_).timestamp_;
+			};
+
+		for (size_t i = 0; i < tracer_shard.drain_cursors_.size(); i++)
+		{
+			tracer_shard.drain_heap_.push_back(i);
+		}
+
+		std::make_heap(tracer_shard.drain_heap_.begin(), tracer_shard.drain_heap_.end(), later);
+
+		bool is_running = true;
+
+		applied_operation_count = 0;
+
+		Timestamp applied_timestamp = 0;
+
+		while (tracer_shard.drain_heap_.empty() == false && is_running == true)
+		{
+			std::pop_heap(tracer_shard.drain_heap_.begin(), tracer_shard.drain_heap_.end(), later);
+
+			const size_t cursor_index = tracer_shard.drain_heap_.back();
+
+			tracer_shard.drain_heap_.pop_back();
+
+			DrainCursor& cursor = tracer_shard.drain_cursors_[cursor_index];
+
+			const MemoryOperation& memory_operation = cursor.ring_->get_readable(cursor.offset_);
+
+			is_running = apply_operation(tracer_shard, memory_operation);
+
+			applied_operation_count++;
+
+			applied_timestamp = memory_operation.timestamp_;
+
+			cursor.offset_++;
+
+			// rest of truncated ring can be older than other rings' records. stop the pass here.
+			if (cursor.offset_ == cursor.readable_count_ && cursor.is_truncated_ == true)
+			{
+				break;
+			}
+
+			if (cursor.offset_ < cursor.readable_count_ &&
+				cursor.ring_->get_readable(cursor.offset_).timestamp_ <= watermark)
+			{
+				tracer_shard.drain_heap_.push_back(cursor_index);
+
+				std::push_heap(tracer_shard.drain_heap_.begin(), tracer_shard.drain_heap_.end(), later);
+			}
+		}
+
+		for (DrainCursor& cursor : tracer_shard.drain_cursors_)
+		{
+			cursor.ring_->consume(cursor.offset_);
+		}
+
+		if (applied_operation_count != 0)
+		{
+			tracer_shard.applied_operation_count_.store(tracer_shard.applied_operation_count_.load(std::memory_order_relaxed) + applied_operation_count, std::memory_order_relaxed);
+
+			tracer_shard.applied_timestamp_.store(applied_timestamp, std::memory_order_relaxed);
+
+			publish_totals(tracer_shard);
+		}
+
+		return is_running;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::publish_totals(TracerShard& tracer_shard)
+	{
+		const size_t sequence = tracer_shard.totals_sequence_.load(std::memory_order_relaxed);
+
+		tracer_shard.totals_sequence_.store(sequence + 1, std::memory_order_relaxed);
+
+		// readers which see any of new values also see odd sequence.
+		std::atomic_thread_fence(std::memory_order_release);
+
+		// everything allocated and not live any more is freed. producers counted sized frees already.
+		tracer_shard.published_freed_memory_allocation_.store(tracer_shard.cumulative_memory_allocation_ - tracer_shard.total_memory_allocation_
+			- tracer_shard.sized_freed_memory_allocation_ - tracer_shard.unmatched_freed_memory_allocation_, std::memory_order_relaxed);
+
+		tracer_shard.published_free_count_.store(tracer_shard.cumulative_allocation_count_ - tracer_shard.total_memory_allocation_count_
+			- tracer_shard.sized_free_count_ - tracer_shard.unmatched_free_count_, std::memory_order_relaxed);
+
+		tracer_shard.published_peak_memory_allocation_.store(tracer_shard.peak_memory_allocation_, std::memory_order_relaxed);
+
+		tracer_shard.totals_sequence_.store(sequence + 2, std::memory_order_release);
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::refresh_drain_rings(TracerShard& tracer_shard)
+	{
+		const size_t version = tracer_shard.event_rings_version_.load(std::memory_order_acquire);
+
+		if (version != tracer_shard.drain_rings_version_)
+		{
+			std::lock_guard<std::mutex> lock(tracer_shard.event_rings_mutex_);
+
+			tracer_shard.drain_rings_.assign(tracer_shard.event_rings_.begin(), tracer_shard.event_rings_.end());
+
+			tracer_shard.drain_rings_version_ = tracer_shard.event_rings_version_.load(std::memory_order_relaxed);
+		}
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::release_event_ring(TracerShard& tracer_shard, OperationRing* ring)
+	{
+		{
+			std::lock_guard<std::mutex> lock(tracer_shard.event_rings_mutex_);
+
+			tracer_shard.event_rings_.erase(std::find(tracer_shard.event_rings_.begin(), tracer_shard.event_rings_.end(), ring));
+
+			tracer_shard.drain_rings_.assign(tracer_shard.event_rings_.begin(), tracer_shard.event_rings_.end());
+
+			tracer_shard.drain_rings_version_ = tracer_shard.event_rings_version_.fetch_add(1, std::memory_order_release) + 1;
+		}
+
+		delete ring;
+	}
+
+	template <typename Policy>
+	bool MemoryTracer<Policy>::apply_operation(TracerShard& tracer_shard, const MemoryOperation& memory_operation)
+	{
+		if (memory_operation.operation_type_ == EOperationType::Allocate)
+		{
+			apply_allocation(tracer_shard, memory_operation);
+		}
+		else if (memory_operation.operation_type_ == EOperationType::Free)
+		{
+			apply_free(tracer_shard, memory_operation);
+		}
+		else if (memory_operation.operation_type_ == EOperationType::Reallocate)
+		{
+			apply_reallocate(tracer_shard, memory_operation);
+		}
+		else if (memory_operation.operation_type_ == EOperationType::Snapshot)
+		{
+			request_snapshot(tracer_shard, static_cast<SnapshotRequest*>(memory_operation.address_));
+		}
+		else if (memory_operation.operation_type_ == EOperationType::Stop)
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::apply_allocation(TracerShard& tracer_shard, const MemoryOperation& memory_operation)
+	{
+		void* address = memory_operation.address_;
+
+		if (address == nullptr)
+		{
+			return;
+		}
+
+		bool is_inserted = false;
+
+		Allocation* allocation = tracer_shard.allocation_table_.emplace(address, is_inserted);
+
+		// free of this address was not traced. (e.g. freed while trace is stopped)
+		if (is_inserted == false)
+		{
+			remove_allocation_statistics(tracer_shard, allocation->stack_id_, allocation->size_);
+		}
+
+		allocation->size_ = memory_operation.size_;
+
+		allocation->stack_id_ = memory_operation.stack_id_;
+
+		allocation->is_replaced_ = is_inserted == false;
+
+		allocation->timestamp_ = memory_operation.timestamp_;
+
+		add_allocation_statistics(tracer_shard, memory_operation.stack_id_, memory_operation.size_);
+
+		// apply_reallocate logs its own event.
+		if (memory_operation.operation_type_ == EOperationType::Allocate && tracer_shard.event_log_stream_.is_open() == true)
+		{
+			tracer_shard.event_log_stream_.add_allocation(memory_operation.timestamp_, address, memory_operation.size_, memory_operation.stack_id_);
+		}
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::apply_free(TracerShard& tracer_shard, const MemoryOperation& memory_operation)
+	{
+		Allocation allocation;
+
+		// do not apply memory allocations in prev start trace.
+		const bool is_erased = tracer_shard.allocation_table_.erase(memory_operation.address_, allocation);
+
+		// producer counted sized free with its size. (estimated when sampling) same values are taken out of tracer's count.
+		if (memory_operation.size_ != 0)
+		{
+			assert(is_erased == false || memory_operation.size_ == allocation.size_);
+
+			const bool is_sampled = is_sampling();
+
+			const size_t estimated_size = is_sampled == true ? allocation_sampler_.get_estimated_size(memory_operation.size_) : memory_operation.size_;
+
+			const size_t estimated_count = is_sampled == true ? allocation_sampler_.get_estimated_count(memory_operation.size_) : 1;
+
+			size_t& freed_memory_allocation = is_erased == true ? tracer_shard.sized_freed_memory_allocation_ : tracer_shard.unmatched_freed_memory_allocation_;
+
+			size_t& free_count = is_erased == true ? tracer_shard.sized_free_count_ : tracer_shard.unmatched_free_count_;
+
+			freed_memory_allocation += estimated_size;
+
+			free_count += estimated_count;
+		}
+
+		if (is_erased == false)
+			return;
+
+		release_allocation(tracer_shard, allocation, memory_operation.timestamp_);
+
+		if (tracer_shard.event_log_stream_.is_open() == true)
+		{
+			tracer_shard.event_log_stream_.add_free(memory_operation.timestamp_, memory_operation.address_);
+		}
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::apply_reallocate(TracerShard& tracer_shard, const MemoryOperation& memory_operation)
+	{
+		Allocation allocation;
+
+		bool is_released = false;
+
+		if (memory_operation.previous_address_ != nullptr &&
+			tracer_shard.allocation_table_.erase(memory_operation.previous_address_, allocation) == true)
+		{
+			// other thread reused moved block's old address before this record. old allocation was released then.
+			if (allocation.is_replaced_ == true && memory_operation.previous_address_ != memory_operation.address_)
+			{
+				bool is_inserted = false;
+
+				Allocation* reused_allocation = tracer_shard.allocation_table_.emplace(memory_operation.previous_address_, is_inserted);
+
+				*reused_allocation = allocation;
+
+				reused_allocation->is_replaced_ = false;
+			}
+			else
+			{
+				release_allocation(tracer_shard, allocation, memory_operation.timestamp_);
+
+				is_released = true;
+			}
+		}
+
+		apply_allocation(tracer_shard, memory_operation);
+
+		if (tracer_shard.event_log_stream_.is_open() == false)
+		{
+			return;
+		}
+
+		// replay sees same effect on live allocations. a reused old address was logged by its allocation.
+		if (is_released == true && memory_operation.address_ != nullptr)
+		{
+			tracer_shard.event_log_stream_.add_reallocation(memory_operation.timestamp_, memory_operation.previous_address_, memory_operation.address_, memory_operation.size_, memory_operation.stack_id_);
+		}
+		else if (is_released == true)
+		{
+			tracer_shard.event_log_stream_.add_free(memory_operation.timestamp_, memory_operation.previous_address_);
+		}
+		else if (memory_operation.address_ != nullptr)
+		{
+			tracer_shard.event_log_stream_.add_allocation(memory_operation.timestamp_, memory_operation.address_, memory_operation.size_, memory_operation.stack_id_);
+		}
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::release_allocation(TracerShard& tracer_shard, const Allocation& allocation, Timestamp timestamp)
+	{
+		remove_allocation_statistics(tracer_shard, allocation.stack_id_, allocation.size_);
+
+		// free is published after allocate of same address, so it is not earlier.
+		const unsigned long long lifetime = get_timestamp_nanoseconds(timestamp - allocation.timestamp_);
+
+		tracer_shard.stack_lifetimes_[allocation.stack_id_].lifetime_buckets_[get_lifetime_bucket(lifetime)]++;
+	}
+
+	template <typename Policy>
+	StackStatistics& MemoryTracer<Policy>::get_stack_statistics(TracerShard& tracer_shard, StackId stack_id)
+	{
+		if (stack_id >= tracer_shard.stack_statistics_.size())
+		{
+			// ids are dense. grow to all interned stacks at once.
+			tracer_shard.stack_statistics_.resize((std::max)(static_cast<size_t>(stack_table_.get_stack_count()), static_cast<size_t>(stack_id) + 1), StackStatistics{});
+
+			tracer_shard.stack_lifetimes_.resize(tracer_shard.stack_statistics_.size(), StackLifetime{});
+
+			tracer_shard.stack_size_classes_.resize(tracer_shard.stack_statistics_.size(), StackSizeClasses{});
+
+			tracer_shard.snapshot_stack_statistics_.resize(tracer_shard.stack_statistics_.size(), StackStatistics{});
+
+			tracer_shard.is_stack_dirty_.resize(tracer_shard.stack_statistics_.size(), false);
+		}
+
+		return tracer_shard.stack_statistics_[stack_id];
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::mark_stack_dirty(TracerShard& tracer_shard, StackId stack_id)
+	{
+		if (tracer_shard.is_stack_dirty_[stack_id] == false)
+		{
+			tracer_shard.is_stack_dirty_[stack_id] = true;
+
+			tracer_shard.dirty_stack_ids_.push_back(stack_id);
+		}
+	}
+
+	template <typename Policy>
+	void MemoryTracer<Policy>::add_allocation_statistics(TracerShard& tracer_shard, StackId stack_id, size_t size)
+	{
+		const bool is_sampled = is_sampling();
+
+		const size_t estimated_size = is_sampled == true ? allocation_sampler_.get_estimated_size(size) : size;
+
+		const size_t estimated_count = is_sampled == true ? allocation_sampler_.get_estimated_count(size) : 1;
+
+		StackStatistics& stack_statistics = get_stack_statistics(tracer_shard, stack_id);
+
+		stack_statistics.memory_allocation_ += estimated_size;
+
+		stack_statistics.memory_allocation_count_ += estimated_count;
+
+		StackLifetime& stack_lifetime = tracer_shard.stack_lifetimes_[stack_id];
+
+		stack_lifetime.total_memory_allocation_ += estimated_size;
+
+		stack_lifetime.total_allocation_count_ += estimated_count;
 
-		void stop();
+		const unsigned int size_class = get_size_class(size);
 
-		void set_report_path(TCHAR* path);
+		StackSizeClasses& stack_size_classes = tracer_shard.stack_size_classes_[stack_id];
 
-		void* add_allocation(size_t size);
+		stack_size_classes.live_counts_[size_class] += estimated_count;
 
-		void remove_allocation(void* block);
-#pragma endregion
+		stack_size_classes.total_counts_[size_class] += estimated_count;
 
-		void* operator new[](size_t size) = delete;
+		tracer_shard.size_class_statistics_.live_memory_allocations_[size_class] += estimated_size;
 
-		void operator delete[](void* block) = delete;
+		tracer_shard.size_class_statistics_.live_counts_[size_class] += estimated_count;
 
-	private:
-		MemoryTracer();
+		tracer_shard.size_class_statistics_.total_counts_[size_class] += estimated_count;
 
-		~MemoryTracer();
+		mark_stack_dirty(tracer_shard, stack_id);
 
-		static void init_instance();
+		tracer_shard.total_memory_allocation_ += estimated_size;
 
-		static void finalize_instance();
+		tracer_shard.total_memory_allocation_count_ += estimated_count;
 
-		static std::once_flag init_flag_;
+		tracer_shard.cumulative_memory_allocation_ += estimated_size;
 
-		static std::once_flag finalize_flag_;
+		tracer_shard.cumulative_allocation_count_ += estimated_count;
 
-		static MemoryTracer* instance_;
+		tracer_shard.peak_memory_allocation_ = (std::max)(tracer_shard.peak_memory_allocation_, tracer_shard.total_memory_allocation_);
+	}
 
-		void* operator new(size_t size);
+	template <typename Policy>
+	void MemoryTracer<Policy>::remove_allocation_statistics(TracerShard& tracer_shard, StackId stack_id, size_t size)
+	{
+		const bool is_sampled = is_sampling();
 
-		void operator delete(void* block);
+		const size_t estimated_size = is_sampled == true ? allocation_sampler_.get_estimated_size(size) : size;
 
-		void thread_update();
+		const size_t estimated_count = is_sampled == true ? allocation_sampler_.get_estimated_count(size) : 1;
 
-		void apply_allocation(AllocateOperation* memory_operation);
+		StackStatistics& stack_statistics = get_stack_statistics(tracer_shard, stack_id);
 
-		void apply_free(FreeOperation* memory_operation);
+		stack_statistics.memory_allocation_ -= estimated_size;
 
-		// only function that initialize symbol and use it.
-		void make_snapshot();
+		stack_statistics.memory_allocation_count_ -= estimated_count;
 
-		AllocFunc alloc_ = Alloc;
+		const unsigned int size_class = get_size_class(size);
 
-		AllocFunc array_alloc_ = ArrayAlloc;
+		tracer_shard.stack_size_classes_[stack_id].live_counts_[size_class] -= estimated_count;
 
-		FreeFunc free_ = Free;
+		tracer_shard.size_class_statistics_.live_memory_allocations_[size_class] -= estimated_size;
 
-		FreeFunc array_free_ = ArrayFree;
+		tracer_shard.size_class_statistics_.live_counts_[size_class] -= estimated_count;
 
-#pragma region internal
-		TCHAR report_path[MAX_PATH];
+		mark_stack_dirty(tracer_shard, stack_id);
 
-		std::atomic<bool> is_in_trace_;
+		tracer_shard.total_memory_allocation_ -= estimated_size;
 
-		concurrency::concurrent_queue<IMemoryOperation*
-			, memtracer::MemoryTracerAllocator<const IMemoryOperation*>> memory_operations_;
+		tracer_shard.total_memory_allocation_count_ -= estimated_count;
+	}
 
-		std::thread tracer_thread_;
+	template <typename Policy>
+	void MemoryTracer<Policy>::request_snapshot(TracerShard& tracer_shard, SnapshotRequest* snapshot_request)
+	{
+		// not a snapshot of stacks. diffs don't see it.
+		if (snapshot_request->snapshot_type_ == ESnapshotType::Leak)
+		{
+			collect_leak_blocks(tracer_shard, *snapshot_request);
 
-		std::recursive_mutex memory_information_mutex_;
+			complete_shard_snapshot(snapshot_request, &tracer_shard, true);
 
-#pragma region only_write_in_tracer_thread
-		std::unordered_map<void*, size_t, std::hash<void*>
-			, std::equal_to<>, memtracer::MemoryTracerAllocator<std::pair<const void*, size_t>>>
-			address_to_size_map_;
+			return;
+		}
 
-		std::unordered_map<void*, CallStackHash, std::hash<void*>
-			, std::equal_to<>, memtracer::MemoryTracerAllocator<std::pair<const void*, CallStackHash>>>
-			address_to_hash_map_;
+		// a stack changed first time after a baseline keeps its value of that time.
+		// snapshot_stack_statistics_ still has it, because the stack was not changed between them.
+		for (StackId stack_id : tracer_shard.dirty_stack_ids_)
+		{
+			for (Baseline& baseline : tracer_shard.baselines_)
+			{
+				baseline.stack_statistics_.emplace(stack_id, tracer_shard.snapshot_stack_statistics_[stack_id]);
+			}
+		}
 
-		std::unordered_map<CallStackHash, memtracer::StackBackTrace*, std::hash<CallStackHash>
-			, std::equal_to<>, memtracer::MemoryTracerAllocator<std::pair<const CallStackHash, memtracer::StackBackTrace*>>>
-			hash_to_stack_back_trace_map_;
+		bool is_valid = true;
 
-		std::unordered_map<CallStackHash, size_t, std::hash<CallStackHash>
-			, std::equal_to<>, memtracer::MemoryTracerAllocator<std::pair<const CallStackHash, size_t>>>
-			hash_to_memory_allocation_map_;
+		tracer_shard.snapshot_stacks_.clear();
 
-		std::unordered_map<CallStackHash, size_t, std::hash<CallStackHash>
-			, std::equal_to<>, memtracer::MemoryTracerAllocator<std::pair<const CallStackHash, size_t>>>
-			hash_to_memory_allocation_count_map_;
+		// only a copy of counters. symbolization and file I/O are done by snapshot thread.
+		if (snapshot_request->snapshot_type_ == ESnapshotType::Full || snapshot_request->snapshot_type_ == ESnapshotType::Query)
+		{
+			for (StackId stack_id = 0; stack_id < tracer_shard.stack_statistics_.size(); stack_id++)
+			{
+				// freed stacks are kept for their lifetimes.
+				if (tracer_shard.stack_statistics_[stack_id].memory_allocation_count_ != 0 || tracer_shard.stack_lifetimes_[stack_id].total_allocation_count_ != 0)
+				{
+					tracer_shard.snapshot_stacks_.push_back(make_snapshot_stack(tracer_shard, stack_id, tracer_shard.snapshot_stack_statistics_[stack_id]));
+				}
+			}
+		}
+		else if (snapshot_request->snapshot_type_ == ESnapshotType::Diff && snapshot_request->baseline_name_.empty() == true)
+		{
+			for (StackId stack_id : tracer_shard.dirty_stack_ids_)
+			{
+				tracer_shard.snapshot_stacks_.push_back(make_snapshot_stack(tracer_shard, stack_id, tracer_shard.snapshot_stack_statistics_[stack_id]));
+			}
+		}
+		else if (snapshot_request->snapshot_type_ == ESnapshotType::Diff)
+		{
+			const Baseline* baseline = find_baseline(tracer_shard, snapshot_request->baseline_name_);
 
-		size_t total_memory_allocation_;
+			is_valid = baseline != nullptr;
 
-		size_t total_memory_allocation_count_;
+			if (is_valid == true)
+			{
+				for (const auto& pair : baseline->stack_statistics_)
+				{
+					tracer_shard.snapshot_stacks_.push_back(make_snapshot_stack(tracer_shard, pair.first, pair.second));
+				}
+			}
+			// every shard marks baselines at the same request, so one message is enough.
+			else if (tracer_shard.index_ == 0)
+			{
+				std::cerr << "Baseline is not found." << std::endl;
+			}
+		}
 
-		size_t snapshot_index;
-#pragma endregion
-#pragma endregion
-	};
+		// query is not a snapshot. next diff still compares with previous snapshot.
+		if (snapshot_request->snapshot_type_ == ESnapshotType::Query)
+		{
+			complete_shard_snapshot(snapshot_request, &tracer_shard, is_valid);
 
-	template <void* (*Alloc)(size_t), void* (*ArrayAlloc)(size_t), void(*Free)(void*), void(*ArrayFree)(void*) >
-	MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>* MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::instance_ = nullptr;
+			return;
+		}
 
-	template <void* (*Alloc)(size_t), void* (*ArrayAlloc)(size_t), void(*Free)(void*), void(*ArrayFree)(void*) >
-	std::once_flag MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::init_flag_;
+		for (StackId stack_id : tracer_shard.dirty_stack_ids_)
+		{
+			tracer_shard.snapshot_stack_statistics_[stack_id] = tracer_shard.stack_statistics_[stack_id];
 
-	template <void* (*Alloc)(size_t), void* (*ArrayAlloc)(size_t), void(*Free)(void*), void(*ArrayFree)(void*) >
-	std::once_flag MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::finalize_flag_;
+			tracer_shard.is_stack_dirty_[stack_id] = false;
+		}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::start()
-	{
-		assert(instance_ != nullptr);
+		tracer_shard.dirty_stack_ids_.clear();
 
-		instance_->tracer_thread_ = std::thread(&MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::thread_update, this);
+		if (snapshot_request->snapshot_type_ == ESnapshotType::Baseline)
+		{
+			Baseline* baseline = find_baseline(tracer_shard, snapshot_request->baseline_name_);
 
-		instance_->is_in_trace_ = true;
-	}
+			if (baseline == nullptr)
+			{
+				tracer_shard.baselines_.emplace_back();
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::take_snapshot() const
-	{
-		assert(instance_ != nullptr);
+				baseline = &tracer_shard.baselines_.back();
 
-		if (instance_->is_in_trace_ == true)
-		{
-			IMemoryOperation* memory_operation = new SnapshotOperation();
+				baseline->name_ = snapshot_request->baseline_name_;
+			}
 
-			instance_->memory_operations_.push(memory_operation);
+			baseline->stack_statistics_.clear();
 		}
+
+		complete_shard_snapshot(snapshot_request, &tracer_shard, is_valid);
 	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::stop()
+	template <typename Policy>
+	void MemoryTracer<Policy>::collect_leak_blocks(TracerShard& tracer_shard, const SnapshotRequest& snapshot_request)
 	{
-		assert(instance_ != nullptr);
+		tracer_shard.leak_blocks_.clear();
+
+		tracer_shard.young_blocks_.clear();
+
+		const auto make_leak_block = [](const Allocation& allocation)
+			{
+				return LeakBlock{ allocation.address_, allocation.size_, allocation.stack_id_, allocation.timestamp_ };
+			};
 
-		if (instance_->tracer_thread_.joinable() == true)
+		if (snapshot_request.is_leak_scanned_ == false)
 		{
-			IMemoryOperation* memory_operation = new StopOperation();
+			tracer_shard.allocation_table_.for_each([&tracer_shard, &make_leak_block](const Allocation& allocation)
+				{
+					tracer_shard.leak_blocks_.push_back(make_leak_block(allocation));
+				});
 
-			instance_->memory_operations_.push(memory_operation);
+			return;
+		}
 
-			instance_->tracer_thread_.join();
+		// same address and timestamp is the same allocation. address could be freed and allocated again since first pass.
+		for (const LeakBlock& unreachable_block : snapshot_request.unreachable_blocks_)
+		{
+			if (&get_shard(unreachable_block.address_) != &tracer_shard)
+			{
+				continue;
+			}
 
-			instance_->is_in_trace_ = false;
+			const Allocation* allocation = tracer_shard.allocation_table_.find(unreachable_block.address_);
+
+			if (allocation != nullptr && allocation->timestamp_ == unreachable_block.timestamp_)
+			{
+				tracer_shard.leak_blocks_.push_back(unreachable_block);
+			}
 		}
-	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::set_report_path(TCHAR* path)
-	{
-		assert(instance_ != nullptr);
+		const LeakBlockList& leak_blocks = snapshot_request.leak_blocks_;
+
+		tracer_shard.allocation_table_.for_each([&tracer_shard, &make_leak_block, &leak_blocks](const Allocation& allocation)
+			{
+				auto iterator = std::lower_bound(leak_blocks.begin(), leak_blocks.end(), allocation.address_, [](const LeakBlock& leak_block, void* address)
+					{
+						return leak_block.address_ < address;
+					});
 
-		instance_.report_path = path;
+				if (iterator == leak_blocks.end() || iterator->address_ != allocation.address_ || iterator->timestamp_ != allocation.timestamp_)
+				{
+					tracer_shard.young_blocks_.push_back(make_leak_block(allocation));
+				}
+			});
 	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>* MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::get_instance()
+	template <typename Policy>
+	void MemoryTracer<Policy>::complete_shard_snapshot(SnapshotRequest* snapshot_request, TracerShard* tracer_shard, bool is_valid)
 	{
-		std::call_once(init_flag_, &MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::init_instance);
+		{
+			std::lock_guard<std::mutex> lock(snapshot_requests_mutex_);
 
-		return instance_;
-	}
+			if (tracer_shard != nullptr && snapshot_request->snapshot_type_ == ESnapshotType::Leak)
+			{
+				LeakBlockList& leak_blocks = snapshot_request->is_leak_scanned_ == false ? snapshot_request->leak_blocks_ : snapshot_request->leaked_blocks_;
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void* MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::add_allocation(size_t size)
-	{
-		assert(instance_ != nullptr);
+				leak_blocks.insert(leak_blocks.end(), tracer_shard->leak_blocks_.begin(), tracer_shard->leak_blocks_.end());
 
-		void* block = Alloc(size);
+				snapshot_request->young_blocks_.insert(snapshot_request->young_blocks_.end(), tracer_shard->young_blocks_.begin(), tracer_shard->young_blocks_.end());
+			}
+			else if (tracer_shard != nullptr)
+			{
+				snapshot_request->snapshot_stacks_.insert(snapshot_request->snapshot_stacks_.end(), tracer_shard->snapshot_stacks_.begin(), tracer_shard->snapshot_stacks_.end());
 
-		if (instance_->is_in_trace_ == true)
-		{
-			StackBackTrace* stack_back_trace = new StackBackTrace();
+				snapshot_request->add_size_class_statistics(tracer_shard->size_class_statistics_);
+			}
 
-			IMemoryOperation* memory_operation = new AllocateOperation(block, size, new StackBackTrace());
+			snapshot_request->is_valid_ = snapshot_request->is_valid_ == true && is_valid == true;
 
-			instance_->memory_operations_.push(memory_operation);
-		}
+			if (--snapshot_request->pending_shard_count_ != 0)
+			{
+				return;
+			}
 
-		return block;
-	}
+			if (snapshot_request->snapshot_type_ != ESnapshotType::Baseline && snapshot_request->snapshot_type_ != ESnapshotType::Query && snapshot_request->is_valid_ == true)
+			{
+				// first pass of Leak is scanned by snapshot thread before it becomes a report.
+				if (snapshot_request->snapshot_type_ != ESnapshotType::Leak || snapshot_request->is_leak_scanned_ == true)
+				{
+					prepare_report(*snapshot_request);
+				}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::remove_allocation(void* block)
-	{
-		assert(instance_ != nullptr);
+				snapshot_requests_.push_back(snapshot_request);
 
-		if (instance_->is_in_trace_ == true)
-		{
-			IMemoryOperation* memory_operation = new FreeOperation(block);
+				snapshot_requests_condition_.notify_one();
 
-			instance_->memory_operations_.push(memory_operation);
+				return;
+			}
 		}
 
-		Free(block);
-	}
+		if (snapshot_request->trigger_ != ESnapshotTrigger::None)
+		{
+			is_triggered_snapshot_pending_.store(false, std::memory_order_release);
+		}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::MemoryTracer() :
-		total_memory_allocation_(0)
-		, total_memory_allocation_count_(0)
-		, report_path(DEFAULT_REPORT_PATH)
-		, is_in_trace_(false)
-		, memory_operations_()
-		, tracer_thread_()
-		, address_to_size_map_()
-		, address_to_hash_map_()
-		, hash_to_stack_back_trace_map_()
-		, hash_to_memory_allocation_map_()
-		, hash_to_memory_allocation_count_map_()
-		, snapshot_index(0)
-	{
-	}
+		// query is deleted by the querying thread, which can wake up right after set_value.
+		const bool is_query = snapshot_request->snapshot_type_ == ESnapshotType::Query;
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::~MemoryTracer()
-	{
+		snapshot_request->promise_.set_value(snapshot_request->is_valid_);
 
+		if (is_query == false)
+		{
+			delete snapshot_request;
+		}
 	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::init_instance()
+	template <typename Policy>
+	void MemoryTracer<Policy>::prepare_report(SnapshotRequest& snapshot_request)
 	{
-		instance_ = new MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>();
+		snapshot_request.snapshot_index_ = snapshot_index++;
 
-		HANDLE process_handle = GetCurrentProcess();
+		snapshot_request.sampling_interval_ = is_sampling() == true ? allocation_sampler_.get_sampling_interval() : 0;
 
-		if (SymInitialize(process_handle, NULL, TRUE) != TRUE)
-		{
-			std::cerr << "SymInitialize failed." << std::endl;
-		}
+		snapshot_request.buffer_policy_ = buffer_policy_;
+
+		const TracerStatistics tracer_statistics = get_tracer_statistics();
+
+		snapshot_request.buffer_statistics_ = tracer_statistics.buffer_statistics_;
+
+		snapshot_request.overflowed_sample_count_ = tracer_statistics.overflowed_sample_count_;
+
+		snapshot_request.arena_statistics_ = tracer_statistics.arena_statistics_;
+
+		snapshot_request.traced_time_ = get_timestamp_nanoseconds(traced_time_ + get_timestamp() - start_timestamp_);
 	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::finalize_instance()
+	template <typename Policy>
+	SnapshotStack MemoryTracer<Policy>::make_snapshot_stack(const TracerShard& tracer_shard, StackId stack_id, const StackStatistics& compared_stack_statistics) const
 	{
-		HANDLE process_handle = GetCurrentProcess();
+		const StackStatistics& stack_statistics = tracer_shard.stack_statistics_[stack_id];
 
-		SymCleanup(process_handle);
+		SnapshotStack snapshot_stack;
 
-		delete instance_;
+		snapshot_stack.stack_id_ = stack_id;
+
+		snapshot_stack.stack_statistics_ = stack_statistics;
+
+		snapshot_stack.memory_allocation_delta_ = static_cast<long long>(stack_statistics.memory_allocation_) - static_cast<long long>(compared_stack_statistics.memory_allocation_);
+
+		snapshot_stack.memory_allocation_count_delta_ = static_cast<long long>(stack_statistics.memory_allocation_count_) - static_cast<long long>(compared_stack_statistics.memory_allocation_count_);
+
+		snapshot_stack.stack_lifetime_ = tracer_shard.stack_lifetimes_[stack_id];
+
+		snapshot_stack.stack_size_classes_ = tracer_shard.stack_size_classes_[stack_id];
+
+		return snapshot_stack;
 	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void* MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::operator new(size_t size)
+	template <typename Policy>
+	typename MemoryTracer<Policy>::Baseline* MemoryTracer<Policy>::find_baseline(TracerShard& tracer_shard, const BaselineName& baseline_name)
 	{
-		return memtracer_alloc(sizeof(MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>));
+		for (Baseline& baseline : tracer_shard.baselines_)
+		{
+			if (baseline.name_ == baseline_name)
+			{
+				return &baseline;
+			}
+		}
+
+		return nullptr;
 	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::operator delete(void* block)
+	template <typename Policy>
+	void MemoryTracer<Policy>::event_log_thread_update()
 	{
-		memtracer_free(instance_);
+		// allocations for symbols and blocks are not traced.
+		is_tracer_thread_ = true;
+
+		event_log_writer_.run();
 	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::thread_update()
+	template <typename Policy>
+	void MemoryTracer<Policy>::snapshot_thread_update()
 	{
+		// allocations for reports are not traced.
+		is_tracer_thread_ = true;
+
 		while (true)
 		{
-			IMemoryOperation* memory_operation = nullptr;
+			SnapshotRequest* snapshot_request = nullptr;
+
+			ESnapshotTrigger trigger = ESnapshotTrigger::None;
 
-			if (memory_operations_.try_pop(memory_operation) == true)
 			{
-				if (memory_operation->operation_type_ == EOperationType::Allocate)
+				std::unique_lock<std::mutex> lock(snapshot_requests_mutex_);
+
+				snapshot_requests_condition_.wait(lock, [this]()
+					{
+						return snapshot_requests_.empty() == false || pending_trigger_ != ESnapshotTrigger::None || is_snapshot_thread_stopping_ == true;
+					});
+
+				if (pending_trigger_ != ESnapshotTrigger::None)
 				{
-					apply_allocation(static_cast<AllocateOperation*>(memory_operation));
+					trigger = pending_trigger_;
+
+					pending_trigger_ = ESnapshotTrigger::None;
 				}
-				else if (memory_operation->operation_type_ == EOperationType::Free)
+				else if (snapshot_requests_.empty() == true)
 				{
-					apply_free(static_cast<FreeOperation*>(memory_operation));
+					return;
 				}
-				else if (memory_operation->operation_type_ == EOperationType::Snapshot)
+				else
 				{
-					make_snapshot();
+					snapshot_request = snapshot_requests_.front();
+
+					snapshot_requests_.pop_front();
 				}
-				else if (memory_operation->operation_type_ == EOperationType::Stop)
+			}
+
+			if (trigger != ESnapshotTrigger::None)
+			{
+				push_triggered_snapshot(trigger);
+
+				continue;
+			}
+
+			// shards check the blocks which scan didn't reach, and queue it again.
+			if (snapshot_request->snapshot_type_ == ESnapshotType::Leak && snapshot_request->is_leak_scanned_ == false)
+			{
+				if (scan_leaks(*snapshot_request) == false)
 				{
-					delete memory_operation;
+					snapshot_request->promise_.set_value(false);
 
-					break;
+					delete snapshot_request;
 				}
+
+				continue;
+			}
+
+			snapshot_request->promise_.set_value(make_snapshot(*snapshot_request));
+
+			if (snapshot_request->trigger_ != ESnapshotTrigger::None)
+			{
+				is_triggered_snapshot_pending_.store(false, std::memory_order_release);
 			}
 
-			delete memory_operation;
+			delete snapshot_request;
 		}
 	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::apply_allocation(AllocateOperation* memory_operation)
+	template <typename Policy>
+	void MemoryTracer<Policy>::push_triggered_snapshot(ESnapshotTrigger trigger)
 	{
-		void* address = memory_operation->address_;
+		SnapshotRequest* snapshot_request = new SnapshotRequest();
 
-		size_t size = memory_operation->size_;
+		snapshot_request->snapshot_type_ = ESnapshotType::Full;
 
-		StackBackTrace* stack_back_trace = memory_operation->stack_back_trace_;
+		snapshot_request->trigger_ = trigger;
 
-		const CallStackHash hash = stack_back_trace->get_call_stack_hash();
+		// stop is pushed already. nobody would take the request.
+		if (push_snapshot_request_to_shards(snapshot_request) == false)
+		{
+			is_triggered_snapshot_pending_.store(false, std::memory_order_release);
 
-		address_to_size_map_[address] = size;
+			snapshot_request->promise_.set_value(false);
 
-		address_to_hash_map_[address] = hash;
+			delete snapshot_request;
+		}
+	}
 
-		if (hash_to_stack_back_trace_map_.find(hash) == hash_to_stack_back_trace_map_.end())
+	template <typename Policy>
+	void MemoryTracer<Policy>::retain_automatic_report(const TCHAR* snapshot_path)
+	{
+		if (snapshot_triggers_.max_report_count_ == 0)
 		{
-			hash_to_stack_back_trace_map_[hash] = stack_back_trace;
+			return;
 		}
-		else
+
+		automatic_report_paths_.emplace_back(snapshot_path);
+
+		while (automatic_report_paths_.size() > snapshot_triggers_.max_report_count_)
 		{
-			delete stack_back_trace;
+			if (delete_file(automatic_report_paths_.front().c_str()) == false)
+			{
+				std::cerr << "Failed to delete old automatic snapshot file." << std::endl;
+			}
+
+			automatic_report_paths_.pop_front();
 		}
+	}
 
-		hash_to_memory_allocation_map_[hash] += size;
+	template <typename Policy>
+	void MemoryTracer<Policy>::stop_snapshot_thread()
+	{
+		{
+			std::lock_guard<std::mutex> lock(snapshot_requests_mutex_);
 
-		hash_to_memory_allocation_count_map_[hash] += 1;
+			is_snapshot_thread_stopping_ = true;
+		}
 
-		total_memory_allocation_ += size;
+		snapshot_requests_condition_.notify_one();
 
-		total_memory_allocation_count_ += 1;
+		if (snapshot_thread_.joinable() == true)
+		{
+			snapshot_thread_.join();
+		}
 	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::apply_free(FreeOperation* memory_operation)
+	template <typename Policy>
+	bool MemoryTracer<Policy>::make_snapshot(SnapshotRequest& snapshot_request)
 	{
-		void* address = memory_operation->address_;
+		if (snapshot_request.snapshot_type_ == ESnapshotType::Leak && make_leak_stacks(snapshot_request) == false)
+		{
+			return false;
+		}
 
-		// do not apply memory allocations in prev start trace.
-		if (address_to_size_map_.find(address) == address_to_size_map_.end())
-			return;
+		snapshot_request.merge_snapshot_stacks();
 
-		size_t size = address_to_size_map_[address];
+		if (create_directory(report_path) == false)
+		{
+			std::cerr << "Failed to create snapshot directory." << std::endl;
+
+			return false;
+		}
 
-		CallStackHash hash = address_to_hash_map_[address];
+		// file name always fits with 20 digits of index. report path can take up to MAX_PATH, so joined path is checked.
+		TCHAR snapshot_file_name[64] = { 0 };
 
-		address_to_hash_map_.erase(address);
+		stprintf_s(snapshot_file_name, 64, TEXT("MemoryTracer_Report #%llu.mtsnap"), static_cast<unsigned long long>(snapshot_request.snapshot_index_));
 
-		address_to_size_map_.erase(address);
+		ReportPath snapshot_path(report_path);
 
-		hash_to_memory_allocation_count_map_[hash] -= 1;
+		snapshot_path += PATH_SEPARATOR;
 
-		hash_to_memory_allocation_map_[hash] -= size;
+		snapshot_path += snapshot_file_name;
 
-		if (hash_to_memory_allocation_count_map_[hash] == 0)
+		if (snapshot_path.length() >= MAX_PATH)
 		{
-			hash_to_memory_allocation_map_.erase(hash);
+			std::cerr << "Snapshot path is too long." << std::endl;
 
-			hash_to_memory_allocation_count_map_.erase(hash);
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(symbol_cache_mutex_);
+
+		if (write_snapshot_file(snapshot_path.c_str(), snapshot_request, stack_table_, symbol_cache_) == false)
+		{
+			std::cerr << "Failed to write snapshot file." << std::endl;
 
-			hash_to_stack_back_trace_map_.erase(hash);
+			return false;
 		}
 
-		total_memory_allocation_ -= size;
+		if (snapshot_request.trigger_ != ESnapshotTrigger::None)
+		{
+			retain_automatic_report(snapshot_path.c_str());
+		}
 
-		total_memory_allocation_count_ -= 1;
+		return true;
 	}
 
-	template <void*(* Alloc)(size_t), void*(* ArrayAlloc)(size_t), void(* Free)(void*), void(* ArrayFree)(void*)>
-	void MemoryTracer<Alloc, ArrayAlloc, Free, ArrayFree>::make_snapshot()
+	template <typename Policy>
+	void MemoryTracer<Policy>::get_leak_roots(MemoryRangeList& roots) const
 	{
-		HANDLE process_handle = GetCurrentProcess();
+		get_data_segments(roots);
 
-		tstring report;
-		
-		tstring report_content;
+		thread_counter_list_.get_thread_stacks(roots);
+	}
 
-		report.clear();
+	template <typename Policy>
+	bool MemoryTracer<Policy>::scan_leaks(SnapshotRequest& snapshot_request)
+	{
+		LeakBlockList& leak_blocks = snapshot_request.leak_blocks_;
 
-		report_content.clear();
+		std::sort(leak_blocks.begin(), leak_blocks.end(), [](const LeakBlock& first, const LeakBlock& second)
+			{
+				return first.address_ < second.address_;
+			});
 
-		constexpr size_t buffer_size = 1024ull;
+		MemoryRangeList roots;
 
-		TCHAR buffer[buffer_size] = { 0 };
+		get_leak_roots(roots);
 
-		std::vector<std::pair<size_t, tstring>> report_contents = std::vector<std::pair<size_t, tstring>>();
+		LeakScanner leak_scanner(leak_blocks, std::thread::hardware_concurrency(), &MemoryTracer::init_tracer_thread);
 
-		for (auto& pair : hash_to_stack_back_trace_map_)
+		if (leak_scanner.mark(roots) == false)
 		{
-			ZeroMemory(buffer, buffer_size * sizeof(TCHAR));
+			std::cerr << "Failed to read memory for leak scan." << std::endl;
 
-			report_content.clear();
-
-			CallStackHash hash = pair.first;
+			return false;
+		}
 
-			size_t total_memory_allocation = hash_to_memory_allocation_map_[hash];
+		for (size_t i = 0; i < leak_blocks.size(); i++)
+		{
+			if (leak_scanner.is_marked(i) == false)
+			{
+				snapshot_request.unreachable_blocks_.push_back(leak_blocks[i]);
+			}
+		}
 
-			size_t total_memory_allocation_count = hash_to_memory_allocation_count_map_[hash];
+		snapshot_request.is_leak_scanned_ = true;
 
-			stprintf_s(buffer, buffer_size, TEXT("------- %.2f MB / %llu times -------\r\n")
-				, static_cast<float>(total_memory_allocation) / 1024ull / 1024ull
-				, total_memory_allocation_count);
+		// snapshot thread fails the request. tracer threads won't take its second pass.
+		if (push_snapshot_request_to_shards(&snapshot_request) == false)
+		{
+			std::cerr << "Trace is stopped during leak scan." << std::endl;
 
-			report_content += buffer;
+			return false;
+		}
 
-			StackBackTrace* stack_back_trace = pair.second;
+		return true;
+	}
 
-			constexpr size_t symbol_size = sizeof(TSYMBOL_INFO) + MAX_SYM_NAME * sizeof(TCHAR);
+	template <typename Policy>
+	bool MemoryTracer<Policy>::make_leak_stacks(SnapshotRequest& snapshot_request)
+	{
+		// lists of first pass can be large on big heaps. only blocks of second pass are needed now.
+		LeakBlockList().swap(snapshot_request.leak_blocks_);
 
-			BYTE symbol_buffer[symbol_size] = { 0 };
+		LeakBlockList().swap(snapshot_request.unreachable_blocks_);
 
-			TSYMBOL_INFO* symbol = reinterpret_cast<TSYMBOL_INFO*>(symbol_buffer);
+		LeakBlockList& leaked_blocks = snapshot_request.leaked_blocks_;
 
-			for (FrameCount i = stack_back_trace->get_frame_count() - 1 ; ; i--)
+		std::sort(leaked_blocks.begin(), leaked_blocks.end(), [](const LeakBlock& first, const LeakBlock& second)
 			{
-				ZeroMemory(buffer, buffer_size);
-
-				ZeroMemory(symbol, symbol_size);
+				return first.address_ < second.address_;
+			});
 
-				symbol->SizeOfStruct = sizeof(TSYMBOL_INFO);
+		// roots may have changed since first scan. allocations since then were not scanned at all.
+		MemoryRangeList roots;
 
-				symbol->MaxNameLen = MAX_SYM_NAME;
+		get_leak_roots(roots);
 
-				if (TSymFromAddr(process_handle, reinterpret_cast<DWORD64>(stack_back_trace->get_stack_frame(i)), NULL, symbol) == TRUE)
-				{
-					TIMAGEHLP_LINE64 line_info;
+		for (const LeakBlock& young_block : snapshot_request.young_blocks_)
+		{
+			const uintptr_t begin = reinterpret_cast<uintptr_t>(young_block.address_);
 
-					ZeroMemory(&line_info, sizeof(TIMAGEHLP_LINE64));
+			roots.push_back(MemoryRange{ begin, begin + young_block.size_ });
+		}
 
-					line_info.SizeOfStruct = sizeof(TIMAGEHLP_LINE64);
+		LeakScanner leak_scanner(leaked_blocks, std::thread::hardware_concurrency(), &MemoryTracer::init_tracer_thread);
 
-					DWORD displacement = 0;
+		if (leak_scanner.mark(roots) == false)
+		{
+			std::cerr << "Failed to read memory for leak scan." << std::endl;
 
-					if (TSymGetLineFromAddr64(process_handle, reinterpret_cast<DWORD64>(stack_back_trace->get_stack_frame(i)), &displacement, &line_info) == TRUE)
-					{
-						stprintf_s(buffer, buffer_size, TEXT("%p - %s : %s (%d)\r\n"), reinterpret_cast<void*>(symbol->Address), symbol->Name, line_info.FileName, line_info.LineNumber);
-					}
-					else
-					{
-						stprintf_s(buffer, buffer_size, TEXT("%p - %s : Failed to get file info.\r\n"), reinterpret_cast<void*>(symbol->Address), symbol->Name);
-					}
-				}
-				else
-				{
-					stprintf_s(buffer, buffer_size, TEXT("%p : Failed to get symbol info.\r\n"), stack_back_trace->get_stack_frame(i));
-				}
+			return false;
+		}
 
-				report_content += buffer;
+		LeakBlockList unreached_blocks;
 
-				if (i == 0)
-				{
-					break;
-				}
+		for (size_t i = 0; i < leaked_blocks.size(); i++)
+		{
+			if (leak_scanner.is_marked(i) == false)
+			{
+				unreached_blocks.push_back(leaked_blocks[i]);
 			}
-
-			report_contents.push_back({ total_memory_allocation, report_content });
 		}
 
-		std::sort(report_contents.begin(), report_contents.end(), [](const std::pair<size_t, tstring>& first, const std::pair<size_t, tstring>& second)
+		std::sort(unreached_blocks.begin(), unreached_blocks.end(), [](const LeakBlock& first, const LeakBlock& second)
 			{
-				return first.first > second.first;
+				return first.stack_id_ < second.stack_id_;
 			});
 
-		for (auto& pair_content : report_contents)
+		for (const LeakBlock& unreached_block : unreached_blocks)
 		{
-			const tstring& content = pair_content.second;
+			if (snapshot_request.snapshot_stacks_.empty() == true || snapshot_request.snapshot_stacks_.back().stack_id_ != unreached_block.stack_id_)
+			{
+				SnapshotStack snapshot_stack;
 
-			report += content;
-		}
+				std::memset(&snapshot_stack, 0, sizeof(SnapshotStack));
 
-		// don't have any memory allocations.
-		if (report.empty() == true)
-		{
-			report = TEXT("Don't have any memory allocations.");
-		}
+				snapshot_stack.stack_id_ = unreached_block.stack_id_;
 
-		if (CreateDirectory(report_path, NULL) == TRUE ||
-			GetLastError() == ERROR_ALREADY_EXISTS)
-		{
-			stprintf_s(buffer, buffer_size, TEXT("%s\\MemoryTracer_Report #%llu.txt"), report_path, snapshot_index++);
+				snapshot_request.snapshot_stacks_.push_back(snapshot_stack);
+			}
 
-			HANDLE file_handle = CreateFile(
-				buffer
-				, GENERIC_WRITE
-				, 0
-				, NULL
-				, CREATE_ALWAYS
-				, FILE_ATTRIBUTE_NORMAL
-				, NULL);
+			SnapshotStack& snapshot_stack = snapshot_request.snapshot_stacks_.back();
 
-			if (file_handle != INVALID_HANDLE_VALUE)
-			{
-				DWORD bytesWritten = 0;
+			snapshot_stack.stack_statistics_.memory_allocation_ += unreached_block.size_;
 
-				DWORD targetBytes = static_cast<DWORD>(report.length() * sizeof(TCHAR));
+			snapshot_stack.stack_statistics_.memory_allocation_count_++;
 
-				if (WriteFile(file_handle, report.c_str(), targetBytes, &bytesWritten, NULL) == TRUE)
-				{
-					if (targetBytes != bytesWritten)
-					{
-						std::cerr << "Failed to write file all snapshot's contents." << std::endl;
-					}
-				}
-				else
-				{
-					std::cerr << "Failed to write snapshot file." << std::endl;
-				}
-			}
-			else
-			{
-				std::cerr << "Failed to create snapshot file." << std::endl;
-			}
+			const unsigned int size_class = get_size_class(unreached_block.size_);
 
-			CloseHandle(file_handle);
-		}
-		else
-		{
-			std::cerr << "Failed to create snapshot directory." << std::endl;
+			snapshot_stack.stack_size_classes_.live_counts_[size_class]++;
+
+			snapshot_request.size_class_statistics_.live_memory_allocations_[size_class] += unreached_block.size_;
+
+			snapshot_request.size_class_statistics_.live_counts_[size_class]++;
 		}
 
-		CloseHandle(process_handle);
+		return true;
 	}
 }
@@ -1,8 +1,21 @@
 #pragma once
+#include <cstddef>
 
 namespace memtracer
 {
+	// memory of the tracer itself. blocks of memtracer_alloc are in its private arena, never in the program heap.
+	struct ArenaStatistics
+	{
+		// bytes of blocks in use, rounded up to their size class.
+		size_t used_memory_;
+
+		// bytes mapped from os. slabs are kept, so this doesn't go down when blocks are freed.
+		size_t mapped_memory_;
+	};
+
 	void* memtracer_alloc(size_t size);
 
 	void memtracer_free(void* p);
+
+	ArenaStatistics get_arena_statistics();
 }
@@ -4,7 +4,7 @@
 namespace memtracer
 {
 	template <typename T>
-	class MemoryTracerAllocator final
+	class MemoryTracerAllocator
 	{
     public:
         using value_type = T;
@@ -24,4 +24,16 @@ namespace memtracer
             memtracer_free(p);
         }
     };
+
+    template <typename T, typename U>
+    bool operator==(const MemoryTracerAllocator<T>&, const MemoryTracerAllocator<U>&) noexcept
+    {
+        return true;
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const MemoryTracerAllocator<T>&, const MemoryTracerAllocator<U>&) noexcept
+    {
+        return false;
+    }
 }
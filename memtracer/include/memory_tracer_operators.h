@@ -0,0 +1,161 @@
+#pragma once
+#include <new>
+
+#include "memory_tracer.h"
+
+// replaces every global operator new / delete with MemoryTracer<MEMTRACER_POLICY>.
+// include in exactly one source file of the program. replacement functions must not be defined twice.
+// define MEMTRACER_POLICY before including to choose depth and features. (e.g. memtracer::TracerPolicy<16, 2, 64, false>)
+//
+// C functions can't be replaced here, because default TracerPolicy allocates with malloc itself.
+// route them by memtracer::traced_malloc / traced_calloc / traced_realloc / traced_free instead.
+
+#ifndef MEMTRACER_POLICY
+#	define MEMTRACER_POLICY memtracer::TracerPolicy<>
+#endif // MEMTRACER_POLICY
+
+namespace memtracer
+{
+	// tracer of the replaced operators. start, snapshots and queries go through it.
+	using OperatorTracer = MemoryTracer<MEMTRACER_POLICY>;
+
+	inline void* traced_malloc(size_t size)
+	{
+		return OperatorTracer::get_instance()->add_allocation(size);
+	}
+
+	inline void* traced_calloc(size_t count, size_t size)
+	{
+		return OperatorTracer::get_instance()->add_zeroed_allocation(count, size);
+	}
+
+	inline void* traced_realloc(void* block, size_t size)
+	{
+		return OperatorTracer::get_instance()->reallocate(block, size);
+	}
+
+	inline void traced_free(void* block)
+	{
+		OperatorTracer::get_instance()->remove_allocation(block);
+	}
+
+	// operator new must not return nullptr, even for 0 bytes.
+	inline void* throw_if_null(void* block)
+	{
+		if (block == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+
+		return block;
+	}
+}
+
+#pragma region new
+void* operator new(size_t size)
+{
+	return memtracer::throw_if_null(memtracer::OperatorTracer::get_instance()->add_allocation(size != 0 ? size : 1));
+}
+
+void* operator new[](size_t size)
+{
+	return memtracer::throw_if_null(memtracer::OperatorTracer::get_instance()->add_array_allocation(size != 0 ? size : 1));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return memtracer::OperatorTracer::get_instance()->add_allocation(size != 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return memtracer::OperatorTracer::get_instance()->add_array_allocation(size != 0 ? size : 1);
+}
+
+#ifdef __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	return memtracer::throw_if_null(memtracer::OperatorTracer::get_instance()->add_aligned_allocation(size != 0 ? size : 1, static_cast<size_t>(alignment)));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return memtracer::throw_if_null(memtracer::OperatorTracer::get_instance()->add_aligned_array_allocation(size != 0 ? size : 1, static_cast<size_t>(alignment)));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return memtracer::OperatorTracer::get_instance()->add_aligned_allocation(size != 0 ? size : 1, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return memtracer::OperatorTracer::get_instance()->add_aligned_array_allocation(size != 0 ? size : 1, static_cast<size_t>(alignment));
+}
+#endif // __cpp_aligned_new
+#pragma endregion
+
+#pragma region delete
+void operator delete(void* block) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_allocation(block);
+}
+
+void operator delete[](void* block) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_array_allocation(block);
+}
+
+void operator delete(void* block, const std::nothrow_t&) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_allocation(block);
+}
+
+void operator delete[](void* block, const std::nothrow_t&) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_array_allocation(block);
+}
+
+// sized delete. 0 byte new allocated 1 byte.
+void operator delete(void* block, size_t size) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_allocation(block, size != 0 ? size : 1);
+}
+
+void operator delete[](void* block, size_t size) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_array_allocation(block, size != 0 ? size : 1);
+}
+
+#ifdef __cpp_aligned_new
+void operator delete(void* block, std::align_val_t) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_aligned_allocation(block);
+}
+
+void operator delete[](void* block, std::align_val_t) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_aligned_array_allocation(block);
+}
+
+void operator delete(void* block, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_aligned_allocation(block);
+}
+
+void operator delete[](void* block, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_aligned_array_allocation(block);
+}
+
+void operator delete(void* block, size_t size, std::align_val_t) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_aligned_allocation(block, size != 0 ? size : 1);
+}
+
+void operator delete[](void* block, size_t size, std::align_val_t) noexcept
+{
+	memtracer::OperatorTracer::get_instance()->remove_aligned_array_allocation(block, size != 0 ? size : 1);
+}
+#endif // __cpp_aligned_new
+#pragma endregion
@@ -0,0 +1,96 @@
+#pragma once
+#include "core_define.h"
+#include "memory_tracer_allocator.h"
+
+namespace memtracer
+{
+	struct FrameSymbol
+	{
+		void* symbol_address_;
+
+		tstring symbol_name_;
+
+		tstring file_name_;
+
+		unsigned int line_number_;
+
+		bool has_line_;
+	};
+
+	// [begin_, end_) of process memory.
+	struct MemoryRange
+	{
+		uintptr_t begin_;
+
+		uintptr_t end_;
+	};
+
+	using MemoryRangeList = std::vector<MemoryRange, MemoryTracerAllocator<MemoryRange>>;
+
+	// HANDLE on windows, file descriptor on linux.
+	using FileHandle = intptr_t;
+
+	constexpr FileHandle INVALID_FILE_HANDLE = -1;
+
+	// start of memory from allocate_pages is aligned to this. (allocation granularity of windows)
+	constexpr size_t PAGE_ALLOCATION_ALIGNMENT = 1ull << 16;
+
+	constexpr size_t OS_PAGE_SIZE = 4096;
+
+	// IOV_MAX of linux.
+	constexpr size_t MAX_READ_MEMORY_RANGES = 1024;
+
+#pragma region platform
+	// implemented by platform_windows.cpp and platform_linux.cpp.
+
+	// captures return addresses of the caller. this function itself is not counted in frames_to_skip.
+	FrameCount capture_stack_frames(unsigned int frames_to_skip, unsigned int max_frames, void** frames);
+
+	bool initialize_symbols();
+
+	void finalize_symbols();
+
+	// returns false when frame has no symbol. only called in tracer thread.
+	bool resolve_frame_symbol(void* frame, FrameSymbol& frame_symbol);
+
+	// returns true when directory is created or already exists.
+	bool create_directory(const TCHAR* path);
+
+	// creates or truncates file for writing.
+	FileHandle open_file(const TCHAR* path);
+
+	bool write_file(FileHandle file_handle, const void* data, size_t size);
+
+	bool close_file(FileHandle file_handle);
+
+	bool delete_file(const TCHAR* path);
+
+	// read only view of whole file. nullptr when file can't be opened or is empty.
+	const void* map_file(const TCHAR* path, size_t& size);
+
+	void unmap_file(const void* data, size_t size);
+
+	// zeroed read write memory from os, not from heap of the program. size is multiple of OS_PAGE_SIZE.
+	// nullptr when os has no memory.
+	void* allocate_pages(size_t size);
+
+	// size is same as allocate_pages.
+	void free_pages(void* pages, size_t size);
+
+	// stack of calling thread, including pages which are not committed yet. false when it is unknown.
+	bool get_thread_stack(uintptr_t& stack_low, uintptr_t& stack_high);
+
+	// writable sections of loaded modules. (data and bss)
+	void get_data_segments(MemoryRangeList& data_segments);
+
+	// copies memory of this process without faulting. stops at first page which can't be read, and returns bytes copied.
+	size_t read_memory(const void* address, void* buffer, size_t size);
+
+	// read_memory of many ranges by one call. ranges are copied back to back. at most MAX_READ_MEMORY_RANGES.
+	size_t read_memory_ranges(const MemoryRange* ranges, size_t range_count, void* buffer);
+
+	std::string convert_to_utf8(const tstring& text);
+
+	tstring convert_from_utf8(const std::string& text);
+#pragma endregion
+}
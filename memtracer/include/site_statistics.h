@@ -0,0 +1,52 @@
+#pragma once
+#include "core_define.h"
+
+namespace memtracer
+{
+	enum class ESiteSortKey : unsigned char
+	{
+		LiveBytes,
+		LiveCount,
+		// allocated since first start, freed or not.
+		TotalBytes,
+		TotalCount
+	};
+
+	// one call site of MemoryTracer::query_top_sites. estimated when sampling is enabled.
+	struct SiteStatistics
+	{
+		StackId stack_id_;
+
+		size_t memory_allocation_;
+
+		size_t memory_allocation_count_;
+
+		size_t total_memory_allocation_;
+
+		size_t total_allocation_count_;
+
+		// return addresses, innermost first. symbols are resolved on demand by MemoryTracer::resolve_site_frames.
+		std::vector<void*> frames_;
+	};
+
+	// all call sites in real time. estimated when sampling is enabled.
+	// allocations are counted as they happen, frees as tracer threads apply them. live values can be high by queued frees.
+	struct MemoryTotals
+	{
+		size_t memory_allocation_;
+
+		size_t memory_allocation_count_;
+
+		// allocated since first start, freed or not. rates are changes of them between two calls.
+		size_t total_memory_allocation_;
+
+		size_t total_allocation_count_;
+
+		// highest live bytes of each tracer thread in applied order, summed. exact with one tracer thread.
+		// with more, an upper bound of peak of the process, because shards peak at different times.
+		size_t peak_memory_allocation_upper_bound_;
+
+		// get_timestamp() of the call.
+		Timestamp timestamp_;
+	};
+}
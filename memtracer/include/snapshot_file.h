@@ -0,0 +1,63 @@
+#pragma once
+#include "core_define.h"
+#include "snapshot_format.h"
+#include "snapshot_request.h"
+#include "stack_table.h"
+#include "symbol_cache.h"
+
+namespace memtracer
+{
+	// writes snapshot_request as a binary snapshot file. frames are resolved through symbol_cache.
+	bool write_snapshot_file(const TCHAR* path, const SnapshotRequest& snapshot_request, const StackTable& stack_table, SymbolCache& symbol_cache);
+
+	// read only, memory mapped binary snapshot file.
+	class SnapshotFile final
+	{
+	public:
+		SnapshotFile();
+
+		~SnapshotFile();
+
+		DELETE_CLASS_COPY_MOVE(SnapshotFile)
+
+		// maps file and validates its sections. returns false for unknown version or broken file.
+		bool open(const TCHAR* path);
+
+		void close();
+
+		const SnapshotFileHeader& get_header() const;
+
+		const SnapshotFileStack& get_stack(size_t index) const;
+
+		// free counts of header.lifetime_bucket_count_ lifetime buckets. index is in [0, header.stack_count_).
+		const uint64_t* get_stack_lifetime_buckets(size_t index) const;
+
+		// live bytes, live counts and total counts of all stacks. header.size_class_count_ each.
+		const uint64_t* get_size_classes() const;
+
+		// live counts and total counts of a stack. header.size_class_count_ each.
+		const uint64_t* get_stack_size_classes(size_t index) const;
+
+		// index is in [0, stack.frame_count_). 0 is innermost frame.
+		const SnapshotFileFrame& get_stack_frame(const SnapshotFileStack& stack, size_t index) const;
+
+		// index of get_stack_frame's frame in frame section. same frame of different stacks has same index.
+		uint32_t get_stack_frame_index(const SnapshotFileStack& stack, size_t index) const;
+
+		// index is in [0, header.frame_count_).
+		const SnapshotFileFrame& get_frame(size_t index) const;
+
+		// nullptr for SNAPSHOT_FILE_NO_STRING.
+		const char* get_string(uint32_t offset) const;
+
+	private:
+		bool validate() const;
+
+		template <typename T>
+		const T* get_section(uint64_t offset) const;
+
+		const char* data_;
+
+		size_t size_;
+	};
+}
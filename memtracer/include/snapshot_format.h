@@ -0,0 +1,177 @@
+#pragma once
+#include <cstdint>
+
+namespace memtracer
+{
+	// binary snapshot file. (MemoryTracer_Snapshot #N.mtsnap)
+	// all sections are 8 byte aligned, so a mapped file is read in place.
+	//
+	// [SnapshotFileHeader]
+	// [SnapshotFileStack x stack_count_]
+	// [uint64_t free count x lifetime_bucket_count_ x stack_count_] : lifetime histogram of each stack.
+	// [uint64_t x size_class_count_ x 3] : live bytes, live counts and total counts of all stacks by size class.
+	// [uint64_t x size_class_count_ x 2 x stack_count_] : live counts and total counts of each stack by size class.
+	// [SnapshotFileFrame x frame_count_]
+	// [uint32_t frame index x frame_index_count_] : frames of each stack, innermost first.
+	// [string table] : null terminated UTF-8 strings. referenced by byte offset.
+	constexpr char SNAPSHOT_FILE_MAGIC[8] = { 'M', 'T', 'S', 'N', 'A', 'P', '\0', '\0' };
+
+	// 2 : snapshot type, baseline name and deltas of stacks.
+	// 3 : buffer policy and dropped / degraded record counters.
+	// 4 : traced time, total allocations and lifetime histograms of stacks.
+	// 5 : size class histograms.
+	// 6 : memory of the tracer itself.
+	// 7 : leak snapshot type.
+	// 8 : trigger of automatic snapshot.
+	// 9 : samples which overflowed sampled address set.
+	constexpr uint32_t SNAPSHOT_FILE_VERSION = 9;
+
+	constexpr uint32_t SNAPSHOT_FILE_NO_STRING = 0xFFFFFFFFu;
+
+	// the file is written and read by the same kind of machine.
+	constexpr uint32_t SNAPSHOT_FILE_ENDIAN_TAG = 0x01020304u;
+
+	// SnapshotFileHeader::snapshot_type_. same values as ESnapshotType.
+	constexpr uint32_t SNAPSHOT_FILE_TYPE_FULL = 0;
+
+	constexpr uint32_t SNAPSHOT_FILE_TYPE_DIFF = 1;
+
+	// live bytes and counts of stacks are the ones of unreachable allocations. stacks have no lifetimes.
+	constexpr uint32_t SNAPSHOT_FILE_TYPE_LEAK = 4;
+
+	// SnapshotFileHeader::trigger_. same values as ESnapshotTrigger.
+	constexpr uint32_t SNAPSHOT_FILE_TRIGGER_NONE = 0;
+
+	constexpr uint32_t SNAPSHOT_FILE_TRIGGER_THRESHOLD = 1;
+
+	constexpr uint32_t SNAPSHOT_FILE_TRIGGER_GROWTH = 2;
+
+	constexpr uint32_t SNAPSHOT_FILE_TRIGGER_PEAK = 3;
+
+	constexpr uint32_t SNAPSHOT_FILE_TRIGGER_INTERVAL = 4;
+
+	// SnapshotFileHeader::buffer_policy_. same values as EBufferPolicy.
+	constexpr uint32_t SNAPSHOT_FILE_BUFFER_POLICY_BLOCK = 0;
+
+	constexpr uint32_t SNAPSHOT_FILE_BUFFER_POLICY_DROP_AND_COUNT = 1;
+
+	constexpr uint32_t SNAPSHOT_FILE_BUFFER_POLICY_DEGRADE = 2;
+
+	// SnapshotFileFrame::flags_
+	constexpr uint32_t SNAPSHOT_FILE_FRAME_HAS_SYMBOL = 1u << 0;
+
+	constexpr uint32_t SNAPSHOT_FILE_FRAME_HAS_LINE = 1u << 1;
+
+	struct SnapshotFileHeader
+	{
+		char magic_[8];
+
+		uint32_t version_;
+
+		uint32_t endian_tag_;
+
+		uint64_t snapshot_index_;
+
+		uint32_t snapshot_type_;
+
+		// string offset. SNAPSHOT_FILE_NO_STRING for full snapshot or diff with previous snapshot.
+		uint32_t baseline_name_;
+
+		// 0 when all allocations are traced.
+		uint64_t sampling_interval_;
+
+		uint32_t buffer_policy_;
+
+		// SNAPSHOT_FILE_TRIGGER_NONE when the program took the snapshot.
+		uint32_t trigger_;
+
+		// counted since start until this snapshot.
+		uint64_t dropped_allocation_count_;
+
+		uint64_t dropped_free_count_;
+
+		uint64_t degraded_allocation_count_;
+
+		// samples which were not traced, because sampled address set was full. estimates are low when it isn't 0.
+		uint64_t overflowed_sample_count_;
+
+		// ns of trace until this snapshot.
+		uint64_t traced_time_;
+
+		// bytes of tracer's arena. blocks in use and mapped from os.
+		uint64_t tracer_used_memory_;
+
+		uint64_t tracer_mapped_memory_;
+
+		// bucket 0 is lifetime under 2^10 ns. bucket i is [2^(i + 9), 2^(i + 10)) ns.
+		uint32_t lifetime_bucket_count_;
+
+		// class 0 is sizes up to 16 bytes, class i is (2^(i + 3), 2^(i + 4)] bytes.
+		uint32_t size_class_count_;
+
+		uint64_t stack_count_;
+
+		uint64_t stack_offset_;
+
+		uint64_t lifetime_offset_;
+
+		uint64_t size_class_offset_;
+
+		uint64_t stack_size_class_offset_;
+
+		uint64_t frame_count_;
+
+		uint64_t frame_offset_;
+
+		uint64_t frame_index_count_;
+
+		uint64_t frame_index_offset_;
+
+		uint64_t string_table_size_;
+
+		uint64_t string_table_offset_;
+	};
+
+	struct SnapshotFileStack
+	{
+		uint64_t memory_allocation_;
+
+		uint64_t memory_allocation_count_;
+
+		// change since previous snapshot or baseline.
+		int64_t memory_allocation_delta_;
+
+		int64_t memory_allocation_count_delta_;
+
+		// allocated since start, freed or not.
+		uint64_t total_memory_allocation_;
+
+		uint64_t total_allocation_count_;
+
+		// range of frame index section.
+		uint32_t first_frame_index_;
+
+		uint32_t frame_count_;
+	};
+
+	struct SnapshotFileFrame
+	{
+		uint64_t address_;
+
+		uint64_t symbol_address_;
+
+		uint32_t symbol_name_;
+
+		uint32_t file_name_;
+
+		uint32_t line_number_;
+
+		uint32_t flags_;
+	};
+
+	static_assert(sizeof(SnapshotFileHeader) % 8 == 0, "SnapshotFileHeader must keep sections aligned.");
+
+	static_assert(sizeof(SnapshotFileStack) == 56, "SnapshotFileStack layout is part of the file format.");
+
+	static_assert(sizeof(SnapshotFileFrame) == 32, "SnapshotFileFrame layout is part of the file format.");
+}
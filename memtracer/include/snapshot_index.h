@@ -0,0 +1,81 @@
+#pragma once
+#include "core_define.h"
+#include "snapshot_file.h"
+
+namespace memtracer
+{
+	// function to stacks inverted index of a snapshot file.
+	// built in one pass over frames and one over frame indices. names stay in the mapped file until a query reads them.
+	// values are live bytes and counts of the stacks in the file. a stack is counted once per query.
+	class SnapshotIndex final
+	{
+	public:
+		struct Function
+		{
+			// symbol address, or return address when frame has no symbol.
+			uint64_t address_;
+
+			// string offsets in snapshot file. SNAPSHOT_FILE_NO_STRING when unknown.
+			uint32_t name_;
+
+			uint32_t file_name_;
+		};
+
+		struct FunctionStatistics
+		{
+			uint32_t function_;
+
+			uint64_t memory_allocation_;
+
+			uint64_t memory_allocation_count_;
+		};
+
+		SnapshotIndex();
+
+		~SnapshotIndex();
+
+		DELETE_CLASS_COPY_MOVE(SnapshotIndex)
+
+		// snapshot_file must outlive the index.
+		void build(const SnapshotFile& snapshot_file);
+
+		size_t get_function_count() const;
+
+		const Function& get_function(uint32_t index) const;
+
+		// symbol name, or hex address when frame has no symbol.
+		std::string get_function_name(uint32_t index) const;
+
+		// functions whose symbol name contains pattern. file name is matched too with is_file_name_matched.
+		std::vector<uint32_t> find_functions(const std::string& pattern, bool is_file_name_matched) const;
+
+		// stacks which pass through any of functions. function_ of result is unused.
+		FunctionStatistics get_beneath(const std::vector<uint32_t>& functions) const;
+
+		// each function with stacks which pass through it, most bytes first. at most count.
+		std::vector<FunctionStatistics> get_top_functions(const std::vector<uint32_t>& functions, size_t count) const;
+
+		// direct callers (is_caller) or callees of functions, weighted by stacks through the call. at most count.
+		// calls between functions themselves (e.g. recursion) are not counted.
+		std::vector<FunctionStatistics> get_neighbors(const std::vector<uint32_t>& functions, bool is_caller, size_t count) const;
+
+	private:
+		// stacks of function are stack_indices_[stack_offsets_[function], stack_offsets_[function + 1]). ascending.
+		const uint32_t* get_stacks_begin(uint32_t function) const;
+
+		const uint32_t* get_stacks_end(uint32_t function) const;
+
+		static void sort_and_truncate(std::vector<FunctionStatistics>& function_statistics, size_t count);
+
+		const SnapshotFile* snapshot_file_;
+
+		std::vector<Function> functions_;
+
+		// indexed by frame index of snapshot file.
+		std::vector<uint32_t> frame_functions_;
+
+		std::vector<uint32_t> stack_offsets_;
+
+		std::vector<uint32_t> stack_indices_;
+	};
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include "core_define.h"
+#include "buffer_policy.h"
+#include "leak_scanner.h"
+#include "memory_tracer_allocator.h"
+#include "snapshot_trigger.h"
+#include "stack_statistics.h"
+
+namespace memtracer
+{
+	enum class ESnapshotType : unsigned char
+	{
+		// all live stacks.
+		Full,
+		// stacks changed since previous snapshot or a baseline.
+		Diff,
+		// only marks a named point for later diffs. no report.
+		Baseline,
+		// copy of stacks for MemoryTracer::query_top_sites. no report, and diffs don't see it.
+		Query,
+		// live allocations which leak scan couldn't reach, by stack. diffs don't see it.
+		Leak
+	};
+
+	// name of baseline. allocated by user thread, so it must not be traced.
+	using BaselineName = std::basic_string<TCHAR, std::char_traits<TCHAR>, MemoryTracerAllocator<TCHAR>>;
+
+	// path of written report. kept by snapshot thread for retention of automatic reports.
+	using ReportPath = std::basic_string<TCHAR, std::char_traits<TCHAR>, MemoryTracerAllocator<TCHAR>>;
+
+	struct SnapshotStack
+	{
+		StackId stack_id_;
+
+		StackStatistics stack_statistics_;
+
+		// change since the point which is compared. (previous snapshot or baseline)
+		long long memory_allocation_delta_;
+
+		long long memory_allocation_count_delta_;
+
+		StackLifetime stack_lifetime_;
+
+		StackSizeClasses stack_size_classes_;
+	};
+
+	// created by take_snapshot (or query_top_sites) and passed through the event rings of every tracer shard.
+	// each tracer thread adds its shard's stacks, snapshot thread merges them, writes the report and completes promise_.
+	// a query is merged by the querying thread instead.
+	struct SnapshotRequest final
+	{
+		SnapshotRequest();
+
+		~SnapshotRequest();
+
+		DELETE_CLASS_COPY_MOVE(SnapshotRequest)
+
+		void* operator new(size_t size);
+
+		void operator delete(void* p);
+
+		// shards add the same stack separately. sums them into one entry per stack and
+		// removes stacks of Diff whose total didn't change. (e.g. freed and allocated again)
+		// estimates of sampled requests are rounded from fixed point after they are summed. called once.
+		void merge_snapshot_stacks();
+
+		// called once per shard with its histogram at the snapshot.
+		void add_size_class_statistics(const SizeClassStatistics& size_class_statistics);
+
+		// true when report is written.
+		std::promise<bool> promise_;
+
+		ESnapshotType snapshot_type_;
+
+		// condition of automatic snapshot. None when the program took it.
+		ESnapshotTrigger trigger_;
+
+		// Diff : compared baseline. empty compares with previous snapshot.
+		// Baseline : name of new baseline.
+		BaselineName baseline_name_;
+
+		size_t snapshot_index_;
+
+		// 0 when all allocations are traced. otherwise bytes and counts are fixed point estimates until merge_snapshot_stacks.
+		size_t sampling_interval_;
+
+		EBufferPolicy buffer_policy_;
+
+		// counters when last tracer thread took the request.
+		BufferStatistics buffer_statistics_;
+
+		// samples which had no slot in sampled address set. estimates are low by them.
+		size_t overflowed_sample_count_;
+
+		// memory of the tracer when last tracer thread took the request.
+		ArenaStatistics arena_statistics_;
+
+		// ns of trace since first start, without stopped time.
+		unsigned long long traced_time_;
+
+		// sum of all shards.
+		SizeClassStatistics size_class_statistics_;
+
+		// shards which didn't add their stacks yet. guarded by tracer's snapshot requests lock.
+		size_t pending_shard_count_;
+
+		// false when any shard failed. (e.g. unknown baseline)
+		bool is_valid_;
+
+		// Leak : passes through shards twice. first pass copies live allocations, second one checks blocks which scan didn't reach.
+		bool is_leak_scanned_;
+
+		// Leak : live allocations of all shards at first pass. sorted by snapshot thread.
+		LeakBlockList leak_blocks_;
+
+		// Leak : blocks which first scan didn't reach.
+		LeakBlockList unreachable_blocks_;
+
+		// Leak : unreachable blocks which are still live at second pass. second scan reports the ones it doesn't reach either.
+		LeakBlockList leaked_blocks_;
+
+		// Leak : allocations since first pass. roots of second scan, because they weren't scanned.
+		LeakBlockList young_blocks_;
+
+		// point in time copy of stacks which have live or freed allocations. (Full) or changed stacks. (Diff)
+		std::vector<SnapshotStack, MemoryTracerAllocator<SnapshotStack>> snapshot_stacks_;
+
+	private:
+		// fixed point estimates of merged stacks and size classes to bytes and counts.
+		void round_estimates();
+	};
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "core_define.h"
+
+namespace memtracer
+{
+	// condition which took an automatic snapshot. None for snapshots which the program takes.
+	enum class ESnapshotTrigger : unsigned char
+	{
+		None,
+		// live bytes rose to threshold.
+		Threshold,
+		// live bytes grew by growth percent since previous automatic snapshot.
+		Growth,
+		// live bytes reached a new peak.
+		Peak,
+		// interval passed since previous automatic snapshot.
+		Interval
+	};
+
+	// automatic snapshots, checked by first tracer thread between drain passes. 0 (or false) turns a condition off,
+	// so zero initialized triggers take no snapshot. live bytes are the ones of MemoryTracer::get_totals.
+	struct SnapshotTriggers
+	{
+		// fires when live bytes rise to it. fires again after live bytes fall below it.
+		size_t live_bytes_threshold_;
+
+		// fires when live bytes grow by this percent since previous automatic snapshot, or since start.
+		unsigned int growth_percent_;
+
+		// fires when peak live bytes grow since previous automatic snapshot, or since start.
+		// peak is MemoryTotals::peak_memory_allocation_upper_bound_, so a new peak of any tracer thread fires it.
+		bool is_peak_enabled_;
+
+		unsigned int interval_milliseconds_;
+
+		// rate limit. no automatic snapshot within this time of previous one, and never two at once.
+		// conditions which still hold after it fire then.
+		unsigned int min_interval_milliseconds_;
+
+		// automatic reports which this process keeps on disk. oldest one is deleted after a new one is written.
+		// 0 keeps all of them. reports which the program takes are never deleted.
+		unsigned int max_report_count_;
+	};
+}
@@ -10,7 +10,9 @@ namespace memtracer
 
 		~StackBackTrace();
 
-		DELETE_CLASS_COPY_MOVE(StackBackTrace)
+		StackBackTrace(const StackBackTrace& other) = default;
+
+		StackBackTrace& operator=(const StackBackTrace& other) = default;
 
 		void* operator new(size_t size);
 
@@ -20,6 +22,15 @@ namespace memtracer
 
 		void operator delete[](void* p);
 
+		// capture call stack of caller. must be called directly in traced function.
+		// frames_to_skip counts capture itself. hash_bits is 32 or 64.
+		void capture(unsigned int frames_to_skip, unsigned int max_frames, unsigned int hash_bits);
+
+		// recorded call stack. (e.g. event log replay) hashed like capture.
+		void assign(void* const* frames, FrameCount frame_count, unsigned int hash_bits);
+
+		bool operator==(const StackBackTrace& other) const;
+
 		CallStackHash get_call_stack_hash() const;
 
 		FrameCount get_frame_count() const;
@@ -27,6 +38,8 @@ namespace memtracer
 		void* get_stack_frame(FrameCount index) const;
 
 	private:
+		void update_call_stack_hash(unsigned int hash_bits);
+
 		void* stack_frames[MAX_STACK_FRAMES];
 
 		FrameCount frame_count_;
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace memtracer
+{
+	// live allocations of one call stack. indexed by StackId.
+	struct StackStatistics
+	{
+		size_t memory_allocation_;
+
+		size_t memory_allocation_count_;
+	};
+
+	// floor of log2. 0 for 0.
+	inline unsigned int get_log2(unsigned long long value)
+	{
+		unsigned int log2 = 0;
+
+		for (unsigned int shift = 32; shift != 0; shift >>= 1)
+		{
+			if ((value >> shift) != 0)
+			{
+				value >>= shift;
+
+				log2 += shift;
+			}
+		}
+
+		return log2;
+	}
+
+	// bucket 0 is under 2^10 ns (about 1 us), bucket i is [2^(i + 9), 2^(i + 10)) ns.
+	// last bucket has all longer lifetimes.
+	constexpr unsigned int LIFETIME_BUCKET_COUNT = 32;
+
+	inline unsigned int get_lifetime_bucket(unsigned long long nanoseconds)
+	{
+		const unsigned int log2 = get_log2(nanoseconds);
+
+		return log2 < 10 ? 0 : (log2 - 9 < LIFETIME_BUCKET_COUNT ? log2 - 9 : LIFETIME_BUCKET_COUNT - 1);
+	}
+
+	// smallest lifetime of bucket in ns.
+	inline unsigned long long get_lifetime_bucket_lower_bound(unsigned int bucket)
+	{
+		return bucket == 0 ? 0 : 1ull << (bucket + 9);
+	}
+
+	// all allocations of one call stack since first start, including freed ones. indexed by StackId.
+	struct StackLifetime
+	{
+		// estimated when sampling is enabled.
+		size_t total_memory_allocation_;
+
+		size_t total_allocation_count_;
+
+		// freed allocations by lifetime. counts of traced frees, not scaled by sampling.
+		uint64_t lifetime_buckets_[LIFETIME_BUCKET_COUNT];
+	};
+
+	// class 0 is sizes up to 16 bytes, class i is (2^(i + 3), 2^(i + 4)] bytes. last class has all larger sizes.
+	// a class is the power of two size an allocator would round the size up to.
+	constexpr unsigned int SIZE_CLASS_COUNT = 32;
+
+	inline unsigned int get_size_class(size_t size)
+	{
+		if (size <= 16)
+		{
+			return 0;
+		}
+
+		// ceil of log2.
+		const unsigned int log2 = get_log2(static_cast<unsigned long long>(size) - 1) + 1;
+
+		return log2 - 4 < SIZE_CLASS_COUNT ? log2 - 4 : SIZE_CLASS_COUNT - 1;
+	}
+
+	// largest size of size class in bytes. last class has no bound.
+	inline unsigned long long get_size_class_upper_bound(unsigned int size_class)
+	{
+		return 1ull << (size_class + 4);
+	}
+
+	// allocations of one call stack by size class. indexed by StackId.
+	// counts are estimated when sampling is enabled.
+	struct StackSizeClasses
+	{
+		uint64_t live_counts_[SIZE_CLASS_COUNT];
+
+		// allocated since start, freed or not.
+		uint64_t total_counts_[SIZE_CLASS_COUNT];
+	};
+
+	// allocations of all call stacks by size class.
+	struct SizeClassStatistics
+	{
+		uint64_t live_memory_allocations_[SIZE_CLASS_COUNT];
+
+		uint64_t live_counts_[SIZE_CLASS_COUNT];
+
+		uint64_t total_counts_[SIZE_CLASS_COUNT];
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "core_define.h"
+#include "stack_back_trace.h"
+
+namespace memtracer
+{
+	// concurrent, append only table of call stacks.
+	// producer threads intern the captured stack and publish only its StackId.
+	class StackTable final
+	{
+	public:
+		// used when table is full. has no frames.
+		static constexpr StackId OVERFLOW_STACK_ID = 0;
+
+		StackTable();
+
+		~StackTable();
+
+		DELETE_CLASS_COPY_MOVE(StackTable)
+
+		// lock free. each distinct call stack is stored exactly once.
+		StackId intern(const StackBackTrace& stack_back_trace);
+
+		// valid for ids returned by intern.
+		const StackBackTrace& get_stack_back_trace(StackId stack_id) const;
+
+		// upper bound of interned ids.
+		StackId get_stack_count() const;
+
+	private:
+		static constexpr size_t CHUNK_SIZE = 1024;
+
+		static constexpr size_t CHUNK_COUNT = MAX_CALL_STACKS / CHUNK_SIZE;
+
+		// open addressing index. twice of MAX_CALL_STACKS keeps probe sequence short.
+		static constexpr size_t SLOT_COUNT = static_cast<size_t>(MAX_CALL_STACKS) * 2;
+
+		static constexpr size_t SLOT_MASK = SLOT_COUNT - 1;
+
+		// slot is (hash tag << 32 | stack id). 0 is empty slot.
+		static constexpr StackId PENDING_STACK_ID = 0xFFFFFFFFu;
+
+		StackId append(const StackBackTrace& stack_back_trace);
+
+		StackId wait_stack_id(std::atomic<unsigned long long>& slot) const;
+
+		std::atomic<unsigned long long>* slots_;
+
+		// stacks are never moved. chunks are allocated on demand.
+		std::atomic<StackBackTrace*> chunks_[CHUNK_COUNT];
+
+		std::atomic<StackId> next_stack_id_;
+	};
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "core_define.h"
+#include "memory_tracer_allocator.h"
+#include "platform.h"
+
+namespace memtracer
+{
+	// return address to resolved symbol. shared by all stacks and all snapshots,
+	// so each unique frame is resolved once per process lifetime.
+	// not thread safe. only used by the thread which makes snapshots.
+	class SymbolCache final
+	{
+	public:
+		SymbolCache();
+
+		~SymbolCache();
+
+		DELETE_CLASS_COPY_MOVE(SymbolCache)
+
+		// queues frame for next resolve_pending_frames. cached frames are ignored.
+		void add_frame(void* frame);
+
+		// deduplicates queued frames and resolves each of them once.
+		void resolve_pending_frames();
+
+		// symbol which is already known, instead of resolving it. (e.g. event log replay)
+		// nullptr frame_symbol caches frame as frame without symbol.
+		void add_frame_symbol(void* frame, const FrameSymbol* frame_symbol);
+
+		// nullptr when frame has no symbol. frame must be resolved already.
+		const FrameSymbol* find_frame_symbol(void* frame) const;
+
+		size_t get_count() const;
+
+	private:
+		struct CachedFrameSymbol
+		{
+			FrameSymbol frame_symbol_;
+
+			bool is_resolved_;
+		};
+
+		using FrameSymbolMap = std::unordered_map<void*, CachedFrameSymbol, std::hash<void*>, std::equal_to<void*>, MemoryTracerAllocator<std::pair<void* const, CachedFrameSymbol>>>;
+
+		FrameSymbolMap frame_symbols_;
+
+		std::vector<void*, MemoryTracerAllocator<void*>> pending_frames_;
+	};
+}
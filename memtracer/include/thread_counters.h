@@ -0,0 +1,83 @@
+#pragma once
+#include "core_define.h"
+#include "platform.h"
+
+namespace memtracer
+{
+	// traced allocations and sized frees of one producer thread, on its own cache line. only the owner thread writes them.
+	struct alignas(CACHE_LINE_SIZE) ThreadCounters
+	{
+		ThreadCounters();
+
+		~ThreadCounters();
+
+		DELETE_CLASS_COPY_MOVE(ThreadCounters)
+
+		void* operator new(size_t size);
+
+		void operator delete(void* block);
+
+		// owner thread only. plain store instead of read-modify-write.
+		// values wrap, so a count whose record could not be pushed is undone by adding its negation.
+		void add(bool is_free, size_t memory_allocation, size_t memory_allocation_count);
+
+		std::atomic<size_t> memory_allocation_;
+
+		std::atomic<size_t> memory_allocation_count_;
+
+		std::atomic<size_t> freed_memory_allocation_;
+
+		std::atomic<size_t> free_count_;
+
+		// released by an exiting thread and taken by a new thread. values are kept.
+		std::atomic<bool> is_used_;
+
+		// stack of the owner thread. roots of leak scan. 0 when it is unknown.
+		std::atomic<uintptr_t> stack_low_;
+
+		std::atomic<uintptr_t> stack_high_;
+
+		ThreadCounters* next_;
+	};
+
+	// lock free list of ThreadCounters. slots are never freed while the list lives, so readers walk it without locks.
+	class ThreadCounterList final
+	{
+	public:
+		ThreadCounterList();
+
+		~ThreadCounterList();
+
+		DELETE_CLASS_COPY_MOVE(ThreadCounterList)
+
+		// unused slot of an exited thread, or new one. records stack of calling thread in it.
+		ThreadCounters* acquire();
+
+		void release(ThreadCounters* thread_counters);
+
+		// for threads which already released their slot. (thread exit) shared, so updated with atomic add.
+		void add_shared(bool is_free, size_t memory_allocation, size_t memory_allocation_count);
+
+		// sums of all slots.
+		void get_sums(size_t& memory_allocation, size_t& memory_allocation_count, size_t& freed_memory_allocation, size_t& free_count) const;
+
+		// stacks of threads which hold a slot.
+		void get_thread_stacks(MemoryRangeList& thread_stacks) const;
+
+	private:
+		std::atomic<ThreadCounters*> head_;
+
+		ThreadCounters shared_counters_;
+	};
+
+	inline void ThreadCounters::add(bool is_free, size_t memory_allocation, size_t memory_allocation_count)
+	{
+		std::atomic<size_t>& bytes = is_free == true ? freed_memory_allocation_ : memory_allocation_;
+
+		std::atomic<size_t>& count = is_free == true ? free_count_ : memory_allocation_count_;
+
+		bytes.store(bytes.load(std::memory_order_relaxed) + memory_allocation, std::memory_order_relaxed);
+
+		count.store(count.load(std::memory_order_relaxed) + memory_allocation_count, std::memory_order_relaxed);
+	}
+}
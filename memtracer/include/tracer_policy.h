@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdlib>
+
+#include "core_define.h"
+
+namespace memtracer
+{
+	// compile time configuration of MemoryTracer. features which are off are compiled out of allocation paths.
+	// custom allocator is a policy which derives from TracerPolicy and hides allocate / deallocate functions.
+	template <unsigned int StackDepth = 32
+		, unsigned int FramesToSkip = 2
+		, unsigned int CallStackHashBits = 64
+		, bool IsSamplingEnabled = true
+		, bool IsStackCaptureEnabled = true>
+	struct TracerPolicy
+	{
+		// frames kept per call stack. deeper stacks are cut at the outermost side.
+		static constexpr unsigned int STACK_DEPTH = StackDepth;
+
+		// frames of tracer itself. (StackBackTrace::capture and the add_* function)
+		// more when allocations reach MemoryTracer through wrappers of the program.
+		static constexpr unsigned int FRAMES_TO_SKIP = FramesToSkip;
+
+		// 32 bit hashes take less work per frame, but make more stacks share a hash. those are told apart by frames.
+		static constexpr unsigned int CALL_STACK_HASH_BITS = CallStackHashBits;
+
+		// false removes sampler from allocation paths. set_sampling_interval is ignored then.
+		static constexpr bool IS_SAMPLING_ENABLED = IsSamplingEnabled;
+
+		// false records all allocations under StackTable::OVERFLOW_STACK_ID. totals, sizes and lifetimes only.
+		static constexpr bool IS_STACK_CAPTURE_ENABLED = IsStackCaptureEnabled;
+
+		static_assert(StackDepth >= 1 && StackDepth <= MAX_STACK_FRAMES, "StackDepth must be in [1, MAX_STACK_FRAMES].");
+
+		static_assert(CallStackHashBits == 32 || CallStackHashBits == 64, "CallStackHashBits must be 32 or 64.");
+
+		static void* allocate(size_t size)
+		{
+			return std::malloc(size);
+		}
+
+		static void* allocate_array(size_t size)
+		{
+			return std::malloc(size);
+		}
+
+		static void deallocate(void* block)
+		{
+			std::free(block);
+		}
+
+		static void deallocate_array(void* block)
+		{
+			std::free(block);
+		}
+
+		// block is from allocate or reallocate.
+		static void* reallocate(void* block, size_t size)
+		{
+			return std::realloc(block, size);
+		}
+	};
+}
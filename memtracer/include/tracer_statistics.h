@@ -0,0 +1,26 @@
+#pragma once
+#include "core_define.h"
+#include "buffer_policy.h"
+#include "memory_tracer_allocation.h"
+
+namespace memtracer
+{
+	// state of tracer threads. read by any thread while tracing, values are updated once per drain pass.
+	struct TracerStatistics
+	{
+		// records applied since start by all tracer threads.
+		size_t applied_operation_count_;
+
+		// publish time of the latest applied record of all shards. get_timestamp() - this is the lag of tracer threads.
+		Timestamp applied_timestamp_;
+
+		BufferStatistics buffer_statistics_;
+
+		// samples which were picked but not traced, because sampled address set had no slot for their address.
+		// live bytes and counts are low by their estimates.
+		size_t overflowed_sample_count_;
+
+		// memory of the tracer itself. all tracers of the process share one arena.
+		ArenaStatistics arena_statistics_;
+	};
+}
@@ -0,0 +1,253 @@
+#include "allocation_sampler.h"
+
+#include <cmath>
+#include <new>
+
+#include "memory_tracer_allocation.h"
+
+namespace memtracer
+{
+	thread_local long long AllocationSampler::bytes_until_sample_ = 0;
+
+	thread_local bool AllocationSampler::is_thread_initialized_ = false;
+
+	thread_local unsigned long long AllocationSampler::random_state_ = 0;
+
+	AllocationSampler::AllocationSampler() :
+		sampling_interval_(0)
+		, sampled_address_levels_()
+		, level_mutex_()
+	{
+		sampled_address_levels_[0].store(create_level(FIRST_LEVEL_BUCKET_COUNT), std::memory_order_relaxed);
+
+		for (size_t level = 1; level < MAX_LEVEL_COUNT; level++)
+		{
+			sampled_address_levels_[level].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	AllocationSampler::~AllocationSampler()
+	{
+		for (std::atomic<SampledAddressLevel*>& sampled_address_level : sampled_address_levels_)
+		{
+			SampledAddressLevel* sampled_level = sampled_address_level.load(std::memory_order_relaxed);
+
+			if (sampled_level != nullptr)
+			{
+				memtracer_free(sampled_level->addresses_);
+
+				memtracer_free(sampled_level->is_spilled_);
+
+				memtracer_free(sampled_level);
+			}
+		}
+	}
+
+	void AllocationSampler::set_sampling_interval(size_t sampling_interval)
+	{
+		sampling_interval_ = sampling_interval;
+	}
+
+	size_t AllocationSampler::get_sampling_interval() const
+	{
+		return sampling_interval_;
+	}
+
+	bool AllocationSampler::is_enabled() const
+	{
+		return sampling_interval_ != 0;
+	}
+
+	size_t AllocationSampler::get_estimated_size(size_t size) const
+	{
+		const double probability = 1.0 - std::exp(-static_cast<double>(size) / static_cast<double>(sampling_interval_));
+
+		return static_cast<size_t>(std::ldexp(static_cast<double>(size) / probability, ESTIMATE_FRACTION_BITS) + 0.5);
+	}
+
+	size_t AllocationSampler::get_estimated_count(size_t size) const
+	{
+		const double probability = 1.0 - std::exp(-static_cast<double>(size) / static_cast<double>(sampling_interval_));
+
+		return static_cast<size_t>(std::ldexp(1.0 / probability, ESTIMATE_FRACTION_BITS) + 0.5);
+	}
+
+	bool AllocationSampler::mark_sampled(void* address)
+	{
+		for (size_t level = 0; level < MAX_LEVEL_COUNT; level++)
+		{
+			SampledAddressLevel* sampled_level = get_or_create_level(level);
+
+			if (sampled_level == nullptr)
+			{
+				return false;
+			}
+
+			const size_t bucket_index = get_bucket_index(*sampled_level, address);
+
+			std::atomic<void*>* bucket = &sampled_level->addresses_[bucket_index * BUCKET_SIZE];
+
+			for (size_t i = 0; i < BUCKET_SIZE; i++)
+			{
+				void* empty = nullptr;
+
+				if (bucket[i].compare_exchange_strong(empty, address, std::memory_order_relaxed) == true)
+				{
+					return true;
+				}
+			}
+
+			if (sampled_level->is_spilled_[bucket_index].load(std::memory_order_relaxed) == false)
+			{
+				sampled_level->is_spilled_[bucket_index].store(true, std::memory_order_relaxed);
+			}
+		}
+
+		return false;
+	}
+
+	bool AllocationSampler::unmark_sampled(void* address)
+	{
+		// marked before the address is returned to user, so free always sees it.
+		for (size_t level = 0; level < MAX_LEVEL_COUNT; level++)
+		{
+			SampledAddressLevel* sampled_level = sampled_address_levels_[level].load(std::memory_order_acquire);
+
+			if (sampled_level == nullptr)
+			{
+				return false;
+			}
+
+			const size_t bucket_index = get_bucket_index(*sampled_level, address);
+
+			std::atomic<void*>* bucket = &sampled_level->addresses_[bucket_index * BUCKET_SIZE];
+
+			for (size_t i = 0; i < BUCKET_SIZE; i++)
+			{
+				void* expected = address;
+
+				if (bucket[i].load(std::memory_order_relaxed) == address &&
+					bucket[i].compare_exchange_strong(expected, nullptr, std::memory_order_relaxed) == true)
+				{
+					return true;
+				}
+			}
+
+			// most frees are of addresses which were never sampled. they stop at first level.
+			if (sampled_level->is_spilled_[bucket_index].load(std::memory_order_relaxed) == false)
+			{
+				return false;
+			}
+		}
+
+		return false;
+	}
+
+	bool AllocationSampler::pick_next_sample(size_t size)
+	{
+		// first allocation of thread only starts the interval. otherwise it is always sampled.
+		if (is_thread_initialized_ == false)
+		{
+			random_state_ = reinterpret_cast<uintptr_t>(&random_state_) ^ get_timestamp() ^ 0x9E3779B97F4A7C15ull;
+
+			is_thread_initialized_ = true;
+
+			bytes_until_sample_ = get_next_interval() - static_cast<long long>(size);
+
+			if (bytes_until_sample_ >= 0)
+			{
+				return false;
+			}
+		}
+
+		bytes_until_sample_ = get_next_interval();
+
+		return true;
+	}
+
+	long long AllocationSampler::get_next_interval()
+	{
+		// xorshift64*
+		random_state_ ^= random_state_ >> 12;
+
+		random_state_ ^= random_state_ << 25;
+
+		random_state_ ^= random_state_ >> 27;
+
+		const unsigned long long random = random_state_ * 0x2545F4914F6CDD1Dull;
+
+		// uniform in (0, 1].
+		const double uniform = (static_cast<double>(random >> 11) + 1.0) / 9007199254740992.0;
+
+		return static_cast<long long>(-std::log(uniform) * static_cast<double>(sampling_interval_)) + 1;
+	}
+
+	AllocationSampler::SampledAddressLevel* AllocationSampler::get_or_create_level(size_t level)
+	{
+		SampledAddressLevel* sampled_level = sampled_address_levels_[level].load(std::memory_order_acquire);
+
+		if (sampled_level != nullptr)
+		{
+			return sampled_level;
+		}
+
+		std::lock_guard<std::mutex> lock(level_mutex_);
+
+		sampled_level = sampled_address_levels_[level].load(std::memory_order_relaxed);
+
+		if (sampled_level == nullptr)
+		{
+			sampled_level = create_level(FIRST_LEVEL_BUCKET_COUNT << level);
+
+			sampled_address_levels_[level].store(sampled_level, std::memory_order_release);
+		}
+
+		return sampled_level;
+	}
+
+	AllocationSampler::SampledAddressLevel* AllocationSampler::create_level(size_t bucket_count)
+	{
+		SampledAddressLevel* sampled_level = static_cast<SampledAddressLevel*>(memtracer_alloc(sizeof(SampledAddressLevel)));
+
+		std::atomic<void*>* addresses = static_cast<std::atomic<void*>*>(memtracer_alloc(sizeof(std::atomic<void*>) * BUCKET_SIZE * bucket_count));
+
+		std::atomic<bool>* is_spilled = static_cast<std::atomic<bool>*>(memtracer_alloc(sizeof(std::atomic<bool>) * bucket_count));
+
+		if (sampled_level == nullptr || addresses == nullptr || is_spilled == nullptr)
+		{
+			memtracer_free(sampled_level);
+
+			memtracer_free(addresses);
+
+			memtracer_free(is_spilled);
+
+			return nullptr;
+		}
+
+		for (size_t i = 0; i < BUCKET_SIZE * bucket_count; i++)
+		{
+			new (&addresses[i]) std::atomic<void*>(nullptr);
+		}
+
+		for (size_t i = 0; i < bucket_count; i++)
+		{
+			new (&is_spilled[i]) std::atomic<bool>(false);
+		}
+
+		sampled_level->bucket_count_ = bucket_count;
+
+		sampled_level->addresses_ = addresses;
+
+		sampled_level->is_spilled_ = is_spilled;
+
+		return sampled_level;
+	}
+
+	size_t AllocationSampler::get_bucket_index(const SampledAddressLevel& sampled_level, void* address)
+	{
+		const unsigned long long hash = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(address)) * 0x9E3779B97F4A7C15ull;
+
+		// upper half of hash. a level with more buckets takes more of its bits.
+		return static_cast<size_t>(hash >> 32) & (sampled_level.bucket_count_ - 1);
+	}
+}
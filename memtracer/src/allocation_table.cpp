@@ -0,0 +1,156 @@
+#include "allocation_table.h"
+
+#include "memory_tracer_allocation.h"
+
+namespace memtracer
+{
+	AllocationTable::AllocationTable() :
+		entries_(static_cast<Allocation*>(memtracer_alloc(sizeof(Allocation) * INITIAL_CAPACITY)))
+		, capacity_(INITIAL_CAPACITY)
+		, count_(0)
+	{
+		std::memset(entries_, 0, sizeof(Allocation) * capacity_);
+	}
+
+	AllocationTable::~AllocationTable()
+	{
+		memtracer_free(entries_);
+	}
+
+	Allocation* AllocationTable::emplace(void* address, bool& is_inserted)
+	{
+		// keep load factor under 0.7.
+		if ((count_ + 1) * 10 > capacity_ * 7)
+		{
+			grow();
+		}
+
+		const size_t mask = capacity_ - 1;
+
+		for (size_t index = get_home_index(address); ; index = (index + 1) & mask)
+		{
+			Allocation& entry = entries_[index];
+
+			if (entry.address_ == address)
+			{
+				is_inserted = false;
+
+				return &entry;
+			}
+
+			if (entry.address_ == nullptr)
+			{
+				entry.address_ = address;
+
+				count_++;
+
+				is_inserted = true;
+
+				return &entry;
+			}
+		}
+	}
+
+	const Allocation* AllocationTable::find(void* address) const
+	{
+		const size_t mask = capacity_ - 1;
+
+		for (size_t index = get_home_index(address); entries_[index].address_ != nullptr; index = (index + 1) & mask)
+		{
+			if (entries_[index].address_ == address)
+			{
+				return &entries_[index];
+			}
+		}
+
+		return nullptr;
+	}
+
+	bool AllocationTable::erase(void* address, Allocation& allocation)
+	{
+		const size_t mask = capacity_ - 1;
+
+		size_t index = get_home_index(address);
+
+		while (entries_[index].address_ != address)
+		{
+			if (entries_[index].address_ == nullptr)
+			{
+				return false;
+			}
+
+			index = (index + 1) & mask;
+		}
+
+		allocation = entries_[index];
+
+		count_--;
+
+		// shift following entries of the cluster back into the hole.
+		size_t hole = index;
+
+		for (size_t next = (hole + 1) & mask; entries_[next].address_ != nullptr; next = (next + 1) & mask)
+		{
+			const size_t home = get_home_index(entries_[next].address_);
+
+			// entry can move to hole only if hole is between its home and its position.
+			if (((next - home) & mask) >= ((next - hole) & mask))
+			{
+				entries_[hole] = entries_[next];
+
+				hole = next;
+			}
+		}
+
+		entries_[hole].address_ = nullptr;
+
+		return true;
+	}
+
+	size_t AllocationTable::get_count() const
+	{
+		return count_;
+	}
+
+	size_t AllocationTable::get_home_index(void* address) const
+	{
+		// fibonacci hashing. low bits of address are zero by alignment.
+		const unsigned long long hash = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(address)) * 0x9E3779B97F4A7C15ull;
+
+		return static_cast<size_t>(hash >> 32) & (capacity_ - 1);
+	}
+
+	void AllocationTable::grow()
+	{
+		Allocation* old_entries = entries_;
+
+		const size_t old_capacity = capacity_;
+
+		capacity_ *= 2;
+
+		entries_ = static_cast<Allocation*>(memtracer_alloc(sizeof(Allocation) * capacity_));
+
+		std::memset(entries_, 0, sizeof(Allocation) * capacity_);
+
+		const size_t mask = capacity_ - 1;
+
+		for (size_t i = 0; i < old_capacity; i++)
+		{
+			if (old_entries[i].address_ == nullptr)
+			{
+				continue;
+			}
+
+			size_t index = get_home_index(old_entries[i].address_);
+
+			while (entries_[index].address_ != nullptr)
+			{
+				index = (index + 1) & mask;
+			}
+
+			entries_[index] = old_entries[i];
+		}
+
+		memtracer_free(old_entries);
+	}
+}
@@ -0,0 +1,339 @@
+#include "arena.h"
+
+#include <new>
+
+namespace memtracer
+{
+	thread_local Arena::ThreadCache Arena::thread_cache_;
+
+	thread_local bool Arena::is_thread_cache_destroyed_ = false;
+
+	constexpr size_t Arena::SIZE_CLASS_SIZES[SIZE_CLASS_COUNT];
+
+	void Arena::CentralList::lock()
+	{
+		while (is_locked_.exchange(true, std::memory_order_acquire) == true)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void Arena::CentralList::unlock()
+	{
+		is_locked_.store(false, std::memory_order_release);
+	}
+
+	Arena::ThreadCache::ThreadCache() :
+		heads_()
+		, counts_()
+	{
+	}
+
+	Arena::ThreadCache::~ThreadCache()
+	{
+		Arena& arena = Arena::get_instance();
+
+		for (size_t size_class = 0; size_class < SIZE_CLASS_COUNT; size_class++)
+		{
+			arena.flush(size_class, heads_[size_class], counts_[size_class]);
+
+			counts_[size_class] = 0;
+		}
+
+		is_thread_cache_destroyed_ = true;
+	}
+
+	Arena& Arena::get_instance()
+	{
+		// placement into static storage. destructor never runs, so late frees at process exit stay valid.
+		alignas(Arena) static unsigned char storage[sizeof(Arena)];
+
+		static Arena* instance = new (storage) Arena();
+
+		return *instance;
+	}
+
+	Arena::Arena() :
+		central_lists_()
+		, used_memory_(0)
+		, mapped_memory_(0)
+	{
+		for (CentralList& central_list : central_lists_)
+		{
+			central_list.is_locked_.store(false, std::memory_order_relaxed);
+
+			central_list.head_ = nullptr;
+		}
+	}
+
+	Arena::~Arena()
+	{
+	}
+
+	void* Arena::allocate(size_t size)
+	{
+		const size_t size_class = get_size_class(size);
+
+		if (size_class == LARGE_SIZE_CLASS)
+		{
+			return allocate_large(size);
+		}
+
+		used_memory_.fetch_add(SIZE_CLASS_SIZES[size_class], std::memory_order_relaxed);
+
+		// thread is exiting. central list only.
+		if (is_thread_cache_destroyed_ == true)
+		{
+			FreeBlock* head = nullptr;
+
+			if (refill(size_class, head, 1) == 0)
+			{
+				used_memory_.fetch_sub(SIZE_CLASS_SIZES[size_class], std::memory_order_relaxed);
+
+				return nullptr;
+			}
+
+			return head;
+		}
+
+		FreeBlock*& head = thread_cache_.heads_[size_class];
+
+		size_t& count = thread_cache_.counts_[size_class];
+
+		if (head == nullptr)
+		{
+			count = refill(size_class, head, get_cache_limit(size_class) / 2);
+
+			if (count == 0)
+			{
+				used_memory_.fetch_sub(SIZE_CLASS_SIZES[size_class], std::memory_order_relaxed);
+
+				return nullptr;
+			}
+		}
+
+		FreeBlock* block = head;
+
+		head = block->next_;
+
+		count--;
+
+		return block;
+	}
+
+	void Arena::deallocate(void* block)
+	{
+		if (block == nullptr)
+		{
+			return;
+		}
+
+		Header& header = get_header(block);
+
+		if (header.size_class_ == LARGE_SIZE_CLASS)
+		{
+			const size_t mapped_size = header.mapped_size_;
+
+			used_memory_.fetch_sub(mapped_size, std::memory_order_relaxed);
+
+			mapped_memory_.fetch_sub(mapped_size, std::memory_order_relaxed);
+
+			free_pages(&header, mapped_size);
+
+			return;
+		}
+
+		const size_t size_class = header.size_class_;
+
+		used_memory_.fetch_sub(SIZE_CLASS_SIZES[size_class], std::memory_order_relaxed);
+
+		FreeBlock* free_block = static_cast<FreeBlock*>(block);
+
+		if (is_thread_cache_destroyed_ == true)
+		{
+			free_block->next_ = nullptr;
+
+			flush(size_class, free_block, 1);
+
+			return;
+		}
+
+		FreeBlock*& head = thread_cache_.heads_[size_class];
+
+		size_t& count = thread_cache_.counts_[size_class];
+
+		free_block->next_ = head;
+
+		head = free_block;
+
+		count++;
+
+		// blocks freed by other thread than their allocator pile up here. half of them go back.
+		if (count > get_cache_limit(size_class))
+		{
+			const size_t flush_count = count / 2;
+
+			flush(size_class, head, flush_count);
+
+			count -= flush_count;
+		}
+	}
+
+	ArenaStatistics Arena::get_statistics() const
+	{
+		ArenaStatistics arena_statistics;
+
+		arena_statistics.used_memory_ = used_memory_.load(std::memory_order_relaxed);
+
+		arena_statistics.mapped_memory_ = mapped_memory_.load(std::memory_order_relaxed);
+
+		return arena_statistics;
+	}
+
+	size_t Arena::get_size_class(size_t size)
+	{
+		if (size <= 128)
+		{
+			return size == 0 ? 0 : (size - 1) / 16;
+		}
+
+		for (size_t size_class = 8; size_class < SIZE_CLASS_COUNT; size_class++)
+		{
+			if (size <= SIZE_CLASS_SIZES[size_class])
+			{
+				return size_class;
+			}
+		}
+
+		return LARGE_SIZE_CLASS;
+	}
+
+	size_t Arena::get_cache_limit(size_t size_class)
+	{
+		return (std::max)(THREAD_CACHE_BYTES / SIZE_CLASS_SIZES[size_class], static_cast<size_t>(4));
+	}
+
+	Arena::Header& Arena::get_header(void* block)
+	{
+		return *reinterpret_cast<Header*>(reinterpret_cast<uintptr_t>(block) & ~(static_cast<uintptr_t>(SLAB_SIZE) - 1));
+	}
+
+	size_t Arena::refill(size_t size_class, FreeBlock*& head, size_t count)
+	{
+		CentralList& central_list = central_lists_[size_class];
+
+		central_list.lock();
+
+		if (central_list.head_ == nullptr)
+		{
+			void* slab = allocate_pages(SLAB_SIZE);
+
+			if (slab == nullptr)
+			{
+				central_list.unlock();
+
+				return 0;
+			}
+
+			mapped_memory_.fetch_add(SLAB_SIZE, std::memory_order_relaxed);
+
+			Header* header = static_cast<Header*>(slab);
+
+			header->size_class_ = size_class;
+
+			header->mapped_size_ = SLAB_SIZE;
+
+			const size_t block_size = SIZE_CLASS_SIZES[size_class];
+
+			// pushed from the end, so blocks are handed out in address order.
+			for (size_t offset = HEADER_SIZE + (SLAB_SIZE - HEADER_SIZE) / block_size * block_size; offset > HEADER_SIZE; )
+			{
+				offset -= block_size;
+
+				FreeBlock* free_block = reinterpret_cast<FreeBlock*>(static_cast<char*>(slab) + offset);
+
+				free_block->next_ = central_list.head_;
+
+				central_list.head_ = free_block;
+			}
+		}
+
+		size_t moved_count = 0;
+
+		while (moved_count < count && central_list.head_ != nullptr)
+		{
+			FreeBlock* free_block = central_list.head_;
+
+			central_list.head_ = free_block->next_;
+
+			free_block->next_ = head;
+
+			head = free_block;
+
+			moved_count++;
+		}
+
+		central_list.unlock();
+
+		return moved_count;
+	}
+
+	void Arena::flush(size_t size_class, FreeBlock*& head, size_t count)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+
+		// detach count blocks first. lock is held only for splicing.
+		FreeBlock* first = head;
+
+		FreeBlock* last = head;
+
+		for (size_t i = 1; i < count; i++)
+		{
+			last = last->next_;
+		}
+
+		head = last->next_;
+
+		CentralList& central_list = central_lists_[size_class];
+
+		central_list.lock();
+
+		last->next_ = central_list.head_;
+
+		central_list.head_ = first;
+
+		central_list.unlock();
+	}
+
+	void* Arena::allocate_large(size_t size)
+	{
+		if (size > SIZE_MAX - HEADER_SIZE - OS_PAGE_SIZE)
+		{
+			return nullptr;
+		}
+
+		const size_t mapped_size = (size + HEADER_SIZE + OS_PAGE_SIZE - 1) & ~(OS_PAGE_SIZE - 1);
+
+		void* pages = allocate_pages(mapped_size);
+
+		if (pages == nullptr)
+		{
+			return nullptr;
+		}
+
+		used_memory_.fetch_add(mapped_size, std::memory_order_relaxed);
+
+		mapped_memory_.fetch_add(mapped_size, std::memory_order_relaxed);
+
+		Header* header = static_cast<Header*>(pages);
+
+		header->size_class_ = LARGE_SIZE_CLASS;
+
+		header->mapped_size_ = mapped_size;
+
+		return static_cast<char*>(pages) + HEADER_SIZE;
+	}
+}
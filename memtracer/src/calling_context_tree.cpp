@@ -0,0 +1,372 @@
+#include "calling_context_tree.h"
+
+namespace memtracer
+{
+	namespace
+	{
+		struct CallEdge
+		{
+			uint32_t function_;
+
+			uint64_t memory_allocation_;
+
+			uint64_t memory_allocation_count_;
+		};
+
+		void append_size(std::string& line, uint64_t memory_allocation, uint64_t memory_allocation_count)
+		{
+			char buffer[64] = { 0 };
+
+			const int length = std::snprintf(buffer, sizeof(buffer), "%.2f MB / %llu times"
+				, static_cast<double>(memory_allocation) / 1024.0 / 1024.0, static_cast<unsigned long long>(memory_allocation_count));
+
+			line.append(buffer, static_cast<size_t>((std::max)(length, 0)));
+		}
+	}
+
+	CallingContextTree::CallingContextTree() :
+		snapshot_file_(nullptr)
+		, nodes_()
+		, functions_()
+		, children_()
+	{
+	}
+
+	CallingContextTree::~CallingContextTree()
+	{
+	}
+
+	void CallingContextTree::build(const SnapshotFile& snapshot_file)
+	{
+		snapshot_file_ = &snapshot_file;
+
+		nodes_.clear();
+
+		functions_.clear();
+
+		children_.clear();
+
+		nodes_.push_back({ NO_NODE, NO_NODE, NO_NODE, NO_NODE, 0, 0, 0, 0 });
+
+		const SnapshotFileHeader& header = snapshot_file.get_header();
+
+		// return addresses of one function are folded into one node.
+		std::vector<uint32_t> frame_functions(static_cast<size_t>(header.frame_count_));
+
+		std::unordered_map<uint64_t, uint32_t> function_indices;
+
+		for (size_t i = 0; i < frame_functions.size(); i++)
+		{
+			const SnapshotFileFrame& frame = snapshot_file.get_frame(i);
+
+			const bool has_symbol = (frame.flags_ & SNAPSHOT_FILE_FRAME_HAS_SYMBOL) != 0;
+
+			const uint64_t address = has_symbol == true ? frame.symbol_address_ : frame.address_;
+
+			auto pair = function_indices.emplace(address, static_cast<uint32_t>(functions_.size()));
+
+			if (pair.second == true)
+			{
+				functions_.push_back({ address, has_symbol == true ? frame.symbol_name_ : SNAPSHOT_FILE_NO_STRING });
+			}
+
+			frame_functions[i] = pair.first->second;
+		}
+
+		for (uint64_t stack_index = 0; stack_index < header.stack_count_; stack_index++)
+		{
+			const SnapshotFileStack& stack = snapshot_file.get_stack(static_cast<size_t>(stack_index));
+
+			uint32_t node = ROOT_NODE;
+
+			nodes_[node].inclusive_memory_allocation_ += stack.memory_allocation_;
+
+			nodes_[node].inclusive_memory_allocation_count_ += stack.memory_allocation_count_;
+
+			// frames are innermost first. tree starts from outermost.
+			for (size_t i = stack.frame_count_; i > 0; i--)
+			{
+				node = get_child(node, frame_functions[snapshot_file.get_stack_frame_index(stack, i - 1)]);
+
+				nodes_[node].inclusive_memory_allocation_ += stack.memory_allocation_;
+
+				nodes_[node].inclusive_memory_allocation_count_ += stack.memory_allocation_count_;
+			}
+
+			nodes_[node].exclusive_memory_allocation_ += stack.memory_allocation_;
+
+			nodes_[node].exclusive_memory_allocation_count_ += stack.memory_allocation_count_;
+		}
+	}
+
+	size_t CallingContextTree::get_node_count() const
+	{
+		return nodes_.size();
+	}
+
+	const CallingContextTree::Node& CallingContextTree::get_node(uint32_t index) const
+	{
+		assert(index < nodes_.size());
+
+		return nodes_[index];
+	}
+
+	size_t CallingContextTree::get_function_count() const
+	{
+		return functions_.size();
+	}
+
+	const CallingContextTree::Function& CallingContextTree::get_function(uint32_t index) const
+	{
+		assert(index < functions_.size());
+
+		return functions_[index];
+	}
+
+	std::string CallingContextTree::get_function_name(uint32_t index) const
+	{
+		const Function& function = get_function(index);
+
+		if (function.name_ != SNAPSHOT_FILE_NO_STRING)
+		{
+			return snapshot_file_->get_string(function.name_);
+		}
+
+		char buffer[32] = { 0 };
+
+		std::snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(function.address_));
+
+		return buffer;
+	}
+
+	void CallingContextTree::write_folded(FileWriter& file_writer) const
+	{
+		std::vector<std::string> function_names(functions_.size());
+
+		for (uint32_t i = 0; i < functions_.size(); i++)
+		{
+			function_names[i] = get_function_name(i);
+		}
+
+		const auto write_line = [&file_writer](const std::string& path, uint64_t memory_allocation)
+			{
+				char buffer[32] = { 0 };
+
+				const int length = std::snprintf(buffer, sizeof(buffer), " %llu\n", static_cast<unsigned long long>(memory_allocation));
+
+				file_writer.write(path.data(), path.size());
+
+				file_writer.write(buffer, static_cast<size_t>((std::max)(length, 0)));
+			};
+
+		if (nodes_.empty() == false && nodes_[ROOT_NODE].exclusive_memory_allocation_ != 0)
+		{
+			write_line("[no call stack]", nodes_[ROOT_NODE].exclusive_memory_allocation_);
+		}
+
+		// node and length of its parent's path.
+		std::vector<std::pair<uint32_t, size_t>> pending_nodes;
+
+		std::string path;
+
+		for (uint32_t child = nodes_.empty() == true ? NO_NODE : nodes_[ROOT_NODE].first_child_; child != NO_NODE; child = nodes_[child].next_sibling_)
+		{
+			pending_nodes.emplace_back(child, 0);
+		}
+
+		while (pending_nodes.empty() == false)
+		{
+			const uint32_t node_index = pending_nodes.back().first;
+
+			path.resize(pending_nodes.back().second);
+
+			pending_nodes.pop_back();
+
+			const Node& node = nodes_[node_index];
+
+			if (path.empty() == false)
+			{
+				path += ';';
+			}
+
+			path += function_names[node.function_];
+
+			if (node.exclusive_memory_allocation_ != 0)
+			{
+				write_line(path, node.exclusive_memory_allocation_);
+			}
+
+			for (uint32_t child = node.first_child_; child != NO_NODE; child = nodes_[child].next_sibling_)
+			{
+				pending_nodes.emplace_back(child, path.size());
+			}
+		}
+	}
+
+	void CallingContextTree::write_call_graph(FileWriter& file_writer) const
+	{
+		std::vector<uint64_t> inclusive_memory_allocations(functions_.size(), 0);
+
+		std::vector<uint64_t> inclusive_memory_allocation_counts(functions_.size(), 0);
+
+		std::vector<uint64_t> exclusive_memory_allocations(functions_.size(), 0);
+
+		std::vector<uint64_t> exclusive_memory_allocation_counts(functions_.size(), 0);
+
+		// calling contexts of each function on current path. only outermost one adds inclusive bytes.
+		std::vector<uint32_t> active_counts(functions_.size(), 0);
+
+		// (caller << 32 | callee) to bytes and count of calls.
+		std::unordered_map<uint64_t, std::pair<uint64_t, uint64_t>> call_edges;
+
+		// node and whether it is left. children are visited between enter and leave.
+		std::vector<std::pair<uint32_t, bool>> pending_nodes;
+
+		for (uint32_t child = nodes_.empty() == true ? NO_NODE : nodes_[ROOT_NODE].first_child_; child != NO_NODE; child = nodes_[child].next_sibling_)
+		{
+			pending_nodes.emplace_back(child, false);
+		}
+
+		while (pending_nodes.empty() == false)
+		{
+			const uint32_t node_index = pending_nodes.back().first;
+
+			const bool is_leaving = pending_nodes.back().second;
+
+			pending_nodes.pop_back();
+
+			const Node& node = nodes_[node_index];
+
+			if (is_leaving == true)
+			{
+				active_counts[node.function_]--;
+
+				continue;
+			}
+
+			if (active_counts[node.function_]++ == 0)
+			{
+				inclusive_memory_allocations[node.function_] += node.inclusive_memory_allocation_;
+
+				inclusive_memory_allocation_counts[node.function_] += node.inclusive_memory_allocation_count_;
+			}
+
+			exclusive_memory_allocations[node.function_] += node.exclusive_memory_allocation_;
+
+			exclusive_memory_allocation_counts[node.function_] += node.exclusive_memory_allocation_count_;
+
+			if (node.parent_ != ROOT_NODE)
+			{
+				std::pair<uint64_t, uint64_t>& call_edge = call_edges[(static_cast<uint64_t>(nodes_[node.parent_].function_) << 32) | node.function_];
+
+				call_edge.first += node.inclusive_memory_allocation_;
+
+				call_edge.second += node.inclusive_memory_allocation_count_;
+			}
+
+			pending_nodes.emplace_back(node_index, true);
+
+			for (uint32_t child = node.first_child_; child != NO_NODE; child = nodes_[child].next_sibling_)
+			{
+				pending_nodes.emplace_back(child, false);
+			}
+		}
+
+		std::vector<std::vector<CallEdge>> callers(functions_.size());
+
+		std::vector<std::vector<CallEdge>> callees(functions_.size());
+
+		for (const auto& pair : call_edges)
+		{
+			const uint32_t caller = static_cast<uint32_t>(pair.first >> 32);
+
+			const uint32_t callee = static_cast<uint32_t>(pair.first);
+
+			callers[callee].push_back({ caller, pair.second.first, pair.second.second });
+
+			callees[caller].push_back({ callee, pair.second.first, pair.second.second });
+		}
+
+		const auto more_memory = [](const CallEdge& first, const CallEdge& second)
+			{
+				return first.memory_allocation_ != second.memory_allocation_ ? first.memory_allocation_ > second.memory_allocation_ : first.function_ < second.function_;
+			};
+
+		std::vector<uint32_t> functions(functions_.size());
+
+		for (uint32_t i = 0; i < functions.size(); i++)
+		{
+			functions[i] = i;
+		}
+
+		std::stable_sort(functions.begin(), functions.end(), [&inclusive_memory_allocations](uint32_t first, uint32_t second)
+			{
+				return inclusive_memory_allocations[first] > inclusive_memory_allocations[second];
+			});
+
+		std::string line;
+
+		for (uint32_t function : functions)
+		{
+			line = "------- ";
+
+			line += get_function_name(function);
+
+			line += " : ";
+
+			append_size(line, inclusive_memory_allocations[function], inclusive_memory_allocation_counts[function]);
+
+			line += " (self ";
+
+			append_size(line, exclusive_memory_allocations[function], exclusive_memory_allocation_counts[function]);
+
+			line += ") -------\r\n";
+
+			std::sort(callers[function].begin(), callers[function].end(), more_memory);
+
+			std::sort(callees[function].begin(), callees[function].end(), more_memory);
+
+			for (const CallEdge& call_edge : callers[function])
+			{
+				line += "  called by ";
+
+				line += get_function_name(call_edge.function_);
+
+				line += " : ";
+
+				append_size(line, call_edge.memory_allocation_, call_edge.memory_allocation_count_);
+
+				line += "\r\n";
+			}
+
+			for (const CallEdge& call_edge : callees[function])
+			{
+				line += "  calls ";
+
+				line += get_function_name(call_edge.function_);
+
+				line += " : ";
+
+				append_size(line, call_edge.memory_allocation_, call_edge.memory_allocation_count_);
+
+				line += "\r\n";
+			}
+
+			file_writer.write(line.data(), line.size());
+		}
+	}
+
+	uint32_t CallingContextTree::get_child(uint32_t parent, uint32_t function)
+	{
+		auto pair = children_.emplace((static_cast<uint64_t>(parent) << 32) | function, static_cast<uint32_t>(nodes_.size()));
+
+		if (pair.second == true)
+		{
+			nodes_.push_back({ function, parent, NO_NODE, nodes_[parent].first_child_, 0, 0, 0, 0 });
+
+			nodes_[parent].first_child_ = pair.first->second;
+		}
+
+		return pair.first->second;
+	}
+}
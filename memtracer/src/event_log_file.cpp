@@ -0,0 +1,1050 @@
+#include "event_log_file.h"
+
+#include <queue>
+
+#include "memory_tracer_allocation.h"
+#include "snapshot_format.h"
+
+namespace memtracer
+{
+	namespace
+	{
+		template <typename Buffer>
+		void append_varint(Buffer& buffer, uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				buffer.push_back(static_cast<uint8_t>(value | 0x80));
+
+				value >>= 7;
+			}
+
+			buffer.push_back(static_cast<uint8_t>(value));
+		}
+
+		template <typename Buffer>
+		void append_string(Buffer& buffer, const std::string& text)
+		{
+			buffer.insert(buffer.end(), text.begin(), text.end());
+
+			buffer.push_back(0);
+		}
+
+		// small negative and positive deltas both take few bytes.
+		uint64_t encode_zigzag(int64_t value)
+		{
+			return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+		}
+
+		int64_t decode_zigzag(uint64_t value)
+		{
+			return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+		}
+
+		// false at end of payload or for varint longer than 64 bits.
+		bool read_varint(const uint8_t*& cursor, const uint8_t* end, uint64_t& value)
+		{
+			value = 0;
+
+			for (unsigned int shift = 0; shift < 64; shift += 7)
+			{
+				if (cursor == end)
+				{
+					return false;
+				}
+
+				const uint8_t byte = *cursor++;
+
+				value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+				if ((byte & 0x80) == 0)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool read_string(const uint8_t*& cursor, const uint8_t* end, std::string& text)
+		{
+			const void* terminator = std::memchr(cursor, 0, static_cast<size_t>(end - cursor));
+
+			if (terminator == nullptr)
+			{
+				return false;
+			}
+
+			text.assign(reinterpret_cast<const char*>(cursor), static_cast<const char*>(terminator));
+
+			cursor = static_cast<const uint8_t*>(terminator) + 1;
+
+			return true;
+		}
+
+		// decodes events of one block. deltas are relative to previous event of the block.
+		struct EventBlockReader
+		{
+			const uint8_t* cursor_;
+
+			const uint8_t* end_;
+
+			uint32_t remaining_count_;
+
+			uint32_t shard_index_;
+
+			uint64_t timestamp_;
+
+			uint64_t address_;
+
+			void reset(const char* data, size_t offset)
+			{
+				EventLogBlockHeader block_header;
+
+				std::memcpy(&block_header, data + offset, sizeof(EventLogBlockHeader));
+
+				cursor_ = reinterpret_cast<const uint8_t*>(data + offset + sizeof(EventLogBlockHeader));
+
+				end_ = cursor_ + block_header.payload_size_;
+
+				remaining_count_ = block_header.record_count_;
+
+				shard_index_ = block_header.shard_index_;
+
+				timestamp_ = block_header.first_timestamp_;
+
+				address_ = 0;
+			}
+
+			// false when block is broken.
+			bool read(EventLogEvent& event)
+			{
+				uint64_t value = 0;
+
+				if (read_varint(cursor_, end_, value) == false)
+				{
+					return false;
+				}
+
+				timestamp_ += value >> 2;
+
+				event.event_type_ = static_cast<uint32_t>(value & 3);
+
+				event.shard_index_ = shard_index_;
+
+				event.timestamp_ = timestamp_;
+
+				event.previous_address_ = 0;
+
+				event.size_ = 0;
+
+				event.stack_id_ = 0;
+
+				const auto read_address = [this](uint64_t& address)
+					{
+						uint64_t delta = 0;
+
+						if (read_varint(cursor_, end_, delta) == false)
+						{
+							return false;
+						}
+
+						address_ += static_cast<uint64_t>(decode_zigzag(delta));
+
+						address = address_;
+
+						return true;
+					};
+
+				uint64_t stack_id = 0;
+
+				switch (event.event_type_)
+				{
+				case EVENT_LOG_ALLOCATE:
+					if (read_address(event.address_) == false || read_varint(cursor_, end_, event.size_) == false || read_varint(cursor_, end_, stack_id) == false)
+					{
+						return false;
+					}
+					break;
+				case EVENT_LOG_FREE:
+					if (read_address(event.address_) == false)
+					{
+						return false;
+					}
+					break;
+				case EVENT_LOG_REALLOCATE:
+					if (read_address(event.previous_address_) == false || read_address(event.address_) == false ||
+						read_varint(cursor_, end_, event.size_) == false || read_varint(cursor_, end_, stack_id) == false)
+					{
+						return false;
+					}
+					break;
+				default:
+					return false;
+				}
+
+				event.stack_id_ = static_cast<uint32_t>(stack_id);
+
+				remaining_count_--;
+
+				return true;
+			}
+		};
+	}
+
+#pragma region EventLogBlock
+	EventLogBlock::EventLogBlock() :
+		shard_index_(0)
+		, first_timestamp_(0)
+		, event_count_(0)
+		, payload_()
+		, stack_ids_()
+	{
+	}
+
+	EventLogBlock::~EventLogBlock()
+	{
+	}
+
+	void* EventLogBlock::operator new(size_t size)
+	{
+		return memtracer_alloc(size);
+	}
+
+	void EventLogBlock::operator delete(void* p)
+	{
+		memtracer_free(p);
+	}
+#pragma endregion
+
+#pragma region EventLogWriter
+	EventLogWriter::EventLogWriter(const StackTable& stack_table, SymbolCache& symbol_cache, std::mutex& symbol_cache_mutex) :
+		stack_table_(stack_table)
+		, symbol_cache_(symbol_cache)
+		, symbol_cache_mutex_(symbol_cache_mutex)
+		, file_writer_()
+		, start_timestamp_(0)
+		, blocks_mutex_()
+		, blocks_condition_()
+		, submitted_blocks_()
+		, free_blocks_()
+		, block_count_(0)
+		, is_close_requested_(false)
+		, end_timestamp_(0)
+		, is_stack_written_()
+		, written_frames_()
+		, new_frames_()
+		, stack_payload_()
+		, frame_payload_()
+	{
+	}
+
+	EventLogWriter::~EventLogWriter()
+	{
+		for (EventLogBlock* block : submitted_blocks_)
+		{
+			delete block;
+		}
+
+		for (EventLogBlock* block : free_blocks_)
+		{
+			delete block;
+		}
+	}
+
+	bool EventLogWriter::open(const TCHAR* path, uint32_t shard_count, uint64_t sampling_interval, Timestamp start_timestamp)
+	{
+		start_timestamp_ = start_timestamp;
+
+		is_close_requested_ = false;
+
+		end_timestamp_ = 0;
+
+		// stacks and frames are written again to each file.
+		is_stack_written_.clear();
+
+		written_frames_.clear();
+
+		if (file_writer_.open(path) == false)
+		{
+			return false;
+		}
+
+		EventLogFileHeader header;
+
+		std::memset(&header, 0, sizeof(EventLogFileHeader));
+
+		std::memcpy(header.magic_, EVENT_LOG_FILE_MAGIC, sizeof(header.magic_));
+
+		header.version_ = EVENT_LOG_FILE_VERSION;
+
+		header.endian_tag_ = EVENT_LOG_FILE_ENDIAN_TAG;
+
+		header.shard_count_ = shard_count;
+
+		header.sampling_interval_ = sampling_interval;
+
+		if (file_writer_.write(&header, sizeof(EventLogFileHeader)) == false)
+		{
+			file_writer_.close();
+
+			return false;
+		}
+
+		return true;
+	}
+
+	void EventLogWriter::run()
+	{
+		while (true)
+		{
+			EventLogBlock* block = nullptr;
+
+			{
+				std::unique_lock<std::mutex> lock(blocks_mutex_);
+
+				blocks_condition_.wait(lock, [this]()
+					{
+						return submitted_blocks_.empty() == false || is_close_requested_ == true;
+					});
+
+				if (submitted_blocks_.empty() == true)
+				{
+					break;
+				}
+
+				block = submitted_blocks_.front();
+
+				submitted_blocks_.pop_front();
+			}
+
+			write_block(*block);
+
+			{
+				std::lock_guard<std::mutex> lock(blocks_mutex_);
+
+				free_blocks_.push_back(block);
+			}
+
+			blocks_condition_.notify_all();
+		}
+
+		write_block_header(EVENT_LOG_BLOCK_END, 0, get_log_timestamp(end_timestamp_), 0, 0);
+
+		if (file_writer_.close() == false)
+		{
+			std::cerr << "Failed to write event log." << std::endl;
+		}
+	}
+
+	void EventLogWriter::request_close(Timestamp end_timestamp)
+	{
+		{
+			std::lock_guard<std::mutex> lock(blocks_mutex_);
+
+			end_timestamp_ = end_timestamp;
+
+			is_close_requested_ = true;
+		}
+
+		blocks_condition_.notify_all();
+	}
+
+	EventLogBlock* EventLogWriter::acquire_block()
+	{
+		std::unique_lock<std::mutex> lock(blocks_mutex_);
+
+		if (free_blocks_.empty() == true && block_count_ < EVENT_LOG_MAX_BLOCKS)
+		{
+			block_count_++;
+
+			lock.unlock();
+
+			EventLogBlock* block = new EventLogBlock();
+
+			block->payload_.reserve(EVENT_LOG_BLOCK_SIZE);
+
+			return block;
+		}
+
+		// a thread which waits here submitted its own block, so event log thread returns one.
+		blocks_condition_.wait(lock, [this]()
+			{
+				return free_blocks_.empty() == false;
+			});
+
+		EventLogBlock* block = free_blocks_.back();
+
+		free_blocks_.pop_back();
+
+		lock.unlock();
+
+		block->event_count_ = 0;
+
+		block->payload_.clear();
+
+		block->stack_ids_.clear();
+
+		return block;
+	}
+
+	void EventLogWriter::submit_block(EventLogBlock* block)
+	{
+		{
+			std::lock_guard<std::mutex> lock(blocks_mutex_);
+
+			if (block->event_count_ == 0)
+			{
+				free_blocks_.push_back(block);
+			}
+			else
+			{
+				submitted_blocks_.push_back(block);
+			}
+		}
+
+		blocks_condition_.notify_all();
+	}
+
+	uint64_t EventLogWriter::get_log_timestamp(Timestamp timestamp) const
+	{
+		return timestamp > start_timestamp_ ? get_timestamp_nanoseconds(timestamp - start_timestamp_) : 0;
+	}
+
+	void EventLogWriter::write_block(EventLogBlock& block)
+	{
+		if (block.stack_ids_.empty() == false)
+		{
+			write_stacks(block);
+		}
+
+		write_block_header(EVENT_LOG_BLOCK_EVENTS, block.shard_index_, block.first_timestamp_, block.event_count_, static_cast<uint32_t>(block.payload_.size()));
+
+		file_writer_.write(block.payload_.data(), block.payload_.size());
+	}
+
+	void EventLogWriter::write_stacks(const EventLogBlock& block)
+	{
+		stack_payload_.clear();
+
+		uint32_t stack_count = 0;
+
+		new_frames_.clear();
+
+		for (StackId stack_id : block.stack_ids_)
+		{
+			if (stack_id >= is_stack_written_.size())
+			{
+				is_stack_written_.resize(static_cast<size_t>(stack_id) + 1, false);
+			}
+
+			// other shard's block wrote it already.
+			if (is_stack_written_[stack_id] == true)
+			{
+				continue;
+			}
+
+			is_stack_written_[stack_id] = true;
+
+			const StackBackTrace& stack_back_trace = stack_table_.get_stack_back_trace(stack_id);
+
+			append_varint(stack_payload_, stack_id);
+
+			append_varint(stack_payload_, stack_back_trace.get_frame_count());
+
+			uint64_t previous_frame = 0;
+
+			for (FrameCount i = 0; i < stack_back_trace.get_frame_count(); i++)
+			{
+				void* frame = stack_back_trace.get_stack_frame(i);
+
+				const uint64_t address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(frame));
+
+				append_varint(stack_payload_, encode_zigzag(static_cast<int64_t>(address - previous_frame)));
+
+				previous_frame = address;
+
+				if (written_frames_.insert(frame).second == true)
+				{
+					new_frames_.push_back(frame);
+				}
+			}
+
+			stack_count++;
+		}
+
+		if (stack_count == 0)
+		{
+			return;
+		}
+
+		if (new_frames_.empty() == false)
+		{
+			frame_payload_.clear();
+
+			std::lock_guard<std::mutex> lock(symbol_cache_mutex_);
+
+			for (void* frame : new_frames_)
+			{
+				symbol_cache_.add_frame(frame);
+			}
+
+			symbol_cache_.resolve_pending_frames();
+
+			for (void* frame : new_frames_)
+			{
+				const FrameSymbol* frame_symbol = symbol_cache_.find_frame_symbol(frame);
+
+				append_varint(frame_payload_, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(frame)));
+
+				if (frame_symbol == nullptr)
+				{
+					append_varint(frame_payload_, 0);
+
+					append_varint(frame_payload_, 0);
+
+					append_varint(frame_payload_, 0);
+
+					append_string(frame_payload_, std::string());
+
+					append_string(frame_payload_, std::string());
+
+					continue;
+				}
+
+				const uint32_t flags = SNAPSHOT_FILE_FRAME_HAS_SYMBOL | (frame_symbol->has_line_ == true ? SNAPSHOT_FILE_FRAME_HAS_LINE : 0);
+
+				append_varint(frame_payload_, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(frame_symbol->symbol_address_)));
+
+				append_varint(frame_payload_, frame_symbol->has_line_ == true ? frame_symbol->line_number_ : 0);
+
+				append_varint(frame_payload_, flags);
+
+				append_string(frame_payload_, convert_to_utf8(frame_symbol->symbol_name_));
+
+				append_string(frame_payload_, frame_symbol->has_line_ == true ? convert_to_utf8(frame_symbol->file_name_) : std::string());
+			}
+
+			write_block_header(EVENT_LOG_BLOCK_FRAMES, 0, block.first_timestamp_, static_cast<uint32_t>(new_frames_.size()), static_cast<uint32_t>(frame_payload_.size()));
+
+			file_writer_.write(frame_payload_.data(), frame_payload_.size());
+		}
+
+		write_block_header(EVENT_LOG_BLOCK_STACKS, 0, block.first_timestamp_, stack_count, static_cast<uint32_t>(stack_payload_.size()));
+
+		file_writer_.write(stack_payload_.data(), stack_payload_.size());
+	}
+
+	void EventLogWriter::write_block_header(uint32_t block_type, uint32_t shard_index, uint64_t first_timestamp, uint32_t record_count, uint32_t payload_size)
+	{
+		EventLogBlockHeader block_header;
+
+		block_header.block_type_ = block_type;
+
+		block_header.shard_index_ = shard_index;
+
+		block_header.first_timestamp_ = first_timestamp;
+
+		block_header.record_count_ = record_count;
+
+		block_header.payload_size_ = payload_size;
+
+		file_writer_.write(&block_header, sizeof(EventLogBlockHeader));
+	}
+#pragma endregion
+
+#pragma region EventLogStream
+	EventLogStream::EventLogStream() :
+		event_log_writer_(nullptr)
+		, shard_index_(0)
+		, block_(nullptr)
+		, previous_timestamp_(0)
+		, previous_address_(0)
+		, is_stack_listed_()
+	{
+	}
+
+	EventLogStream::~EventLogStream()
+	{
+		assert(block_ == nullptr);
+	}
+
+	void EventLogStream::open(EventLogWriter* event_log_writer, uint32_t shard_index)
+	{
+		assert(block_ == nullptr);
+
+		event_log_writer_ = event_log_writer;
+
+		shard_index_ = shard_index;
+
+		is_stack_listed_.clear();
+	}
+
+	void EventLogStream::close()
+	{
+		flush();
+
+		event_log_writer_ = nullptr;
+	}
+
+	bool EventLogStream::is_open() const
+	{
+		return event_log_writer_ != nullptr;
+	}
+
+	void EventLogStream::add_allocation(Timestamp timestamp, const void* address, size_t size, StackId stack_id)
+	{
+		begin_event(timestamp, EVENT_LOG_ALLOCATE);
+
+		add_address(address);
+
+		add_varint(size);
+
+		add_stack_id(stack_id);
+
+		end_event();
+	}
+
+	void EventLogStream::add_free(Timestamp timestamp, const void* address)
+	{
+		begin_event(timestamp, EVENT_LOG_FREE);
+
+		add_address(address);
+
+		end_event();
+	}
+
+	void EventLogStream::add_reallocation(Timestamp timestamp, const void* previous_address, const void* address, size_t size, StackId stack_id)
+	{
+		begin_event(timestamp, EVENT_LOG_REALLOCATE);
+
+		add_address(previous_address);
+
+		add_address(address);
+
+		add_varint(size);
+
+		add_stack_id(stack_id);
+
+		end_event();
+	}
+
+	void EventLogStream::flush()
+	{
+		if (block_ != nullptr)
+		{
+			event_log_writer_->submit_block(block_);
+
+			block_ = nullptr;
+		}
+	}
+
+	void EventLogStream::begin_event(Timestamp timestamp, uint32_t event_type)
+	{
+		const uint64_t log_timestamp = event_log_writer_->get_log_timestamp(timestamp);
+
+		if (block_ == nullptr)
+		{
+			block_ = event_log_writer_->acquire_block();
+
+			block_->shard_index_ = shard_index_;
+
+			block_->first_timestamp_ = log_timestamp;
+
+			previous_timestamp_ = log_timestamp;
+
+			previous_address_ = 0;
+		}
+
+		// records are applied in timestamp order. equal or earlier one is stored as same time.
+		const uint64_t timestamp_delta = log_timestamp > previous_timestamp_ ? log_timestamp - previous_timestamp_ : 0;
+
+		previous_timestamp_ += timestamp_delta;
+
+		add_varint(timestamp_delta << 2 | event_type);
+	}
+
+	void EventLogStream::add_address(const void* address)
+	{
+		const uint64_t value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(address));
+
+		add_varint(encode_zigzag(static_cast<int64_t>(value - previous_address_)));
+
+		previous_address_ = value;
+	}
+
+	void EventLogStream::add_stack_id(StackId stack_id)
+	{
+		add_varint(stack_id);
+
+		if (stack_id >= is_stack_listed_.size())
+		{
+			is_stack_listed_.resize(static_cast<size_t>(stack_id) + 1, false);
+		}
+
+		if (is_stack_listed_[stack_id] == false)
+		{
+			is_stack_listed_[stack_id] = true;
+
+			block_->stack_ids_.push_back(stack_id);
+		}
+	}
+
+	void EventLogStream::add_varint(uint64_t value)
+	{
+		append_varint(block_->payload_, value);
+	}
+
+	void EventLogStream::end_event()
+	{
+		block_->event_count_++;
+
+		if (block_->payload_.size() + MAX_EVENT_SIZE > EVENT_LOG_BLOCK_SIZE)
+		{
+			flush();
+		}
+	}
+#pragma endregion
+
+#pragma region EventLogFile
+	EventLogFile::EventLogFile() :
+		data_(nullptr)
+		, size_(0)
+		, is_complete_(false)
+		, end_timestamp_(0)
+		, event_count_(0)
+		, stacks_()
+		, frames_()
+		, event_blocks_()
+	{
+	}
+
+	EventLogFile::~EventLogFile()
+	{
+		close();
+	}
+
+	bool EventLogFile::open(const TCHAR* path)
+	{
+		close();
+
+		data_ = static_cast<const char*>(map_file(path, size_));
+
+		if (data_ == nullptr)
+		{
+			return false;
+		}
+
+		if (size_ < sizeof(EventLogFileHeader) ||
+			std::memcmp(get_header().magic_, EVENT_LOG_FILE_MAGIC, sizeof(get_header().magic_)) != 0 ||
+			get_header().version_ != EVENT_LOG_FILE_VERSION ||
+			get_header().endian_tag_ != EVENT_LOG_FILE_ENDIAN_TAG ||
+			get_header().shard_count_ == 0 || get_header().shard_count_ > MAX_TRACER_THREADS)
+		{
+			close();
+
+			return false;
+		}
+
+		event_blocks_.resize(get_header().shard_count_);
+
+		size_t offset = sizeof(EventLogFileHeader);
+
+		while (size_ - offset >= sizeof(EventLogBlockHeader) && is_complete_ == false)
+		{
+			// payloads are not padded, so headers are copied out.
+			EventLogBlockHeader block_header;
+
+			std::memcpy(&block_header, data_ + offset, sizeof(EventLogBlockHeader));
+
+			const size_t payload_offset = offset + sizeof(EventLogBlockHeader);
+
+			if (block_header.payload_size_ > size_ - payload_offset)
+			{
+				break;
+			}
+
+			const uint8_t* payload = reinterpret_cast<const uint8_t*>(data_ + payload_offset);
+
+			const uint8_t* payload_end = payload + block_header.payload_size_;
+
+			bool is_valid = true;
+
+			switch (block_header.block_type_)
+			{
+			case EVENT_LOG_BLOCK_STACKS:
+				is_valid = read_stacks(payload, payload_end, block_header.record_count_);
+				break;
+			case EVENT_LOG_BLOCK_FRAMES:
+				is_valid = read_frames(payload, payload_end, block_header.record_count_);
+				break;
+			case EVENT_LOG_BLOCK_EVENTS:
+				is_valid = block_header.shard_index_ < get_header().shard_count_;
+
+				if (is_valid == true)
+				{
+					event_blocks_[block_header.shard_index_].push_back(offset);
+
+					event_count_ += block_header.record_count_;
+				}
+				break;
+			case EVENT_LOG_BLOCK_END:
+				is_complete_ = true;
+
+				end_timestamp_ = block_header.first_timestamp_;
+				break;
+			default:
+				is_valid = false;
+				break;
+			}
+
+			if (is_valid == false)
+			{
+				break;
+			}
+
+			offset = payload_offset + block_header.payload_size_;
+		}
+
+		// log of a crashed process ends at its last event.
+		if (is_complete_ == false)
+		{
+			for (const std::vector<size_t>& shard_blocks : event_blocks_)
+			{
+				if (shard_blocks.empty() == true)
+				{
+					continue;
+				}
+
+				EventBlockReader reader;
+
+				reader.reset(data_, shard_blocks.back());
+
+				EventLogEvent event;
+
+				while (reader.remaining_count_ != 0 && reader.read(event) == true)
+				{
+					end_timestamp_ = (std::max)(end_timestamp_, event.timestamp_);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void EventLogFile::close()
+	{
+		if (data_ != nullptr)
+		{
+			unmap_file(data_, size_);
+		}
+
+		data_ = nullptr;
+
+		size_ = 0;
+
+		is_complete_ = false;
+
+		end_timestamp_ = 0;
+
+		event_count_ = 0;
+
+		stacks_.clear();
+
+		frames_.clear();
+
+		event_blocks_.clear();
+	}
+
+	const EventLogFileHeader& EventLogFile::get_header() const
+	{
+		assert(data_ != nullptr);
+
+		return *reinterpret_cast<const EventLogFileHeader*>(data_);
+	}
+
+	bool EventLogFile::is_complete() const
+	{
+		return is_complete_;
+	}
+
+	uint64_t EventLogFile::get_end_timestamp() const
+	{
+		return end_timestamp_;
+	}
+
+	uint64_t EventLogFile::get_event_count() const
+	{
+		return event_count_;
+	}
+
+	const std::vector<EventLogStack>& EventLogFile::get_stacks() const
+	{
+		return stacks_;
+	}
+
+	const EventLogFrame* EventLogFile::find_frame(uint64_t address) const
+	{
+		auto iterator = frames_.find(address);
+
+		if (iterator == frames_.end() || (iterator->second.flags_ & SNAPSHOT_FILE_FRAME_HAS_SYMBOL) == 0)
+		{
+			return nullptr;
+		}
+
+		return &iterator->second;
+	}
+
+	bool EventLogFile::read_events(const std::function<bool(const EventLogEvent&)>& visitor) const
+	{
+		struct ShardCursor
+		{
+			size_t next_block_;
+
+			EventBlockReader reader_;
+
+			EventLogEvent event_;
+		};
+
+		std::vector<ShardCursor> cursors(event_blocks_.size());
+
+		// 1 when next event is read, 0 at end of shard, -1 for broken block.
+		const auto advance = [this, &cursors](size_t shard_index)
+			{
+				ShardCursor& cursor = cursors[shard_index];
+
+				const std::vector<size_t>& shard_blocks = event_blocks_[shard_index];
+
+				while (cursor.reader_.remaining_count_ == 0)
+				{
+					if (cursor.next_block_ == shard_blocks.size())
+					{
+						return 0;
+					}
+
+					cursor.reader_.reset(data_, shard_blocks[cursor.next_block_++]);
+				}
+
+				return cursor.reader_.read(cursor.event_) == true ? 1 : -1;
+			};
+
+		using HeapEntry = std::pair<uint64_t, size_t>;
+
+		// earliest event of all shards on top.
+		std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+
+		for (size_t shard_index = 0; shard_index < cursors.size(); shard_index++)
+		{
+			cursors[shard_index].next_block_ = 0;
+
+			cursors[shard_index].reader_.remaining_count_ = 0;
+
+			const int result = advance(shard_index);
+
+			if (result < 0)
+			{
+				return false;
+			}
+
+			if (result > 0)
+			{
+				heap.emplace(cursors[shard_index].event_.timestamp_, shard_index);
+			}
+		}
+
+		while (heap.empty() == false)
+		{
+			const size_t shard_index = heap.top().second;
+
+			heap.pop();
+
+			if (visitor(cursors[shard_index].event_) == false)
+			{
+				return true;
+			}
+
+			const int result = advance(shard_index);
+
+			if (result < 0)
+			{
+				return false;
+			}
+
+			if (result > 0)
+			{
+				heap.emplace(cursors[shard_index].event_.timestamp_, shard_index);
+			}
+		}
+
+		return true;
+	}
+
+	bool EventLogFile::read_stacks(const uint8_t* payload, const uint8_t* end, uint32_t record_count)
+	{
+		for (uint32_t i = 0; i < record_count; i++)
+		{
+			uint64_t stack_id = 0;
+
+			uint64_t frame_count = 0;
+
+			if (read_varint(payload, end, stack_id) == false || read_varint(payload, end, frame_count) == false || frame_count > MAX_STACK_FRAMES)
+			{
+				return false;
+			}
+
+			EventLogStack stack;
+
+			stack.stack_id_ = static_cast<uint32_t>(stack_id);
+
+			uint64_t frame = 0;
+
+			for (uint64_t j = 0; j < frame_count; j++)
+			{
+				uint64_t delta = 0;
+
+				if (read_varint(payload, end, delta) == false)
+				{
+					return false;
+				}
+
+				frame += static_cast<uint64_t>(decode_zigzag(delta));
+
+				stack.frames_.push_back(frame);
+			}
+
+			stacks_.push_back(std::move(stack));
+		}
+
+		return true;
+	}
+
+	bool EventLogFile::read_frames(const uint8_t* payload, const uint8_t* end, uint32_t record_count)
+	{
+		for (uint32_t i = 0; i < record_count; i++)
+		{
+			uint64_t address = 0;
+
+			uint64_t line_number = 0;
+
+			uint64_t flags = 0;
+
+			EventLogFrame frame;
+
+			if (read_varint(payload, end, address) == false || read_varint(payload, end, frame.symbol_address_) == false ||
+				read_varint(payload, end, line_number) == false || read_varint(payload, end, flags) == false ||
+				read_string(payload, end, frame.symbol_name_) == false || read_string(payload, end, frame.file_name_) == false)
+			{
+				return false;
+			}
+
+			frame.line_number_ = static_cast<uint32_t>(line_number);
+
+			frame.flags_ = static_cast<uint32_t>(flags);
+
+			frames_.emplace(address, std::move(frame));
+		}
+
+		return true;
+	}
+#pragma endregion
+}
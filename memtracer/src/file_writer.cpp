@@ -0,0 +1,120 @@
+#include "file_writer.h"
+
+#include "memory_tracer_allocation.h"
+
+namespace memtracer
+{
+	FileWriter::FileWriter() :
+		file_handle_(INVALID_FILE_HANDLE)
+		, buffer_(static_cast<char*>(memtracer_alloc(BUFFER_SIZE)))
+		, buffer_size_(0)
+		, offset_(0)
+		, is_failed_(false)
+	{
+	}
+
+	FileWriter::~FileWriter()
+	{
+		close();
+
+		memtracer_free(buffer_);
+	}
+
+	bool FileWriter::open(const TCHAR* path)
+	{
+		assert(file_handle_ == INVALID_FILE_HANDLE);
+
+		file_handle_ = open_file(path);
+
+		buffer_size_ = 0;
+
+		offset_ = 0;
+
+		is_failed_ = file_handle_ == INVALID_FILE_HANDLE;
+
+		return is_failed_ == false;
+	}
+
+	bool FileWriter::write(const void* data, size_t size)
+	{
+		if (is_failed_ == true)
+		{
+			return false;
+		}
+
+		offset_ += size;
+
+		// large block goes directly to file.
+		if (size >= BUFFER_SIZE)
+		{
+			is_failed_ = flush() == false || write_file(file_handle_, data, size) == false;
+
+			return is_failed_ == false;
+		}
+
+		if (buffer_size_ + size > BUFFER_SIZE && flush() == false)
+		{
+			is_failed_ = true;
+
+			return false;
+		}
+
+		std::memcpy(buffer_ + buffer_size_, data, size);
+
+		buffer_size_ += size;
+
+		return true;
+	}
+
+	bool FileWriter::align(size_t alignment)
+	{
+		static constexpr char padding[16] = { 0 };
+
+		assert(alignment <= sizeof(padding));
+
+		const size_t remainder = offset_ % alignment;
+
+		return remainder == 0 || write(padding, alignment - remainder);
+	}
+
+	bool FileWriter::close()
+	{
+		if (file_handle_ == INVALID_FILE_HANDLE)
+		{
+			return false;
+		}
+
+		if (is_failed_ == false && flush() == false)
+		{
+			is_failed_ = true;
+		}
+
+		if (close_file(file_handle_) == false)
+		{
+			is_failed_ = true;
+		}
+
+		file_handle_ = INVALID_FILE_HANDLE;
+
+		return is_failed_ == false;
+	}
+
+	size_t FileWriter::get_offset() const
+	{
+		return offset_;
+	}
+
+	bool FileWriter::flush()
+	{
+		if (buffer_size_ == 0)
+		{
+			return true;
+		}
+
+		const bool is_written = write_file(file_handle_, buffer_, buffer_size_);
+
+		buffer_size_ = 0;
+
+		return is_written;
+	}
+}
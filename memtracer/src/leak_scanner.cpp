@@ -0,0 +1,313 @@
+#include "leak_scanner.h"
+
+namespace memtracer
+{
+	LeakScanner::LeakScanner(const LeakBlockList& leak_blocks, unsigned int worker_count, void (*init_worker_thread)()) :
+		leak_blocks_(leak_blocks)
+		, worker_count_((std::max)(worker_count, 1u))
+		, init_worker_thread_(init_worker_thread)
+		, min_address_(0)
+		, max_address_(0)
+		, is_marked_(leak_blocks.size())
+		, next_root_chunk_(0)
+		, shared_work_mutex_()
+		, shared_work_condition_()
+		, shared_work_list_()
+		, idle_worker_count_(0)
+	{
+		if (leak_blocks_.empty() == false)
+		{
+			min_address_ = reinterpret_cast<uintptr_t>(leak_blocks_.front().address_);
+
+			max_address_ = reinterpret_cast<uintptr_t>(leak_blocks_.back().address_) + leak_blocks_.back().size_;
+		}
+	}
+
+	LeakScanner::~LeakScanner()
+	{
+	}
+
+	bool LeakScanner::mark(const MemoryRangeList& roots)
+	{
+		// this stack is always readable. failure here means read_memory doesn't work at all.
+		const uintptr_t readable_value = 1;
+
+		uintptr_t copied_value = 0;
+
+		if (read_memory(&readable_value, &copied_value, sizeof(copied_value)) != sizeof(copied_value) || copied_value != readable_value)
+		{
+			return false;
+		}
+
+		if (leak_blocks_.empty() == true)
+		{
+			return true;
+		}
+
+		MemoryRangeList root_chunks;
+
+		for (const MemoryRange& root : roots)
+		{
+			for (uintptr_t begin = root.begin_; begin < root.end_; begin += (std::min)(root.end_ - begin, SCAN_CHUNK_SIZE))
+			{
+				root_chunks.push_back(MemoryRange{ begin, begin + (std::min)(root.end_ - begin, SCAN_CHUNK_SIZE) });
+			}
+		}
+
+		next_root_chunk_.store(0, std::memory_order_relaxed);
+
+		idle_worker_count_.store(0, std::memory_order_relaxed);
+
+		shared_work_list_.clear();
+
+		std::vector<std::thread, MemoryTracerAllocator<std::thread>> workers;
+
+		for (unsigned int i = 1; i < worker_count_; i++)
+		{
+			workers.emplace_back(&LeakScanner::worker_thread_update, this, std::cref(root_chunks));
+		}
+
+		worker_update(root_chunks);
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		return true;
+	}
+
+	bool LeakScanner::is_marked(size_t index) const
+	{
+		return is_marked_[index].load(std::memory_order_relaxed);
+	}
+
+	size_t LeakScanner::find_block(uintptr_t address) const
+	{
+		auto iterator = std::upper_bound(leak_blocks_.begin(), leak_blocks_.end(), address, [](uintptr_t address, const LeakBlock& leak_block)
+			{
+				return address < reinterpret_cast<uintptr_t>(leak_block.address_);
+			});
+
+		if (iterator == leak_blocks_.begin())
+		{
+			return SIZE_MAX;
+		}
+
+		--iterator;
+
+		// pointers into the middle of a block keep it too. (e.g. base class or member of an object)
+		if (address - reinterpret_cast<uintptr_t>(iterator->address_) >= iterator->size_)
+		{
+			return SIZE_MAX;
+		}
+
+		return static_cast<size_t>(iterator - leak_blocks_.begin());
+	}
+
+	void LeakScanner::scan_words(const uintptr_t* words, size_t word_count, IndexList& work_list)
+	{
+		for (size_t i = 0; i < word_count; i++)
+		{
+			const uintptr_t value = words[i];
+
+			if (value < min_address_ || value >= max_address_)
+			{
+				continue;
+			}
+
+			const size_t index = find_block(value);
+
+			if (index != SIZE_MAX && is_marked_[index].load(std::memory_order_relaxed) == false && is_marked_[index].exchange(true, std::memory_order_relaxed) == false)
+			{
+				work_list.push_back(index);
+			}
+		}
+	}
+
+	void LeakScanner::scan_range(uintptr_t begin, uintptr_t end, WordBuffer& word_buffer, IndexList& work_list)
+	{
+		begin = (begin + sizeof(uintptr_t) - 1) & ~(static_cast<uintptr_t>(sizeof(uintptr_t)) - 1);
+
+		end &= ~(static_cast<uintptr_t>(sizeof(uintptr_t)) - 1);
+
+		while (begin < end)
+		{
+			const size_t size = static_cast<size_t>((std::min)(end - begin, static_cast<uintptr_t>(SCAN_CHUNK_SIZE)));
+
+			const size_t copied_size = read_memory(reinterpret_cast<const void*>(begin), word_buffer.data(), size);
+
+			scan_words(word_buffer.data(), copied_size / sizeof(uintptr_t), work_list);
+
+			if (copied_size == size)
+			{
+				begin += size;
+			}
+			// page after the copied part can't be read. (unmapped or guard page)
+			else
+			{
+				begin = ((begin + copied_size) & ~(static_cast<uintptr_t>(OS_PAGE_SIZE) - 1)) + OS_PAGE_SIZE;
+			}
+		}
+	}
+
+	void LeakScanner::scan_ranges(const MemoryRangeList& ranges, WordBuffer& word_buffer, IndexList& work_list)
+	{
+		const size_t copied_size = read_memory_ranges(ranges.data(), ranges.size(), word_buffer.data());
+
+		size_t offset = 0;
+
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			const size_t size = static_cast<size_t>(ranges[i].end_ - ranges[i].begin_);
+
+			// a block freed after first pass can be unmapped. it and the rest are read one by one.
+			if (offset + size > copied_size)
+			{
+				for (; i < ranges.size(); i++)
+				{
+					scan_range(ranges[i].begin_, ranges[i].end_, word_buffer, work_list);
+				}
+
+				return;
+			}
+
+			scan_words(word_buffer.data() + offset / sizeof(uintptr_t), size / sizeof(uintptr_t), work_list);
+
+			offset += size;
+		}
+	}
+
+	void LeakScanner::scan_work_list(WordBuffer& word_buffer, IndexList& work_list)
+	{
+		MemoryRangeList ranges;
+
+		while (work_list.empty() == false)
+		{
+			ranges.clear();
+
+			size_t batch_size = 0;
+
+			while (work_list.empty() == false && ranges.size() < READ_BATCH_COUNT)
+			{
+				const LeakBlock& leak_block = leak_blocks_[work_list.back()];
+
+				const uintptr_t begin = (reinterpret_cast<uintptr_t>(leak_block.address_) + sizeof(uintptr_t) - 1) & ~(static_cast<uintptr_t>(sizeof(uintptr_t)) - 1);
+
+				const uintptr_t end = (reinterpret_cast<uintptr_t>(leak_block.address_) + leak_block.size_) & ~(static_cast<uintptr_t>(sizeof(uintptr_t)) - 1);
+
+				if (begin >= end)
+				{
+					work_list.pop_back();
+
+					continue;
+				}
+
+				if (end - begin > SCAN_CHUNK_SIZE - batch_size)
+				{
+					// larger than a chunk. read in chunks by itself.
+					if (ranges.empty() == true)
+					{
+						work_list.pop_back();
+
+						scan_range(begin, end, word_buffer, work_list);
+					}
+
+					break;
+				}
+
+				work_list.pop_back();
+
+				ranges.push_back(MemoryRange{ begin, end });
+
+				batch_size += static_cast<size_t>(end - begin);
+			}
+
+			if (ranges.empty() == false)
+			{
+				scan_ranges(ranges, word_buffer, work_list);
+			}
+
+			// long lists and trees are found by one worker. others take half of its blocks.
+			if (work_list.size() > SHARE_THRESHOLD && idle_worker_count_.load(std::memory_order_relaxed) != 0)
+			{
+				const size_t shared_count = work_list.size() / 2;
+
+				{
+					std::lock_guard<std::mutex> lock(shared_work_mutex_);
+
+					shared_work_list_.insert(shared_work_list_.end(), work_list.begin(), work_list.begin() + shared_count);
+				}
+
+				work_list.erase(work_list.begin(), work_list.begin() + shared_count);
+
+				shared_work_condition_.notify_all();
+			}
+		}
+	}
+
+	bool LeakScanner::take_shared_work(IndexList& work_list)
+	{
+		std::unique_lock<std::mutex> lock(shared_work_mutex_);
+
+		idle_worker_count_.fetch_add(1, std::memory_order_relaxed);
+
+		shared_work_condition_.wait(lock, [this]()
+			{
+				return shared_work_list_.empty() == false || idle_worker_count_.load(std::memory_order_relaxed) == worker_count_;
+			});
+
+		// nobody is scanning, so no more blocks can be shared.
+		if (shared_work_list_.empty() == true)
+		{
+			lock.unlock();
+
+			shared_work_condition_.notify_all();
+
+			return false;
+		}
+
+		idle_worker_count_.fetch_sub(1, std::memory_order_relaxed);
+
+		const size_t taken_count = (std::min)(shared_work_list_.size(), SHARE_THRESHOLD);
+
+		work_list.assign(shared_work_list_.end() - taken_count, shared_work_list_.end());
+
+		shared_work_list_.resize(shared_work_list_.size() - taken_count);
+
+		return true;
+	}
+
+	void LeakScanner::worker_update(const MemoryRangeList& root_chunks)
+	{
+		WordBuffer word_buffer(SCAN_CHUNK_SIZE / sizeof(uintptr_t));
+
+		IndexList work_list;
+
+		while (true)
+		{
+			const size_t root_chunk = next_root_chunk_.fetch_add(1, std::memory_order_relaxed);
+
+			if (root_chunk >= root_chunks.size())
+			{
+				break;
+			}
+
+			scan_range(root_chunks[root_chunk].begin_, root_chunks[root_chunk].end_, word_buffer, work_list);
+
+			scan_work_list(word_buffer, work_list);
+		}
+
+		while (take_shared_work(work_list) == true)
+		{
+			scan_work_list(word_buffer, work_list);
+		}
+	}
+
+	void LeakScanner::worker_thread_update(const MemoryRangeList& root_chunks)
+	{
+		init_worker_thread_();
+
+		worker_update(root_chunks);
+	}
+}
@@ -1,15 +1,21 @@
 #include "memory_tracer_allocation.h"
-#include <cstdlib>
+
+#include "arena.h"
 
 namespace memtracer
 {
 	void* memtracer_alloc(size_t size)
 	{
-		return malloc(size);
+		return Arena::get_instance().allocate(size);
 	}
 
 	void memtracer_free(void* p)
 	{
-		free(p);
+		Arena::get_instance().deallocate(p);
+	}
+
+	ArenaStatistics get_arena_statistics()
+	{
+		return Arena::get_instance().get_statistics();
 	}
 }
@@ -0,0 +1,609 @@
+#ifndef _WIN32
+#include "platform.h"
+#include "memory_tracer_allocator.h"
+
+#include <map>
+#include <new>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <link.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace memtracer
+{
+	namespace
+	{
+#pragma region stack_capture
+		thread_local uintptr_t thread_stack_low = 0;
+
+		thread_local uintptr_t thread_stack_high = 0;
+
+		bool get_thread_stack_bounds(uintptr_t& stack_low, uintptr_t& stack_high)
+		{
+			if (thread_stack_high == 0)
+			{
+				pthread_attr_t attribute;
+
+				if (pthread_getattr_np(pthread_self(), &attribute) != 0)
+				{
+					return false;
+				}
+
+				void* stack_address = nullptr;
+
+				size_t stack_size = 0;
+
+				pthread_attr_getstack(&attribute, &stack_address, &stack_size);
+
+				pthread_attr_destroy(&attribute);
+
+				thread_stack_low = reinterpret_cast<uintptr_t>(stack_address);
+
+				thread_stack_high = thread_stack_low + stack_size;
+			}
+
+			stack_low = thread_stack_low;
+
+			stack_high = thread_stack_high;
+
+			return true;
+		}
+
+#if defined(MEMTRACER_USE_FRAME_POINTERS) && (defined(__x86_64__) || defined(__aarch64__))
+		// each frame is { previous frame pointer, return address }. needs -fno-omit-frame-pointer.
+		__attribute__((noinline)) FrameCount walk_frame_pointers(unsigned int frames_to_skip, unsigned int max_frames, void** frames)
+		{
+			uintptr_t stack_low = 0;
+
+			uintptr_t stack_high = 0;
+
+			if (get_thread_stack_bounds(stack_low, stack_high) == false)
+			{
+				return 0;
+			}
+
+			// first return address is in capture_stack_frames.
+			frames_to_skip++;
+
+			const uintptr_t* frame_pointer = static_cast<const uintptr_t*>(__builtin_frame_address(0));
+
+			FrameCount frame_count = 0;
+
+			while (frame_count < max_frames)
+			{
+				const uintptr_t address = reinterpret_cast<uintptr_t>(frame_pointer);
+
+				if (address < stack_low || address + sizeof(uintptr_t) * 2 > stack_high || address % sizeof(uintptr_t) != 0)
+				{
+					break;
+				}
+
+				const uintptr_t return_address = frame_pointer[1];
+
+				if (return_address == 0)
+				{
+					break;
+				}
+
+				if (frames_to_skip > 0)
+				{
+					frames_to_skip--;
+				}
+				else
+				{
+					frames[frame_count++] = reinterpret_cast<void*>(return_address);
+				}
+
+				const uintptr_t* next_frame_pointer = reinterpret_cast<const uintptr_t*>(frame_pointer[0]);
+
+				// stack grows down. anything else is not a frame pointer.
+				if (next_frame_pointer <= frame_pointer)
+				{
+					break;
+				}
+
+				frame_pointer = next_frame_pointer;
+			}
+
+			return frame_count;
+		}
+#endif
+
+		__attribute__((noinline)) FrameCount call_backtrace(unsigned int frames_to_skip, unsigned int max_frames, void** frames)
+		{
+			void* buffer[MAX_STACK_FRAMES + 16];
+
+			// skip call_backtrace and capture_stack_frames.
+			frames_to_skip += 2;
+
+			const int captured = backtrace(buffer, static_cast<int>((std::min)(max_frames + frames_to_skip, static_cast<unsigned int>(MAX_STACK_FRAMES + 16))));
+
+			FrameCount frame_count = 0;
+
+			for (int i = static_cast<int>(frames_to_skip); i < captured && frame_count < max_frames; i++)
+			{
+				frames[frame_count++] = buffer[i];
+			}
+
+			return frame_count;
+		}
+#pragma endregion
+
+#pragma region symbolizer
+		struct ElfSymbol
+		{
+			uintptr_t address_;
+
+			size_t size_;
+
+			const char* name_;
+		};
+
+		// function symbols of a loaded module from its ELF .symtab. dladdr only knows exported symbols.
+		struct ModuleSymbols
+		{
+			void* mapping_;
+
+			size_t mapping_size_;
+
+			std::vector<ElfSymbol, MemoryTracerAllocator<ElfSymbol>> symbols_;
+		};
+
+		// allocations here must not reach traced operator new. it is called inside MemoryTracer::get_instance.
+		using ModuleSymbolsMap = std::map<uintptr_t, ModuleSymbols, std::less<uintptr_t>, MemoryTracerAllocator<std::pair<const uintptr_t, ModuleSymbols>>>;
+
+		ModuleSymbolsMap* module_symbols = nullptr;
+
+		void load_module_symbols(const char* path, uintptr_t base, ModuleSymbols& module)
+		{
+			module.mapping_ = nullptr;
+
+			module.mapping_size_ = 0;
+
+			int file = open(path, O_RDONLY | O_CLOEXEC);
+
+			if (file < 0)
+			{
+				file = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+			}
+
+			if (file < 0)
+			{
+				return;
+			}
+
+			struct stat file_status;
+
+			if (fstat(file, &file_status) != 0 || static_cast<size_t>(file_status.st_size) < sizeof(ElfW(Ehdr)))
+			{
+				close(file);
+
+				return;
+			}
+
+			const size_t file_size = static_cast<size_t>(file_status.st_size);
+
+			void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+			close(file);
+
+			if (mapping == MAP_FAILED)
+			{
+				return;
+			}
+
+			module.mapping_ = mapping;
+
+			module.mapping_size_ = file_size;
+
+			const char* image = static_cast<const char*>(mapping);
+
+			const ElfW(Ehdr)* header = reinterpret_cast<const ElfW(Ehdr)*>(image);
+
+			if (std::memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+				header->e_shoff == 0 ||
+				header->e_shentsize != sizeof(ElfW(Shdr)) ||
+				header->e_shoff + static_cast<size_t>(header->e_shnum) * sizeof(ElfW(Shdr)) > file_size)
+			{
+				return;
+			}
+
+			const ElfW(Shdr)* sections = reinterpret_cast<const ElfW(Shdr)*>(image + header->e_shoff);
+
+			// shared objects and PIE are relative to load base.
+			const uintptr_t load_bias = header->e_type == ET_DYN ? base : 0;
+
+			for (ElfW(Half) i = 0; i < header->e_shnum; i++)
+			{
+				const ElfW(Shdr)& section = sections[i];
+
+				if ((section.sh_type != SHT_SYMTAB && section.sh_type != SHT_DYNSYM) ||
+					section.sh_link >= header->e_shnum ||
+					section.sh_offset + section.sh_size > file_size)
+				{
+					continue;
+				}
+
+				const ElfW(Shdr)& string_section = sections[section.sh_link];
+
+				if (string_section.sh_offset + string_section.sh_size > file_size)
+				{
+					continue;
+				}
+
+				const ElfW(Sym)* symbols = reinterpret_cast<const ElfW(Sym)*>(image + section.sh_offset);
+
+				const size_t symbol_count = section.sh_size / sizeof(ElfW(Sym));
+
+				const char* strings = image + string_section.sh_offset;
+
+				for (size_t j = 0; j < symbol_count; j++)
+				{
+					const ElfW(Sym)& symbol = symbols[j];
+
+					if (ELF64_ST_TYPE(symbol.st_info) != STT_FUNC ||
+						symbol.st_value == 0 ||
+						symbol.st_name >= string_section.sh_size)
+					{
+						continue;
+					}
+
+					module.symbols_.push_back({ load_bias + symbol.st_value, symbol.st_size, strings + symbol.st_name });
+				}
+			}
+
+			std::sort(module.symbols_.begin(), module.symbols_.end(), [](const ElfSymbol& first, const ElfSymbol& second)
+				{
+					return first.address_ < second.address_;
+				});
+		}
+
+		const ElfSymbol* find_elf_symbol(const ModuleSymbols& module, uintptr_t address)
+		{
+			auto iterator = std::upper_bound(module.symbols_.begin(), module.symbols_.end(), address, [](uintptr_t value, const ElfSymbol& symbol)
+				{
+					return value < symbol.address_;
+				});
+
+			if (iterator == module.symbols_.begin())
+			{
+				return nullptr;
+			}
+
+			--iterator;
+
+			if (iterator->size_ != 0 && address >= iterator->address_ + iterator->size_)
+			{
+				return nullptr;
+			}
+
+			return &*iterator;
+		}
+
+		tstring demangle(const char* name)
+		{
+			int status = 0;
+
+			char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+
+			if (status != 0 || demangled == nullptr)
+			{
+				return name;
+			}
+
+			tstring result = demangled;
+
+			std::free(demangled);
+
+			return result;
+		}
+#pragma endregion
+	}
+
+	FrameCount capture_stack_frames(unsigned int frames_to_skip, unsigned int max_frames, void** frames)
+	{
+#if defined(MEMTRACER_USE_FRAME_POINTERS) && (defined(__x86_64__) || defined(__aarch64__))
+		const FrameCount frame_count = walk_frame_pointers(frames_to_skip, max_frames, frames);
+
+		if (frame_count != 0)
+		{
+			return frame_count;
+		}
+#endif
+
+		return call_backtrace(frames_to_skip, max_frames, frames);
+	}
+
+	bool initialize_symbols()
+	{
+		if (module_symbols == nullptr)
+		{
+			module_symbols = new (memtracer_alloc(sizeof(ModuleSymbolsMap))) ModuleSymbolsMap();
+		}
+
+		return true;
+	}
+
+	void finalize_symbols()
+	{
+		if (module_symbols == nullptr)
+		{
+			return;
+		}
+
+		for (auto& pair : *module_symbols)
+		{
+			if (pair.second.mapping_ != nullptr)
+			{
+				munmap(pair.second.mapping_, pair.second.mapping_size_);
+			}
+		}
+
+		module_symbols->~ModuleSymbolsMap();
+
+		memtracer_free(module_symbols);
+
+		module_symbols = nullptr;
+	}
+
+	bool resolve_frame_symbol(void* frame, FrameSymbol& frame_symbol)
+	{
+		// return address points the instruction after call.
+		const uintptr_t address = reinterpret_cast<uintptr_t>(frame) - 1;
+
+		Dl_info information;
+
+		if (module_symbols == nullptr || dladdr(reinterpret_cast<void*>(address), &information) == 0)
+		{
+			return false;
+		}
+
+		const uintptr_t base = reinterpret_cast<uintptr_t>(information.dli_fbase);
+
+		auto iterator = module_symbols->find(base);
+
+		if (iterator == module_symbols->end())
+		{
+			iterator = module_symbols->emplace(base, ModuleSymbols()).first;
+
+			load_module_symbols(information.dli_fname, base, iterator->second);
+		}
+
+		const char* symbol_name = information.dli_sname;
+
+		uintptr_t symbol_address = reinterpret_cast<uintptr_t>(information.dli_saddr);
+
+		// .symtab also has local symbols, so it can be closer than dladdr's.
+		const ElfSymbol* elf_symbol = find_elf_symbol(iterator->second, address);
+
+		if (elf_symbol != nullptr && (symbol_name == nullptr || elf_symbol->address_ > symbol_address))
+		{
+			symbol_name = elf_symbol->name_;
+
+			symbol_address = elf_symbol->address_;
+		}
+
+		if (symbol_name == nullptr)
+		{
+			return false;
+		}
+
+		frame_symbol.symbol_address_ = reinterpret_cast<void*>(symbol_address);
+
+		frame_symbol.symbol_name_ = demangle(symbol_name);
+
+		// no DWARF line table reader. module path is kept for the report.
+		frame_symbol.file_name_ = information.dli_fname != nullptr ? information.dli_fname : "";
+
+		frame_symbol.line_number_ = 0;
+
+		frame_symbol.has_line_ = false;
+
+		return true;
+	}
+
+	bool create_directory(const TCHAR* path)
+	{
+		return mkdir(path, 0755) == 0 || errno == EEXIST;
+	}
+
+	FileHandle open_file(const TCHAR* path)
+	{
+		const int file = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+		return file < 0 ? INVALID_FILE_HANDLE : static_cast<FileHandle>(file);
+	}
+
+	bool write_file(FileHandle file_handle, const void* data, size_t size)
+	{
+		const char* bytes = static_cast<const char*>(data);
+
+		while (size > 0)
+		{
+			const ssize_t written = write(static_cast<int>(file_handle), bytes, size);
+
+			if (written < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				return false;
+			}
+
+			bytes += written;
+
+			size -= static_cast<size_t>(written);
+		}
+
+		return true;
+	}
+
+	bool close_file(FileHandle file_handle)
+	{
+		return close(static_cast<int>(file_handle)) == 0;
+	}
+
+	bool delete_file(const TCHAR* path)
+	{
+		return unlink(path) == 0;
+	}
+
+	const void* map_file(const TCHAR* path, size_t& size)
+	{
+		size = 0;
+
+		const int file = open(path, O_RDONLY | O_CLOEXEC);
+
+		if (file < 0)
+		{
+			return nullptr;
+		}
+
+		struct stat file_status;
+
+		if (fstat(file, &file_status) != 0 || file_status.st_size == 0)
+		{
+			close(file);
+
+			return nullptr;
+		}
+
+		void* data = mmap(nullptr, static_cast<size_t>(file_status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+		close(file);
+
+		if (data == MAP_FAILED)
+		{
+			return nullptr;
+		}
+
+		size = static_cast<size_t>(file_status.st_size);
+
+		return data;
+	}
+
+	void unmap_file(const void* data, size_t size)
+	{
+		munmap(const_cast<void*>(data), size);
+	}
+
+	void* allocate_pages(size_t size)
+	{
+		// mmap aligns only to page. map more, then unmap both ends.
+		const size_t mapped_size = size + PAGE_ALLOCATION_ALIGNMENT;
+
+		void* mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (mapped == MAP_FAILED)
+		{
+			return nullptr;
+		}
+
+		const uintptr_t begin = reinterpret_cast<uintptr_t>(mapped);
+
+		const uintptr_t aligned_begin = (begin + PAGE_ALLOCATION_ALIGNMENT - 1) & ~(static_cast<uintptr_t>(PAGE_ALLOCATION_ALIGNMENT) - 1);
+
+		if (aligned_begin != begin)
+		{
+			munmap(mapped, aligned_begin - begin);
+		}
+
+		const uintptr_t end = begin + mapped_size;
+
+		if (aligned_begin + size != end)
+		{
+			munmap(reinterpret_cast<void*>(aligned_begin + size), end - (aligned_begin + size));
+		}
+
+		return reinterpret_cast<void*>(aligned_begin);
+	}
+
+	void free_pages(void* pages, size_t size)
+	{
+		munmap(pages, size);
+	}
+
+	bool get_thread_stack(uintptr_t& stack_low, uintptr_t& stack_high)
+	{
+		return get_thread_stack_bounds(stack_low, stack_high);
+	}
+
+	void get_data_segments(MemoryRangeList& data_segments)
+	{
+		dl_iterate_phdr([](dl_phdr_info* info, size_t, void* context) -> int
+			{
+				MemoryRangeList& data_segments = *static_cast<MemoryRangeList*>(context);
+
+				for (ElfW(Half) i = 0; i < info->dlpi_phnum; i++)
+				{
+					const ElfW(Phdr)& program_header = info->dlpi_phdr[i];
+
+					if (program_header.p_type == PT_LOAD && (program_header.p_flags & PF_W) != 0)
+					{
+						const uintptr_t begin = static_cast<uintptr_t>(info->dlpi_addr + program_header.p_vaddr);
+
+						data_segments.push_back(MemoryRange{ begin, begin + static_cast<uintptr_t>(program_header.p_memsz) });
+					}
+				}
+
+				return 0;
+			}, &data_segments);
+	}
+
+	size_t read_memory(const void* address, void* buffer, size_t size)
+	{
+		// kernel copies it, so unmapped pages return error instead of SIGSEGV.
+		iovec local_io_vector = { buffer, size };
+
+		iovec remote_io_vector = { const_cast<void*>(address), size };
+
+		const ssize_t read_size = process_vm_readv(getpid(), &local_io_vector, 1, &remote_io_vector, 1, 0);
+
+		return read_size > 0 ? static_cast<size_t>(read_size) : 0;
+	}
+
+	size_t read_memory_ranges(const MemoryRange* ranges, size_t range_count, void* buffer)
+	{
+		assert(range_count <= MAX_READ_MEMORY_RANGES);
+
+		iovec remote_io_vectors[MAX_READ_MEMORY_RANGES];
+
+		size_t size = 0;
+
+		for (size_t i = 0; i < range_count; i++)
+		{
+			remote_io_vectors[i] = { reinterpret_cast<void*>(ranges[i].begin_), static_cast<size_t>(ranges[i].end_ - ranges[i].begin_) };
+
+			size += remote_io_vectors[i].iov_len;
+		}
+
+		iovec local_io_vector = { buffer, size };
+
+		const ssize_t read_size = process_vm_readv(getpid(), &local_io_vector, 1, remote_io_vectors, static_cast<unsigned long>(range_count), 0);
+
+		return read_size > 0 ? static_cast<size_t>(read_size) : 0;
+	}
+
+	std::string convert_to_utf8(const tstring& text)
+	{
+		return text;
+	}
+
+	tstring convert_from_utf8(const std::string& text)
+	{
+		return text;
+	}
+}
+#endif // _WIN32
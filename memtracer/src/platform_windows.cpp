@@ -0,0 +1,308 @@
+#ifdef _WIN32
+#include "platform.h"
+
+namespace memtracer
+{
+	FrameCount capture_stack_frames(unsigned int frames_to_skip, unsigned int max_frames, void** frames)
+	{
+		return CaptureStackBackTrace(frames_to_skip + 1, max_frames, frames, NULL);
+	}
+
+	bool initialize_symbols()
+	{
+		return SymInitialize(GetCurrentProcess(), NULL, TRUE) == TRUE;
+	}
+
+	void finalize_symbols()
+	{
+		SymCleanup(GetCurrentProcess());
+	}
+
+	bool resolve_frame_symbol(void* frame, FrameSymbol& frame_symbol)
+	{
+		HANDLE process_handle = GetCurrentProcess();
+
+		constexpr size_t symbol_size = sizeof(TSYMBOL_INFO) + MAX_SYM_NAME * sizeof(TCHAR);
+
+		BYTE symbol_buffer[symbol_size] = { 0 };
+
+		TSYMBOL_INFO* symbol = reinterpret_cast<TSYMBOL_INFO*>(symbol_buffer);
+
+		symbol->SizeOfStruct = sizeof(TSYMBOL_INFO);
+
+		symbol->MaxNameLen = MAX_SYM_NAME;
+
+		if (TSymFromAddr(process_handle, reinterpret_cast<DWORD64>(frame), NULL, symbol) != TRUE)
+		{
+			return false;
+		}
+
+		frame_symbol.symbol_address_ = reinterpret_cast<void*>(symbol->Address);
+
+		frame_symbol.symbol_name_ = symbol->Name;
+
+		TIMAGEHLP_LINE64 line_info;
+
+		ZeroMemory(&line_info, sizeof(TIMAGEHLP_LINE64));
+
+		line_info.SizeOfStruct = sizeof(TIMAGEHLP_LINE64);
+
+		DWORD displacement = 0;
+
+		frame_symbol.has_line_ = TSymGetLineFromAddr64(process_handle, reinterpret_cast<DWORD64>(frame), &displacement, &line_info) == TRUE;
+
+		if (frame_symbol.has_line_ == true)
+		{
+			frame_symbol.file_name_ = line_info.FileName;
+
+			frame_symbol.line_number_ = line_info.LineNumber;
+		}
+
+		return true;
+	}
+
+	bool create_directory(const TCHAR* path)
+	{
+		return CreateDirectory(path, NULL) == TRUE || GetLastError() == ERROR_ALREADY_EXISTS;
+	}
+
+	FileHandle open_file(const TCHAR* path)
+	{
+		HANDLE file_handle = CreateFile(
+			path
+			, GENERIC_WRITE
+			, 0
+			, NULL
+			, CREATE_ALWAYS
+			, FILE_ATTRIBUTE_NORMAL
+			, NULL);
+
+		return reinterpret_cast<FileHandle>(file_handle);
+	}
+
+	bool write_file(FileHandle file_handle, const void* data, size_t size)
+	{
+		const char* bytes = static_cast<const char*>(data);
+
+		while (size > 0)
+		{
+			DWORD bytes_written = 0;
+
+			const DWORD target_bytes = static_cast<DWORD>((std::min)(size, static_cast<size_t>(1u << 30)));
+
+			if (WriteFile(reinterpret_cast<HANDLE>(file_handle), bytes, target_bytes, &bytes_written, NULL) != TRUE)
+			{
+				return false;
+			}
+
+			bytes += bytes_written;
+
+			size -= bytes_written;
+		}
+
+		return true;
+	}
+
+	bool close_file(FileHandle file_handle)
+	{
+		return CloseHandle(reinterpret_cast<HANDLE>(file_handle)) == TRUE;
+	}
+
+	bool delete_file(const TCHAR* path)
+	{
+		return DeleteFile(path) == TRUE;
+	}
+
+	const void* map_file(const TCHAR* path, size_t& size)
+	{
+		size = 0;
+
+		HANDLE file_handle = CreateFile(
+			path
+			, GENERIC_READ
+			, FILE_SHARE_READ
+			, NULL
+			, OPEN_EXISTING
+			, FILE_ATTRIBUTE_NORMAL
+			, NULL);
+
+		if (file_handle == INVALID_HANDLE_VALUE)
+		{
+			return nullptr;
+		}
+
+		LARGE_INTEGER file_size;
+
+		if (GetFileSizeEx(file_handle, &file_size) != TRUE || file_size.QuadPart == 0)
+		{
+			CloseHandle(file_handle);
+
+			return nullptr;
+		}
+
+		HANDLE mapping_handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+
+		CloseHandle(file_handle);
+
+		if (mapping_handle == NULL)
+		{
+			return nullptr;
+		}
+
+		// view keeps the mapping alive.
+		const void* data = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+
+		CloseHandle(mapping_handle);
+
+		if (data != nullptr)
+		{
+			size = static_cast<size_t>(file_size.QuadPart);
+		}
+
+		return data;
+	}
+
+	void unmap_file(const void* data, size_t size)
+	{
+		UnmapViewOfFile(data);
+	}
+
+	void* allocate_pages(size_t size)
+	{
+		// start of VirtualAlloc is always aligned to allocation granularity. (64 KB)
+		return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	}
+
+	void free_pages(void* pages, size_t size)
+	{
+		VirtualFree(pages, 0, MEM_RELEASE);
+	}
+
+	bool get_thread_stack(uintptr_t& stack_low, uintptr_t& stack_high)
+	{
+		ULONG_PTR low_limit = 0;
+
+		ULONG_PTR high_limit = 0;
+
+		GetCurrentThreadStackLimits(&low_limit, &high_limit);
+
+		stack_low = static_cast<uintptr_t>(low_limit);
+
+		stack_high = static_cast<uintptr_t>(high_limit);
+
+		return stack_high > stack_low;
+	}
+
+	void get_data_segments(MemoryRangeList& data_segments)
+	{
+		constexpr DWORD writable_protection = PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+		MEMORY_BASIC_INFORMATION memory_information;
+
+		const char* address = nullptr;
+
+		while (VirtualQuery(address, &memory_information, sizeof(memory_information)) == sizeof(memory_information))
+		{
+			if (memory_information.Type == MEM_IMAGE && memory_information.State == MEM_COMMIT &&
+				(memory_information.Protect & writable_protection) != 0 && (memory_information.Protect & PAGE_GUARD) == 0)
+			{
+				const uintptr_t begin = reinterpret_cast<uintptr_t>(memory_information.BaseAddress);
+
+				data_segments.push_back(MemoryRange{ begin, begin + memory_information.RegionSize });
+			}
+
+			address = static_cast<const char*>(memory_information.BaseAddress) + memory_information.RegionSize;
+		}
+	}
+
+	size_t read_memory(const void* address, void* buffer, size_t size)
+	{
+		SIZE_T read_size = 0;
+
+		if (ReadProcessMemory(GetCurrentProcess(), address, buffer, size, &read_size) == TRUE)
+		{
+			return static_cast<size_t>(read_size);
+		}
+
+		// whole read fails when any page can't be read. readable pages before it are copied one by one.
+		size_t copied_size = 0;
+
+		while (copied_size < size)
+		{
+			const uintptr_t page_address = reinterpret_cast<uintptr_t>(address) + copied_size;
+
+			const size_t page_read_size = (std::min)(size - copied_size, OS_PAGE_SIZE - page_address % OS_PAGE_SIZE);
+
+			if (ReadProcessMemory(GetCurrentProcess(), reinterpret_cast<const void*>(page_address), static_cast<char*>(buffer) + copied_size, page_read_size, &read_size) == FALSE)
+			{
+				break;
+			}
+
+			copied_size += page_read_size;
+		}
+
+		return copied_size;
+	}
+
+	size_t read_memory_ranges(const MemoryRange* ranges, size_t range_count, void* buffer)
+	{
+		size_t copied_size = 0;
+
+		for (size_t i = 0; i < range_count; i++)
+		{
+			const size_t size = static_cast<size_t>(ranges[i].end_ - ranges[i].begin_);
+
+			const size_t read_size = read_memory(reinterpret_cast<const void*>(ranges[i].begin_), static_cast<char*>(buffer) + copied_size, size);
+
+			copied_size += read_size;
+
+			if (read_size != size)
+			{
+				break;
+			}
+		}
+
+		return copied_size;
+	}
+
+	std::string convert_to_utf8(const tstring& text)
+	{
+#ifdef _UNICODE
+		if (text.empty() == true)
+		{
+			return std::string();
+		}
+
+		const int length = WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.length()), NULL, 0, NULL, NULL);
+
+		std::string result(static_cast<size_t>(length), '\0');
+
+		WideCharToMultiByte(CP_UTF8, 0, text.c_str(), static_cast<int>(text.length()), &result[0], length, NULL, NULL);
+
+		return result;
+#else // _UNICODE
+		return text;
+#endif // _UNICODE
+	}
+
+	tstring convert_from_utf8(const std::string& text)
+	{
+#ifdef _UNICODE
+		if (text.empty() == true)
+		{
+			return tstring();
+		}
+
+		const int length = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), static_cast<int>(text.length()), NULL, 0);
+
+		tstring result(static_cast<size_t>(length), L'\0');
+
+		MultiByteToWideChar(CP_UTF8, 0, text.c_str(), static_cast<int>(text.length()), &result[0], length);
+
+		return result;
+#else // _UNICODE
+		return text;
+#endif // _UNICODE
+	}
+}
+#endif // _WIN32
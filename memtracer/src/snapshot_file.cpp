@@ -0,0 +1,433 @@
+#include "snapshot_file.h"
+
+#include "file_writer.h"
+
+namespace memtracer
+{
+	bool write_snapshot_file(const TCHAR* path, const SnapshotRequest& snapshot_request, const StackTable& stack_table, SymbolCache& symbol_cache)
+	{
+		// each unique frame of live stacks is stored once.
+		std::unordered_map<void*, uint32_t> frame_indices;
+
+		std::vector<void*> frames;
+
+		uint64_t frame_index_count = 0;
+
+		for (const SnapshotStack& snapshot_stack : snapshot_request.snapshot_stacks_)
+		{
+			const StackBackTrace& stack_back_trace = stack_table.get_stack_back_trace(snapshot_stack.stack_id_);
+
+			frame_index_count += stack_back_trace.get_frame_count();
+
+			for (FrameCount i = 0; i < stack_back_trace.get_frame_count(); i++)
+			{
+				void* frame = stack_back_trace.get_stack_frame(i);
+
+				if (frame_indices.emplace(frame, static_cast<uint32_t>(frames.size())).second == true)
+				{
+					frames.push_back(frame);
+
+					symbol_cache.add_frame(frame);
+				}
+			}
+		}
+
+		symbol_cache.resolve_pending_frames();
+
+		std::string string_table;
+
+		std::unordered_map<std::string, uint32_t> string_offsets;
+
+		const auto add_string = [&string_table, &string_offsets](const tstring& text)
+			{
+				std::string utf8_text = convert_to_utf8(text);
+
+				auto iterator = string_offsets.find(utf8_text);
+
+				if (iterator != string_offsets.end())
+				{
+					return iterator->second;
+				}
+
+				const uint32_t offset = static_cast<uint32_t>(string_table.size());
+
+				string_table += utf8_text;
+
+				string_table += '\0';
+
+				string_offsets.emplace(std::move(utf8_text), offset);
+
+				return offset;
+			};
+
+		std::vector<SnapshotFileFrame> file_frames(frames.size());
+
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			SnapshotFileFrame& file_frame = file_frames[i];
+
+			file_frame.address_ = reinterpret_cast<uintptr_t>(frames[i]);
+
+			file_frame.symbol_address_ = 0;
+
+			file_frame.symbol_name_ = SNAPSHOT_FILE_NO_STRING;
+
+			file_frame.file_name_ = SNAPSHOT_FILE_NO_STRING;
+
+			file_frame.line_number_ = 0;
+
+			file_frame.flags_ = 0;
+
+			const FrameSymbol* frame_symbol = symbol_cache.find_frame_symbol(frames[i]);
+
+			if (frame_symbol == nullptr)
+			{
+				continue;
+			}
+
+			file_frame.symbol_address_ = reinterpret_cast<uintptr_t>(frame_symbol->symbol_address_);
+
+			file_frame.symbol_name_ = add_string(frame_symbol->symbol_name_);
+
+			file_frame.flags_ |= SNAPSHOT_FILE_FRAME_HAS_SYMBOL;
+
+			if (frame_symbol->has_line_ == true)
+			{
+				file_frame.file_name_ = add_string(frame_symbol->file_name_);
+
+				file_frame.line_number_ = frame_symbol->line_number_;
+
+				file_frame.flags_ |= SNAPSHOT_FILE_FRAME_HAS_LINE;
+			}
+		}
+
+		SnapshotFileHeader header;
+
+		std::memset(&header, 0, sizeof(SnapshotFileHeader));
+
+		std::memcpy(header.magic_, SNAPSHOT_FILE_MAGIC, sizeof(header.magic_));
+
+		header.version_ = SNAPSHOT_FILE_VERSION;
+
+		header.endian_tag_ = SNAPSHOT_FILE_ENDIAN_TAG;
+
+		header.snapshot_index_ = snapshot_request.snapshot_index_;
+
+		header.snapshot_type_ = static_cast<uint32_t>(snapshot_request.snapshot_type_);
+
+		header.baseline_name_ = SNAPSHOT_FILE_NO_STRING;
+
+		if (snapshot_request.baseline_name_.empty() == false)
+		{
+			header.baseline_name_ = add_string(tstring(snapshot_request.baseline_name_.begin(), snapshot_request.baseline_name_.end()));
+		}
+
+		header.sampling_interval_ = snapshot_request.sampling_interval_;
+
+		header.buffer_policy_ = static_cast<uint32_t>(snapshot_request.buffer_policy_);
+
+		header.trigger_ = static_cast<uint32_t>(snapshot_request.trigger_);
+
+		header.dropped_allocation_count_ = snapshot_request.buffer_statistics_.dropped_allocation_count_;
+
+		header.dropped_free_count_ = snapshot_request.buffer_statistics_.dropped_free_count_;
+
+		header.degraded_allocation_count_ = snapshot_request.buffer_statistics_.degraded_allocation_count_;
+
+		header.overflowed_sample_count_ = snapshot_request.overflowed_sample_count_;
+
+		header.traced_time_ = snapshot_request.traced_time_;
+
+		header.tracer_used_memory_ = snapshot_request.arena_statistics_.used_memory_;
+
+		header.tracer_mapped_memory_ = snapshot_request.arena_statistics_.mapped_memory_;
+
+		header.lifetime_bucket_count_ = LIFETIME_BUCKET_COUNT;
+
+		header.stack_count_ = snapshot_request.snapshot_stacks_.size();
+
+		header.stack_offset_ = sizeof(SnapshotFileHeader);
+
+		header.lifetime_offset_ = header.stack_offset_ + header.stack_count_ * sizeof(SnapshotFileStack);
+
+		header.frame_count_ = file_frames.size();
+
+		header.size_class_count_ = SIZE_CLASS_COUNT;
+
+		header.size_class_offset_ = header.lifetime_offset_ + header.stack_count_ * header.lifetime_bucket_count_ * sizeof(uint64_t);
+
+		header.stack_size_class_offset_ = header.size_class_offset_ + sizeof(SizeClassStatistics);
+
+		header.frame_offset_ = header.stack_size_class_offset_ + header.stack_count_ * sizeof(StackSizeClasses);
+
+		header.frame_index_count_ = frame_index_count;
+
+		header.frame_index_offset_ = header.frame_offset_ + header.frame_count_ * sizeof(SnapshotFileFrame);
+
+		header.string_table_size_ = string_table.size();
+
+		// frame index section is padded to 8 bytes.
+		header.string_table_offset_ = (header.frame_index_offset_ + header.frame_index_count_ * sizeof(uint32_t) + 7) & ~7ull;
+
+		FileWriter file_writer;
+
+		if (file_writer.open(path) == false)
+		{
+			return false;
+		}
+
+		file_writer.write(&header, sizeof(SnapshotFileHeader));
+
+		uint32_t first_frame_index = 0;
+
+		for (const SnapshotStack& snapshot_stack : snapshot_request.snapshot_stacks_)
+		{
+			const FrameCount frame_count = stack_table.get_stack_back_trace(snapshot_stack.stack_id_).get_frame_count();
+
+			const SnapshotFileStack file_stack = {
+				snapshot_stack.stack_statistics_.memory_allocation_
+				, snapshot_stack.stack_statistics_.memory_allocation_count_
+				, snapshot_stack.memory_allocation_delta_
+				, snapshot_stack.memory_allocation_count_delta_
+				, snapshot_stack.stack_lifetime_.total_memory_allocation_
+				, snapshot_stack.stack_lifetime_.total_allocation_count_
+				, first_frame_index
+				, frame_count };
+
+			file_writer.write(&file_stack, sizeof(SnapshotFileStack));
+
+			first_frame_index += frame_count;
+		}
+
+		for (const SnapshotStack& snapshot_stack : snapshot_request.snapshot_stacks_)
+		{
+			file_writer.write(snapshot_stack.stack_lifetime_.lifetime_buckets_, sizeof(snapshot_stack.stack_lifetime_.lifetime_buckets_));
+		}
+
+		static_assert(sizeof(SizeClassStatistics) == SIZE_CLASS_COUNT * 3 * sizeof(uint64_t) && sizeof(StackSizeClasses) == SIZE_CLASS_COUNT * 2 * sizeof(uint64_t), "Size classes are written as the sections.");
+
+		file_writer.write(&snapshot_request.size_class_statistics_, sizeof(SizeClassStatistics));
+
+		for (const SnapshotStack& snapshot_stack : snapshot_request.snapshot_stacks_)
+		{
+			file_writer.write(&snapshot_stack.stack_size_classes_, sizeof(StackSizeClasses));
+		}
+
+		if (file_frames.empty() == false)
+		{
+			file_writer.write(file_frames.data(), file_frames.size() * sizeof(SnapshotFileFrame));
+		}
+
+		for (const SnapshotStack& snapshot_stack : snapshot_request.snapshot_stacks_)
+		{
+			const StackBackTrace& stack_back_trace = stack_table.get_stack_back_trace(snapshot_stack.stack_id_);
+
+			for (FrameCount i = 0; i < stack_back_trace.get_frame_count(); i++)
+			{
+				const uint32_t frame_index = frame_indices[stack_back_trace.get_stack_frame(i)];
+
+				file_writer.write(&frame_index, sizeof(uint32_t));
+			}
+		}
+
+		file_writer.align(8);
+
+		assert(file_writer.get_offset() == header.string_table_offset_);
+
+		file_writer.write(string_table.data(), string_table.size());
+
+		return file_writer.close();
+	}
+
+	SnapshotFile::SnapshotFile() :
+		data_(nullptr)
+		, size_(0)
+	{
+	}
+
+	SnapshotFile::~SnapshotFile()
+	{
+		close();
+	}
+
+	bool SnapshotFile::open(const TCHAR* path)
+	{
+		close();
+
+		data_ = static_cast<const char*>(map_file(path, size_));
+
+		if (data_ == nullptr)
+		{
+			return false;
+		}
+
+		if (validate() == false)
+		{
+			close();
+
+			return false;
+		}
+
+		return true;
+	}
+
+	void SnapshotFile::close()
+	{
+		if (data_ != nullptr)
+		{
+			unmap_file(data_, size_);
+		}
+
+		data_ = nullptr;
+
+		size_ = 0;
+	}
+
+	const SnapshotFileHeader& SnapshotFile::get_header() const
+	{
+		assert(data_ != nullptr);
+
+		return *reinterpret_cast<const SnapshotFileHeader*>(data_);
+	}
+
+	const SnapshotFileStack& SnapshotFile::get_stack(size_t index) const
+	{
+		assert(index < get_header().stack_count_);
+
+		return get_section<SnapshotFileStack>(get_header().stack_offset_)[index];
+	}
+
+	const uint64_t* SnapshotFile::get_stack_lifetime_buckets(size_t index) const
+	{
+		assert(index < get_header().stack_count_);
+
+		return get_section<uint64_t>(get_header().lifetime_offset_) + index * get_header().lifetime_bucket_count_;
+	}
+
+	const uint64_t* SnapshotFile::get_size_classes() const
+	{
+		return get_section<uint64_t>(get_header().size_class_offset_);
+	}
+
+	const uint64_t* SnapshotFile::get_stack_size_classes(size_t index) const
+	{
+		assert(index < get_header().stack_count_);
+
+		return get_section<uint64_t>(get_header().stack_size_class_offset_) + index * get_header().size_class_count_ * 2;
+	}
+
+	const SnapshotFileFrame& SnapshotFile::get_stack_frame(const SnapshotFileStack& stack, size_t index) const
+	{
+		return get_frame(get_stack_frame_index(stack, index));
+	}
+
+	uint32_t SnapshotFile::get_stack_frame_index(const SnapshotFileStack& stack, size_t index) const
+	{
+		assert(index < stack.frame_count_);
+
+		return get_section<uint32_t>(get_header().frame_index_offset_)[stack.first_frame_index_ + index];
+	}
+
+	const SnapshotFileFrame& SnapshotFile::get_frame(size_t index) const
+	{
+		assert(index < get_header().frame_count_);
+
+		return get_section<SnapshotFileFrame>(get_header().frame_offset_)[index];
+	}
+
+	const char* SnapshotFile::get_string(uint32_t offset) const
+	{
+		if (offset == SNAPSHOT_FILE_NO_STRING)
+		{
+			return nullptr;
+		}
+
+		assert(offset < get_header().string_table_size_);
+
+		return get_section<char>(get_header().string_table_offset_) + offset;
+	}
+
+	bool SnapshotFile::validate() const
+	{
+		if (size_ < sizeof(SnapshotFileHeader))
+		{
+			return false;
+		}
+
+		const SnapshotFileHeader& header = get_header();
+
+		if (std::memcmp(header.magic_, SNAPSHOT_FILE_MAGIC, sizeof(header.magic_)) != 0 ||
+			header.version_ != SNAPSHOT_FILE_VERSION ||
+			header.endian_tag_ != SNAPSHOT_FILE_ENDIAN_TAG ||
+			(header.snapshot_type_ != SNAPSHOT_FILE_TYPE_FULL && header.snapshot_type_ != SNAPSHOT_FILE_TYPE_DIFF && header.snapshot_type_ != SNAPSHOT_FILE_TYPE_LEAK) ||
+			header.buffer_policy_ > SNAPSHOT_FILE_BUFFER_POLICY_DEGRADE ||
+			header.trigger_ > SNAPSHOT_FILE_TRIGGER_INTERVAL ||
+			header.lifetime_bucket_count_ == 0 || header.lifetime_bucket_count_ > LIFETIME_BUCKET_COUNT ||
+			header.size_class_count_ == 0 || header.size_class_count_ > SIZE_CLASS_COUNT)
+		{
+			return false;
+		}
+
+		const auto is_in_file = [this](uint64_t offset, uint64_t count, uint64_t element_size)
+			{
+				return offset % 8 == 0 && offset <= size_ && count <= (size_ - offset) / element_size;
+			};
+
+		// bucket and class counts are small, so stack count * them does not overflow after stack section is checked.
+		if (is_in_file(header.stack_offset_, header.stack_count_, sizeof(SnapshotFileStack)) == false ||
+			is_in_file(header.lifetime_offset_, header.stack_count_ * header.lifetime_bucket_count_, sizeof(uint64_t)) == false ||
+			is_in_file(header.size_class_offset_, header.size_class_count_ * 3, sizeof(uint64_t)) == false ||
+			is_in_file(header.stack_size_class_offset_, header.stack_count_ * header.size_class_count_ * 2, sizeof(uint64_t)) == false ||
+			is_in_file(header.frame_offset_, header.frame_count_, sizeof(SnapshotFileFrame)) == false ||
+			is_in_file(header.frame_index_offset_, header.frame_index_count_, sizeof(uint32_t)) == false ||
+			is_in_file(header.string_table_offset_, header.string_table_size_, 1) == false)
+		{
+			return false;
+		}
+
+		for (uint64_t i = 0; i < header.stack_count_; i++)
+		{
+			const SnapshotFileStack& stack = get_stack(i);
+
+			if (static_cast<uint64_t>(stack.first_frame_index_) + stack.frame_count_ > header.frame_index_count_)
+			{
+				return false;
+			}
+		}
+
+		const uint32_t* frame_indices = get_section<uint32_t>(header.frame_index_offset_);
+
+		for (uint64_t i = 0; i < header.frame_index_count_; i++)
+		{
+			if (frame_indices[i] >= header.frame_count_)
+			{
+				return false;
+			}
+		}
+
+		if (header.baseline_name_ != SNAPSHOT_FILE_NO_STRING && header.baseline_name_ >= header.string_table_size_)
+		{
+			return false;
+		}
+
+		for (uint64_t i = 0; i < header.frame_count_; i++)
+		{
+			const SnapshotFileFrame& frame = get_section<SnapshotFileFrame>(header.frame_offset_)[i];
+
+			if ((frame.symbol_name_ != SNAPSHOT_FILE_NO_STRING && frame.symbol_name_ >= header.string_table_size_) ||
+				(frame.file_name_ != SNAPSHOT_FILE_NO_STRING && frame.file_name_ >= header.string_table_size_))
+			{
+				return false;
+			}
+		}
+
+		// every string must end in the table.
+		return header.string_table_size_ == 0 || get_section<char>(header.string_table_offset_)[header.string_table_size_ - 1] == '\0';
+	}
+
+	template <typename T>
+	const T* SnapshotFile::get_section(uint64_t offset) const
+	{
+		return reinterpret_cast<const T*>(data_ + offset);
+	}
+}
@@ -0,0 +1,315 @@
+#include "snapshot_index.h"
+
+namespace memtracer
+{
+	SnapshotIndex::SnapshotIndex() :
+		snapshot_file_(nullptr)
+		, functions_()
+		, frame_functions_()
+		, stack_offsets_()
+		, stack_indices_()
+	{
+	}
+
+	SnapshotIndex::~SnapshotIndex()
+	{
+	}
+
+	void SnapshotIndex::build(const SnapshotFile& snapshot_file)
+	{
+		snapshot_file_ = &snapshot_file;
+
+		functions_.clear();
+
+		const SnapshotFileHeader& header = snapshot_file.get_header();
+
+		frame_functions_.resize(static_cast<size_t>(header.frame_count_));
+
+		// return addresses of one function are one entry.
+		std::unordered_map<uint64_t, uint32_t> function_indices;
+
+		for (size_t i = 0; i < frame_functions_.size(); i++)
+		{
+			const SnapshotFileFrame& frame = snapshot_file.get_frame(i);
+
+			const bool has_symbol = (frame.flags_ & SNAPSHOT_FILE_FRAME_HAS_SYMBOL) != 0;
+
+			const uint64_t address = has_symbol == true ? frame.symbol_address_ : frame.address_;
+
+			auto pair = function_indices.emplace(address, static_cast<uint32_t>(functions_.size()));
+
+			if (pair.second == true)
+			{
+				functions_.push_back({ address
+					, has_symbol == true ? frame.symbol_name_ : SNAPSHOT_FILE_NO_STRING
+					, (frame.flags_ & SNAPSHOT_FILE_FRAME_HAS_LINE) != 0 ? frame.file_name_ : SNAPSHOT_FILE_NO_STRING });
+			}
+
+			frame_functions_[i] = pair.first->second;
+		}
+
+		// counting pass then filling pass. last_stacks dedupes a function which appears twice in a stack.
+		const uint32_t no_stack = 0xFFFFFFFFu;
+
+		std::vector<uint32_t> last_stacks(functions_.size(), no_stack);
+
+		stack_offsets_.assign(functions_.size() + 1, 0);
+
+		for (uint32_t stack_index = 0; stack_index < header.stack_count_; stack_index++)
+		{
+			const SnapshotFileStack& stack = snapshot_file.get_stack(stack_index);
+
+			for (size_t i = 0; i < stack.frame_count_; i++)
+			{
+				const uint32_t function = frame_functions_[snapshot_file.get_stack_frame_index(stack, i)];
+
+				if (last_stacks[function] != stack_index)
+				{
+					last_stacks[function] = stack_index;
+
+					stack_offsets_[function + 1]++;
+				}
+			}
+		}
+
+		for (size_t i = 1; i < stack_offsets_.size(); i++)
+		{
+			stack_offsets_[i] += stack_offsets_[i - 1];
+		}
+
+		stack_indices_.resize(stack_offsets_.back());
+
+		std::vector<uint32_t> write_offsets(stack_offsets_.begin(), stack_offsets_.end() - 1);
+
+		std::fill(last_stacks.begin(), last_stacks.end(), no_stack);
+
+		for (uint32_t stack_index = 0; stack_index < header.stack_count_; stack_index++)
+		{
+			const SnapshotFileStack& stack = snapshot_file.get_stack(stack_index);
+
+			for (size_t i = 0; i < stack.frame_count_; i++)
+			{
+				const uint32_t function = frame_functions_[snapshot_file.get_stack_frame_index(stack, i)];
+
+				if (last_stacks[function] != stack_index)
+				{
+					last_stacks[function] = stack_index;
+
+					stack_indices_[write_offsets[function]++] = stack_index;
+				}
+			}
+		}
+	}
+
+	size_t SnapshotIndex::get_function_count() const
+	{
+		return functions_.size();
+	}
+
+	const SnapshotIndex::Function& SnapshotIndex::get_function(uint32_t index) const
+	{
+		assert(index < functions_.size());
+
+		return functions_[index];
+	}
+
+	std::string SnapshotIndex::get_function_name(uint32_t index) const
+	{
+		const Function& function = get_function(index);
+
+		if (function.name_ != SNAPSHOT_FILE_NO_STRING)
+		{
+			return snapshot_file_->get_string(function.name_);
+		}
+
+		char buffer[32] = { 0 };
+
+		std::snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(function.address_));
+
+		return buffer;
+	}
+
+	std::vector<uint32_t> SnapshotIndex::find_functions(const std::string& pattern, bool is_file_name_matched) const
+	{
+		std::vector<uint32_t> functions;
+
+		for (uint32_t i = 0; i < functions_.size(); i++)
+		{
+			const Function& function = functions_[i];
+
+			// symbol names are matched in place. only unresolved addresses are formatted.
+			const bool is_name_matched = function.name_ != SNAPSHOT_FILE_NO_STRING ?
+				std::strstr(snapshot_file_->get_string(function.name_), pattern.c_str()) != nullptr :
+				get_function_name(i).find(pattern) != std::string::npos;
+
+			if (is_name_matched == true ||
+				(is_file_name_matched == true && function.file_name_ != SNAPSHOT_FILE_NO_STRING && std::strstr(snapshot_file_->get_string(function.file_name_), pattern.c_str()) != nullptr))
+			{
+				functions.push_back(i);
+			}
+		}
+
+		return functions;
+	}
+
+	SnapshotIndex::FunctionStatistics SnapshotIndex::get_beneath(const std::vector<uint32_t>& functions) const
+	{
+		FunctionStatistics beneath = { 0, 0, 0 };
+
+		std::vector<bool> is_stack_counted(static_cast<size_t>(snapshot_file_->get_header().stack_count_), false);
+
+		for (uint32_t function : functions)
+		{
+			for (const uint32_t* stack_index = get_stacks_begin(function); stack_index != get_stacks_end(function); stack_index++)
+			{
+				if (is_stack_counted[*stack_index] == true)
+				{
+					continue;
+				}
+
+				is_stack_counted[*stack_index] = true;
+
+				const SnapshotFileStack& stack = snapshot_file_->get_stack(*stack_index);
+
+				beneath.memory_allocation_ += stack.memory_allocation_;
+
+				beneath.memory_allocation_count_ += stack.memory_allocation_count_;
+			}
+		}
+
+		return beneath;
+	}
+
+	std::vector<SnapshotIndex::FunctionStatistics> SnapshotIndex::get_top_functions(const std::vector<uint32_t>& functions, size_t count) const
+	{
+		std::vector<FunctionStatistics> function_statistics;
+
+		function_statistics.reserve(functions.size());
+
+		for (uint32_t function : functions)
+		{
+			FunctionStatistics statistics = { function, 0, 0 };
+
+			for (const uint32_t* stack_index = get_stacks_begin(function); stack_index != get_stacks_end(function); stack_index++)
+			{
+				const SnapshotFileStack& stack = snapshot_file_->get_stack(*stack_index);
+
+				statistics.memory_allocation_ += stack.memory_allocation_;
+
+				statistics.memory_allocation_count_ += stack.memory_allocation_count_;
+			}
+
+			function_statistics.push_back(statistics);
+		}
+
+		sort_and_truncate(function_statistics, count);
+
+		return function_statistics;
+	}
+
+	std::vector<SnapshotIndex::FunctionStatistics> SnapshotIndex::get_neighbors(const std::vector<uint32_t>& functions, bool is_caller, size_t count) const
+	{
+		std::vector<bool> is_queried(functions_.size(), false);
+
+		for (uint32_t function : functions)
+		{
+			is_queried[function] = true;
+		}
+
+		std::vector<bool> is_stack_counted(static_cast<size_t>(snapshot_file_->get_header().stack_count_), false);
+
+		std::unordered_map<uint32_t, FunctionStatistics> neighbors;
+
+		// neighbors found in current stack. a neighbor is counted once per stack.
+		std::vector<uint32_t> stack_neighbors;
+
+		for (uint32_t function : functions)
+		{
+			for (const uint32_t* stack_index = get_stacks_begin(function); stack_index != get_stacks_end(function); stack_index++)
+			{
+				if (is_stack_counted[*stack_index] == true)
+				{
+					continue;
+				}
+
+				is_stack_counted[*stack_index] = true;
+
+				const SnapshotFileStack& stack = snapshot_file_->get_stack(*stack_index);
+
+				stack_neighbors.clear();
+
+				// frames are innermost first. caller of frame i is frame i + 1.
+				for (size_t i = 0; i < stack.frame_count_; i++)
+				{
+					if (is_queried[frame_functions_[snapshot_file_->get_stack_frame_index(stack, i)]] == false)
+					{
+						continue;
+					}
+
+					if ((is_caller == true && i + 1 == stack.frame_count_) || (is_caller == false && i == 0))
+					{
+						continue;
+					}
+
+					const uint32_t neighbor = frame_functions_[snapshot_file_->get_stack_frame_index(stack, is_caller == true ? i + 1 : i - 1)];
+
+					if (is_queried[neighbor] == false && std::find(stack_neighbors.begin(), stack_neighbors.end(), neighbor) == stack_neighbors.end())
+					{
+						stack_neighbors.push_back(neighbor);
+					}
+				}
+
+				for (uint32_t neighbor : stack_neighbors)
+				{
+					FunctionStatistics& statistics = neighbors.emplace(neighbor, FunctionStatistics{ neighbor, 0, 0 }).first->second;
+
+					statistics.memory_allocation_ += stack.memory_allocation_;
+
+					statistics.memory_allocation_count_ += stack.memory_allocation_count_;
+				}
+			}
+		}
+
+		std::vector<FunctionStatistics> function_statistics;
+
+		function_statistics.reserve(neighbors.size());
+
+		for (const auto& pair : neighbors)
+		{
+			function_statistics.push_back(pair.second);
+		}
+
+		sort_and_truncate(function_statistics, count);
+
+		return function_statistics;
+	}
+
+	const uint32_t* SnapshotIndex::get_stacks_begin(uint32_t function) const
+	{
+		return stack_indices_.data() + stack_offsets_[function];
+	}
+
+	const uint32_t* SnapshotIndex::get_stacks_end(uint32_t function) const
+	{
+		return stack_indices_.data() + stack_offsets_[function + 1];
+	}
+
+	void SnapshotIndex::sort_and_truncate(std::vector<FunctionStatistics>& function_statistics, size_t count)
+	{
+		const auto more_memory = [](const FunctionStatistics& first, const FunctionStatistics& second)
+			{
+				return first.memory_allocation_ != second.memory_allocation_ ? first.memory_allocation_ > second.memory_allocation_ : first.function_ < second.function_;
+			};
+
+		if (function_statistics.size() > count)
+		{
+			std::partial_sort(function_statistics.begin(), function_statistics.begin() + count, function_statistics.end(), more_memory);
+
+			function_statistics.resize(count);
+		}
+		else
+		{
+			std::sort(function_statistics.begin(), function_statistics.end(), more_memory);
+		}
+	}
+}
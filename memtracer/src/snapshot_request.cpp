@@ -0,0 +1,157 @@
+#include "snapshot_request.h"
+
+#include "allocation_sampler.h"
+#include "memory_tracer_allocation.h"
+
+namespace memtracer
+{
+	// shared state of promise is allocated by user thread. it must not be traced.
+	SnapshotRequest::SnapshotRequest() :
+		promise_(std::allocator_arg, MemoryTracerAllocator<bool>())
+		, snapshot_type_(ESnapshotType::Full)
+		, trigger_(ESnapshotTrigger::None)
+		, baseline_name_()
+		, snapshot_index_(0)
+		, sampling_interval_(0)
+		, buffer_policy_(EBufferPolicy::Block)
+		, buffer_statistics_()
+		, overflowed_sample_count_(0)
+		, arena_statistics_()
+		, traced_time_(0)
+		, size_class_statistics_()
+		, pending_shard_count_(0)
+		, is_valid_(true)
+		, is_leak_scanned_(false)
+		, leak_blocks_()
+		, unreachable_blocks_()
+		, leaked_blocks_()
+		, young_blocks_()
+		, snapshot_stacks_()
+	{
+	}
+
+	SnapshotRequest::~SnapshotRequest()
+	{
+	}
+
+	void* SnapshotRequest::operator new(size_t size)
+	{
+		return memtracer_alloc(size);
+	}
+
+	void SnapshotRequest::operator delete(void* p)
+	{
+		memtracer_free(p);
+	}
+
+	void SnapshotRequest::merge_snapshot_stacks()
+	{
+		std::sort(snapshot_stacks_.begin(), snapshot_stacks_.end(), [](const SnapshotStack& first, const SnapshotStack& second)
+			{
+				return first.stack_id_ < second.stack_id_;
+			});
+
+		size_t merged_count = 0;
+
+		for (size_t i = 0; i < snapshot_stacks_.size(); i++)
+		{
+			const SnapshotStack& snapshot_stack = snapshot_stacks_[i];
+
+			if (merged_count != 0 && snapshot_stacks_[merged_count - 1].stack_id_ == snapshot_stack.stack_id_)
+			{
+				SnapshotStack& merged_stack = snapshot_stacks_[merged_count - 1];
+
+				merged_stack.stack_statistics_.memory_allocation_ += snapshot_stack.stack_statistics_.memory_allocation_;
+
+				merged_stack.stack_statistics_.memory_allocation_count_ += snapshot_stack.stack_statistics_.memory_allocation_count_;
+
+				merged_stack.memory_allocation_delta_ += snapshot_stack.memory_allocation_delta_;
+
+				merged_stack.memory_allocation_count_delta_ += snapshot_stack.memory_allocation_count_delta_;
+
+				merged_stack.stack_lifetime_.total_memory_allocation_ += snapshot_stack.stack_lifetime_.total_memory_allocation_;
+
+				merged_stack.stack_lifetime_.total_allocation_count_ += snapshot_stack.stack_lifetime_.total_allocation_count_;
+
+				for (unsigned int bucket = 0; bucket < LIFETIME_BUCKET_COUNT; bucket++)
+				{
+					merged_stack.stack_lifetime_.lifetime_buckets_[bucket] += snapshot_stack.stack_lifetime_.lifetime_buckets_[bucket];
+				}
+
+				for (unsigned int size_class = 0; size_class < SIZE_CLASS_COUNT; size_class++)
+				{
+					merged_stack.stack_size_classes_.live_counts_[size_class] += snapshot_stack.stack_size_classes_.live_counts_[size_class];
+
+					merged_stack.stack_size_classes_.total_counts_[size_class] += snapshot_stack.stack_size_classes_.total_counts_[size_class];
+				}
+			}
+			else
+			{
+				snapshot_stacks_[merged_count++] = snapshot_stack;
+			}
+		}
+
+		snapshot_stacks_.resize(merged_count);
+
+		if (sampling_interval_ != 0)
+		{
+			round_estimates();
+		}
+
+		if (snapshot_type_ == ESnapshotType::Diff)
+		{
+			auto end = std::remove_if(snapshot_stacks_.begin(), snapshot_stacks_.end(), [](const SnapshotStack& snapshot_stack)
+				{
+					return snapshot_stack.memory_allocation_delta_ == 0 && snapshot_stack.memory_allocation_count_delta_ == 0;
+				});
+
+			snapshot_stacks_.erase(end, snapshot_stacks_.end());
+		}
+	}
+
+	void SnapshotRequest::add_size_class_statistics(const SizeClassStatistics& size_class_statistics)
+	{
+		for (unsigned int size_class = 0; size_class < SIZE_CLASS_COUNT; size_class++)
+		{
+			size_class_statistics_.live_memory_allocations_[size_class] += size_class_statistics.live_memory_allocations_[size_class];
+
+			size_class_statistics_.live_counts_[size_class] += size_class_statistics.live_counts_[size_class];
+
+			size_class_statistics_.total_counts_[size_class] += size_class_statistics.total_counts_[size_class];
+		}
+	}
+
+	void SnapshotRequest::round_estimates()
+	{
+		for (SnapshotStack& snapshot_stack : snapshot_stacks_)
+		{
+			snapshot_stack.stack_statistics_.memory_allocation_ = round_estimate(snapshot_stack.stack_statistics_.memory_allocation_);
+
+			snapshot_stack.stack_statistics_.memory_allocation_count_ = round_estimate(snapshot_stack.stack_statistics_.memory_allocation_count_);
+
+			snapshot_stack.memory_allocation_delta_ = round_estimate_delta(snapshot_stack.memory_allocation_delta_);
+
+			snapshot_stack.memory_allocation_count_delta_ = round_estimate_delta(snapshot_stack.memory_allocation_count_delta_);
+
+			snapshot_stack.stack_lifetime_.total_memory_allocation_ = round_estimate(snapshot_stack.stack_lifetime_.total_memory_allocation_);
+
+			snapshot_stack.stack_lifetime_.total_allocation_count_ = round_estimate(snapshot_stack.stack_lifetime_.total_allocation_count_);
+
+			for (unsigned int size_class = 0; size_class < SIZE_CLASS_COUNT; size_class++)
+			{
+				snapshot_stack.stack_size_classes_.live_counts_[size_class] = round_estimate(snapshot_stack.stack_size_classes_.live_counts_[size_class]);
+
+				snapshot_stack.stack_size_classes_.total_counts_[size_class] = round_estimate(snapshot_stack.stack_size_classes_.total_counts_[size_class]);
+			}
+		}
+
+		for (unsigned int size_class = 0; size_class < SIZE_CLASS_COUNT; size_class++)
+		{
+			size_class_statistics_.live_memory_allocations_[size_class] = round_estimate(size_class_statistics_.live_memory_allocations_[size_class]);
+
+			size_class_statistics_.live_counts_[size_class] = round_estimate(size_class_statistics_.live_counts_[size_class]);
+
+			size_class_statistics_.total_counts_[size_class] = round_estimate(size_class_statistics_.total_counts_[size_class]);
+		}
+	}
+}
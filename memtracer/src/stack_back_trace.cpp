@@ -3,17 +3,19 @@
 #include <cassert>
 
 #include "memory_tracer_allocation.h"
+#include "platform.h"
 
 namespace memtracer
 {
-	StackBackTrace::StackBackTrace()
+	StackBackTrace::StackBackTrace() :
+		frame_count_(0)
+		, call_stack_hash_(0)
 	{
-		frame_count_ = CaptureStackBackTrace(FRAMES_TO_SKIP, MAX_STACK_FRAMES, stack_frames, &call_stack_hash_);
 	}
 
 	StackBackTrace::~StackBackTrace()
 	{
-		ZeroMemory(stack_frames, sizeof(size_t) * MAX_STACK_FRAMES);
+		std::memset(stack_frames, 0, sizeof(void*) * MAX_STACK_FRAMES);
 
 		frame_count_ = 0;
 
@@ -40,6 +42,72 @@ namespace memtracer
 		memtracer_free(p);
 	}
 
+	void StackBackTrace::capture(unsigned int frames_to_skip, unsigned int max_frames, unsigned int hash_bits)
+	{
+		assert(max_frames <= MAX_STACK_FRAMES);
+
+		frame_count_ = capture_stack_frames(frames_to_skip, max_frames, stack_frames);
+
+		update_call_stack_hash(hash_bits);
+	}
+
+	void StackBackTrace::assign(void* const* frames, FrameCount frame_count, unsigned int hash_bits)
+	{
+		assert(frame_count <= MAX_STACK_FRAMES);
+
+		std::copy(frames, frames + frame_count, stack_frames);
+
+		frame_count_ = frame_count;
+
+		update_call_stack_hash(hash_bits);
+	}
+
+	void StackBackTrace::update_call_stack_hash(unsigned int hash_bits)
+	{
+		if (hash_bits == 32)
+		{
+			// fnv-1a of 32 bit words. StackTable spreads it to 64 bits.
+			uint32_t hash = 0x811c9dc5u;
+
+			for (FrameCount i = 0; i < frame_count_; i++)
+			{
+				const uint64_t address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(stack_frames[i]));
+
+				hash ^= static_cast<uint32_t>(address ^ (address >> 32));
+
+				hash *= 0x01000193u;
+			}
+
+			call_stack_hash_ = hash;
+
+			return;
+		}
+
+		// 64 bit hash. CaptureStackBackTrace's 32 bit hash merged different call stacks.
+		CallStackHash hash = 0xcbf29ce484222325ull;
+
+		for (FrameCount i = 0; i < frame_count_; i++)
+		{
+			hash ^= reinterpret_cast<CallStackHash>(stack_frames[i]);
+
+			hash *= 0x100000001b3ull;
+
+			hash ^= hash >> 29;
+		}
+
+		call_stack_hash_ = hash;
+	}
+
+	bool StackBackTrace::operator==(const StackBackTrace& other) const
+	{
+		if (frame_count_ != other.frame_count_)
+		{
+			return false;
+		}
+
+		return std::equal(stack_frames, stack_frames + frame_count_, other.stack_frames);
+	}
+
 	CallStackHash StackBackTrace::get_call_stack_hash() const
 	{
 		return call_stack_hash_;
@@ -0,0 +1,144 @@
+#include "stack_table.h"
+
+#include <cassert>
+#include <new>
+
+#include "memory_tracer_allocation.h"
+
+namespace memtracer
+{
+	StackTable::StackTable() :
+		slots_(static_cast<std::atomic<unsigned long long>*>(memtracer_alloc(sizeof(std::atomic<unsigned long long>) * SLOT_COUNT)))
+		, chunks_()
+		, next_stack_id_(OVERFLOW_STACK_ID + 1)
+	{
+		for (size_t i = 0; i < SLOT_COUNT; i++)
+		{
+			new (&slots_[i]) std::atomic<unsigned long long>(0);
+		}
+
+		for (std::atomic<StackBackTrace*>& chunk : chunks_)
+		{
+			chunk.store(nullptr, std::memory_order_relaxed);
+		}
+
+		// overflow stack lives in first chunk with zero frames.
+		StackBackTrace* first_chunk = new StackBackTrace[CHUNK_SIZE];
+
+		chunks_[0].store(first_chunk, std::memory_order_release);
+	}
+
+	StackTable::~StackTable()
+	{
+		for (std::atomic<StackBackTrace*>& chunk : chunks_)
+		{
+			delete[] chunk.load(std::memory_order_acquire);
+		}
+
+		memtracer_free(slots_);
+	}
+
+	StackId StackTable::intern(const StackBackTrace& stack_back_trace)
+	{
+		// multiplying keeps 64 bit hashes distinct and spreads 32 bit hashes to tag bits.
+		const CallStackHash hash = stack_back_trace.get_call_stack_hash() * 0x9E3779B97F4A7C15ull;
+
+		// never 0, so occupied slot is never 0.
+		const unsigned long long tag = ((hash >> 32) | 1ull) << 32;
+
+		size_t index = static_cast<size_t>(hash) & SLOT_MASK;
+
+		for (size_t probe = 0; probe < SLOT_COUNT; probe++, index = (index + 1) & SLOT_MASK)
+		{
+			std::atomic<unsigned long long>& slot = slots_[index];
+
+			unsigned long long value = slot.load(std::memory_order_acquire);
+
+			if (value == 0)
+			{
+				if (slot.compare_exchange_strong(value, tag | PENDING_STACK_ID, std::memory_order_acq_rel) == true)
+				{
+					const StackId stack_id = append(stack_back_trace);
+
+					slot.store(tag | stack_id, std::memory_order_release);
+
+					return stack_id;
+				}
+
+				// other thread took this slot. value is its content now.
+			}
+
+			if ((value & 0xFFFFFFFF00000000ull) == tag)
+			{
+				const StackId stack_id = wait_stack_id(slot);
+
+				// same tag, but can be different frames.
+				if (stack_id == OVERFLOW_STACK_ID || get_stack_back_trace(stack_id) == stack_back_trace)
+				{
+					return stack_id;
+				}
+			}
+		}
+
+		return OVERFLOW_STACK_ID;
+	}
+
+	const StackBackTrace& StackTable::get_stack_back_trace(StackId stack_id) const
+	{
+		assert(stack_id < get_stack_count());
+
+		return chunks_[stack_id / CHUNK_SIZE].load(std::memory_order_acquire)[stack_id % CHUNK_SIZE];
+	}
+
+	StackId StackTable::get_stack_count() const
+	{
+		return (std::min)(next_stack_id_.load(std::memory_order_acquire), MAX_CALL_STACKS);
+	}
+
+	StackId StackTable::append(const StackBackTrace& stack_back_trace)
+	{
+		const StackId stack_id = next_stack_id_.fetch_add(1, std::memory_order_relaxed);
+
+		if (stack_id >= MAX_CALL_STACKS)
+		{
+			return OVERFLOW_STACK_ID;
+		}
+
+		std::atomic<StackBackTrace*>& chunk = chunks_[stack_id / CHUNK_SIZE];
+
+		StackBackTrace* stacks = chunk.load(std::memory_order_acquire);
+
+		if (stacks == nullptr)
+		{
+			StackBackTrace* new_stacks = new StackBackTrace[CHUNK_SIZE];
+
+			if (chunk.compare_exchange_strong(stacks, new_stacks, std::memory_order_acq_rel) == true)
+			{
+				stacks = new_stacks;
+			}
+			else
+			{
+				delete[] new_stacks;
+			}
+		}
+
+		stacks[stack_id % CHUNK_SIZE] = stack_back_trace;
+
+		return stack_id;
+	}
+
+	StackId StackTable::wait_stack_id(std::atomic<unsigned long long>& slot) const
+	{
+		StackId stack_id = static_cast<StackId>(slot.load(std::memory_order_acquire));
+
+		// owner is appending the stack.
+		while (stack_id == PENDING_STACK_ID)
+		{
+			std::this_thread::yield();
+
+			stack_id = static_cast<StackId>(slot.load(std::memory_order_acquire));
+		}
+
+		return stack_id;
+	}
+}
@@ -0,0 +1,76 @@
+#include "symbol_cache.h"
+
+#include <cassert>
+
+namespace memtracer
+{
+	SymbolCache::SymbolCache() :
+		frame_symbols_()
+		, pending_frames_()
+	{
+	}
+
+	SymbolCache::~SymbolCache()
+	{
+	}
+
+	void SymbolCache::add_frame(void* frame)
+	{
+		if (frame_symbols_.find(frame) != frame_symbols_.end())
+		{
+			return;
+		}
+
+		pending_frames_.push_back(frame);
+	}
+
+	void SymbolCache::resolve_pending_frames()
+	{
+		// same frames (main, thread entry, ...) are shared by most stacks.
+		std::sort(pending_frames_.begin(), pending_frames_.end());
+
+		auto end = std::unique(pending_frames_.begin(), pending_frames_.end());
+
+		frame_symbols_.reserve(frame_symbols_.size() + static_cast<size_t>(end - pending_frames_.begin()));
+
+		for (auto iterator = pending_frames_.begin(); iterator != end; ++iterator)
+		{
+			CachedFrameSymbol& cached_frame_symbol = frame_symbols_[*iterator];
+
+			cached_frame_symbol.is_resolved_ = resolve_frame_symbol(*iterator, cached_frame_symbol.frame_symbol_);
+		}
+
+		pending_frames_.clear();
+	}
+
+	void SymbolCache::add_frame_symbol(void* frame, const FrameSymbol* frame_symbol)
+	{
+		CachedFrameSymbol& cached_frame_symbol = frame_symbols_[frame];
+
+		cached_frame_symbol.is_resolved_ = frame_symbol != nullptr;
+
+		if (frame_symbol != nullptr)
+		{
+			cached_frame_symbol.frame_symbol_ = *frame_symbol;
+		}
+	}
+
+	const FrameSymbol* SymbolCache::find_frame_symbol(void* frame) const
+	{
+		auto iterator = frame_symbols_.find(frame);
+
+		assert(iterator != frame_symbols_.end());
+
+		if (iterator == frame_symbols_.end() || iterator->second.is_resolved_ == false)
+		{
+			return nullptr;
+		}
+
+		return &iterator->second.frame_symbol_;
+	}
+
+	size_t SymbolCache::get_count() const
+	{
+		return frame_symbols_.size();
+	}
+}
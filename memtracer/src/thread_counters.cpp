@@ -0,0 +1,152 @@
+#include "thread_counters.h"
+
+#include "memory_tracer_allocation.h"
+
+namespace memtracer
+{
+	ThreadCounters::ThreadCounters() :
+		memory_allocation_(0)
+		, memory_allocation_count_(0)
+		, freed_memory_allocation_(0)
+		, free_count_(0)
+		, is_used_(true)
+		, stack_low_(0)
+		, stack_high_(0)
+		, next_(nullptr)
+	{
+	}
+
+	ThreadCounters::~ThreadCounters()
+	{
+	}
+
+	void* ThreadCounters::operator new(size_t size)
+	{
+		return memtracer_alloc(size);
+	}
+
+	void ThreadCounters::operator delete(void* block)
+	{
+		memtracer_free(block);
+	}
+
+	ThreadCounterList::ThreadCounterList() :
+		head_(nullptr)
+		, shared_counters_()
+	{
+	}
+
+	ThreadCounterList::~ThreadCounterList()
+	{
+		ThreadCounters* thread_counters = head_.load(std::memory_order_acquire);
+
+		while (thread_counters != nullptr)
+		{
+			ThreadCounters* next = thread_counters->next_;
+
+			delete thread_counters;
+
+			thread_counters = next;
+		}
+	}
+
+	ThreadCounters* ThreadCounterList::acquire()
+	{
+		uintptr_t stack_low = 0;
+
+		uintptr_t stack_high = 0;
+
+		get_thread_stack(stack_low, stack_high);
+
+		// values of a reused slot stay in the sums, so new thread keeps adding to them.
+		for (ThreadCounters* thread_counters = head_.load(std::memory_order_acquire); thread_counters != nullptr; thread_counters = thread_counters->next_)
+		{
+			bool is_used = false;
+
+			if (thread_counters->is_used_.load(std::memory_order_relaxed) == false &&
+				thread_counters->is_used_.compare_exchange_strong(is_used, true, std::memory_order_acquire) == true)
+			{
+				thread_counters->stack_low_.store(stack_low, std::memory_order_relaxed);
+
+				thread_counters->stack_high_.store(stack_high, std::memory_order_relaxed);
+
+				return thread_counters;
+			}
+		}
+
+		ThreadCounters* thread_counters = new ThreadCounters();
+
+		thread_counters->stack_low_.store(stack_low, std::memory_order_relaxed);
+
+		thread_counters->stack_high_.store(stack_high, std::memory_order_relaxed);
+
+		ThreadCounters* head = head_.load(std::memory_order_relaxed);
+
+		do
+		{
+			thread_counters->next_ = head;
+		} while (head_.compare_exchange_weak(head, thread_counters, std::memory_order_release, std::memory_order_relaxed) == false);
+
+		return thread_counters;
+	}
+
+	void ThreadCounterList::release(ThreadCounters* thread_counters)
+	{
+		thread_counters->stack_low_.store(0, std::memory_order_relaxed);
+
+		thread_counters->stack_high_.store(0, std::memory_order_relaxed);
+
+		// pairs with acquire of next owner. it sees the last values of this thread.
+		thread_counters->is_used_.store(false, std::memory_order_release);
+	}
+
+	void ThreadCounterList::add_shared(bool is_free, size_t memory_allocation, size_t memory_allocation_count)
+	{
+		(is_free == true ? shared_counters_.freed_memory_allocation_ : shared_counters_.memory_allocation_).fetch_add(memory_allocation, std::memory_order_relaxed);
+
+		(is_free == true ? shared_counters_.free_count_ : shared_counters_.memory_allocation_count_).fetch_add(memory_allocation_count, std::memory_order_relaxed);
+	}
+
+	void ThreadCounterList::get_sums(size_t& memory_allocation, size_t& memory_allocation_count, size_t& freed_memory_allocation, size_t& free_count) const
+	{
+		// frees first. a sized free is counted after its allocation, so allocated bytes read later are not less than freed bytes.
+		freed_memory_allocation = shared_counters_.freed_memory_allocation_.load(std::memory_order_relaxed);
+
+		free_count = shared_counters_.free_count_.load(std::memory_order_relaxed);
+
+		for (ThreadCounters* thread_counters = head_.load(std::memory_order_acquire); thread_counters != nullptr; thread_counters = thread_counters->next_)
+		{
+			freed_memory_allocation += thread_counters->freed_memory_allocation_.load(std::memory_order_relaxed);
+
+			free_count += thread_counters->free_count_.load(std::memory_order_relaxed);
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		memory_allocation = shared_counters_.memory_allocation_.load(std::memory_order_relaxed);
+
+		memory_allocation_count = shared_counters_.memory_allocation_count_.load(std::memory_order_relaxed);
+
+		for (ThreadCounters* thread_counters = head_.load(std::memory_order_acquire); thread_counters != nullptr; thread_counters = thread_counters->next_)
+		{
+			memory_allocation += thread_counters->memory_allocation_.load(std::memory_order_relaxed);
+
+			memory_allocation_count += thread_counters->memory_allocation_count_.load(std::memory_order_relaxed);
+		}
+	}
+
+	void ThreadCounterList::get_thread_stacks(MemoryRangeList& thread_stacks) const
+	{
+		for (ThreadCounters* thread_counters = head_.load(std::memory_order_acquire); thread_counters != nullptr; thread_counters = thread_counters->next_)
+		{
+			const uintptr_t stack_low = thread_counters->stack_low_.load(std::memory_order_relaxed);
+
+			const uintptr_t stack_high = thread_counters->stack_high_.load(std::memory_order_relaxed);
+
+			if (thread_counters->is_used_.load(std::memory_order_relaxed) == true && stack_low < stack_high)
+			{
+				thread_stacks.push_back(MemoryRange{ stack_low, stack_high });
+			}
+		}
+	}
+}
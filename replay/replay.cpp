@@ -0,0 +1,485 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../memtracer/include/allocation_sampler.h"
+#include "../memtracer/include/event_log_file.h"
+#include "../memtracer/include/file_writer.h"
+#include "../memtracer/include/snapshot_file.h"
+#include "../memtracer/include/snapshot_request.h"
+
+namespace
+{
+    struct LiveBlock
+    {
+        uint64_t size_;
+
+        uint32_t stack_id_;
+
+        // ns since start of trace.
+        uint64_t timestamp_;
+    };
+
+    // tracer state rebuilt from events. stacks are indexed by recorded stack id.
+    struct ReplayState
+    {
+        std::unordered_map<uint64_t, LiveBlock> live_blocks_;
+
+        std::vector<memtracer::StackStatistics> stack_statistics_;
+
+        std::vector<memtracer::StackLifetime> stack_lifetimes_;
+
+        std::vector<memtracer::StackSizeClasses> stack_size_classes_;
+
+        memtracer::SizeClassStatistics size_class_statistics_;
+
+        size_t memory_allocation_;
+
+        size_t peak_memory_allocation_;
+
+        uint64_t applied_event_count_;
+    };
+
+    // same estimates as tracer threads add when sampling is enabled.
+    void add_block(ReplayState& state, const memtracer::AllocationSampler& allocation_sampler, uint64_t address, uint64_t size, uint32_t stack_id, uint64_t timestamp)
+    {
+        const size_t block_size = static_cast<size_t>(size);
+
+        const bool is_sampled = allocation_sampler.is_enabled();
+
+        const size_t estimated_size = is_sampled == true ? allocation_sampler.get_estimated_size(block_size) : block_size;
+
+        const size_t estimated_count = is_sampled == true ? allocation_sampler.get_estimated_count(block_size) : 1;
+
+        if (stack_id >= state.stack_statistics_.size())
+        {
+            state.stack_statistics_.resize(static_cast<size_t>(stack_id) + 1, memtracer::StackStatistics{});
+
+            state.stack_lifetimes_.resize(state.stack_statistics_.size(), memtracer::StackLifetime{});
+
+            state.stack_size_classes_.resize(state.stack_statistics_.size(), memtracer::StackSizeClasses{});
+        }
+
+        state.stack_statistics_[stack_id].memory_allocation_ += estimated_size;
+
+        state.stack_statistics_[stack_id].memory_allocation_count_ += estimated_count;
+
+        state.stack_lifetimes_[stack_id].total_memory_allocation_ += estimated_size;
+
+        state.stack_lifetimes_[stack_id].total_allocation_count_ += estimated_count;
+
+        const unsigned int size_class = memtracer::get_size_class(block_size);
+
+        state.stack_size_classes_[stack_id].live_counts_[size_class] += estimated_count;
+
+        state.stack_size_classes_[stack_id].total_counts_[size_class] += estimated_count;
+
+        state.size_class_statistics_.live_memory_allocations_[size_class] += estimated_size;
+
+        state.size_class_statistics_.live_counts_[size_class] += estimated_count;
+
+        state.size_class_statistics_.total_counts_[size_class] += estimated_count;
+
+        state.memory_allocation_ += estimated_size;
+
+        state.peak_memory_allocation_ = (std::max)(state.peak_memory_allocation_, state.memory_allocation_);
+
+        state.live_blocks_[address] = LiveBlock{ size, stack_id, timestamp };
+    }
+
+    // is_freed false when an allocation replaced the block. (its free was not traced) lifetime is not counted then.
+    void remove_block(ReplayState& state, const memtracer::AllocationSampler& allocation_sampler, uint64_t address, uint64_t timestamp, bool is_freed)
+    {
+        auto iterator = state.live_blocks_.find(address);
+
+        // allocated before start of the log.
+        if (iterator == state.live_blocks_.end())
+        {
+            return;
+        }
+
+        const LiveBlock& live_block = iterator->second;
+
+        const size_t block_size = static_cast<size_t>(live_block.size_);
+
+        const bool is_sampled = allocation_sampler.is_enabled();
+
+        const size_t estimated_size = is_sampled == true ? allocation_sampler.get_estimated_size(block_size) : block_size;
+
+        const size_t estimated_count = is_sampled == true ? allocation_sampler.get_estimated_count(block_size) : 1;
+
+        state.stack_statistics_[live_block.stack_id_].memory_allocation_ -= estimated_size;
+
+        state.stack_statistics_[live_block.stack_id_].memory_allocation_count_ -= estimated_count;
+
+        const unsigned int size_class = memtracer::get_size_class(block_size);
+
+        state.stack_size_classes_[live_block.stack_id_].live_counts_[size_class] -= estimated_count;
+
+        state.size_class_statistics_.live_memory_allocations_[size_class] -= estimated_size;
+
+        state.size_class_statistics_.live_counts_[size_class] -= estimated_count;
+
+        state.memory_allocation_ -= estimated_size;
+
+        if (is_freed == true)
+        {
+            const uint64_t lifetime = timestamp > live_block.timestamp_ ? timestamp - live_block.timestamp_ : 0;
+
+            state.stack_lifetimes_[live_block.stack_id_].lifetime_buckets_[memtracer::get_lifetime_bucket(lifetime)]++;
+        }
+
+        state.live_blocks_.erase(iterator);
+    }
+
+    // applies events up to timestamp. returns false when a block of the log is broken.
+    // estimates of sampled logs are fixed point, as tracer threads add them. totals are rounded at the end.
+    bool replay_events(const memtracer::EventLogFile& event_log_file, uint64_t timestamp, ReplayState& state)
+    {
+        memtracer::AllocationSampler allocation_sampler;
+
+        allocation_sampler.set_sampling_interval(static_cast<size_t>(event_log_file.get_header().sampling_interval_));
+
+        const bool is_valid = event_log_file.read_events([&state, &allocation_sampler, timestamp](const memtracer::EventLogEvent& event)
+            {
+                if (event.timestamp_ > timestamp)
+                {
+                    return false;
+                }
+
+                switch (event.event_type_)
+                {
+                case memtracer::EVENT_LOG_ALLOCATE:
+                    remove_block(state, allocation_sampler, event.address_, event.timestamp_, false);
+
+                    add_block(state, allocation_sampler, event.address_, event.size_, event.stack_id_, event.timestamp_);
+                    break;
+                case memtracer::EVENT_LOG_FREE:
+                    remove_block(state, allocation_sampler, event.address_, event.timestamp_, true);
+                    break;
+                case memtracer::EVENT_LOG_REALLOCATE:
+                    remove_block(state, allocation_sampler, event.previous_address_, event.timestamp_, true);
+
+                    remove_block(state, allocation_sampler, event.address_, event.timestamp_, false);
+
+                    add_block(state, allocation_sampler, event.address_, event.size_, event.stack_id_, event.timestamp_);
+                    break;
+                }
+
+                state.applied_event_count_++;
+
+                return true;
+            });
+
+        // stacks and size classes are rounded by SnapshotRequest::merge_snapshot_stacks.
+        if (allocation_sampler.is_enabled() == true)
+        {
+            state.memory_allocation_ = memtracer::round_estimate(state.memory_allocation_);
+
+            state.peak_memory_allocation_ = memtracer::round_estimate(state.peak_memory_allocation_);
+        }
+
+        return is_valid;
+    }
+
+    void* get_pointer(uint64_t address)
+    {
+        return reinterpret_cast<void*>(static_cast<uintptr_t>(address));
+    }
+
+    // snapshot of replayed state, written like a Full snapshot of the tracer. stacks and symbols come from the log.
+    bool write_snapshot(const memtracer::EventLogFile& event_log_file, const ReplayState& state, uint64_t timestamp, const tstring& output_path)
+    {
+        memtracer::StackTable stack_table;
+
+        memtracer::SymbolCache symbol_cache;
+
+        // recorded stack id to id of stack_table.
+        std::unordered_map<uint32_t, memtracer::StackId> stack_ids;
+
+        std::vector<void*> frames;
+
+        for (const memtracer::EventLogStack& stack : event_log_file.get_stacks())
+        {
+            frames.clear();
+
+            for (uint64_t frame : stack.frames_)
+            {
+                frames.push_back(get_pointer(frame));
+
+                const memtracer::EventLogFrame* event_log_frame = event_log_file.find_frame(frame);
+
+                if (event_log_frame == nullptr)
+                {
+                    symbol_cache.add_frame_symbol(get_pointer(frame), nullptr);
+
+                    continue;
+                }
+
+                memtracer::FrameSymbol frame_symbol;
+
+                frame_symbol.symbol_address_ = get_pointer(event_log_frame->symbol_address_);
+
+                frame_symbol.symbol_name_ = memtracer::convert_from_utf8(event_log_frame->symbol_name_);
+
+                frame_symbol.file_name_ = memtracer::convert_from_utf8(event_log_frame->file_name_);
+
+                frame_symbol.line_number_ = event_log_frame->line_number_;
+
+                frame_symbol.has_line_ = (event_log_frame->flags_ & memtracer::SNAPSHOT_FILE_FRAME_HAS_LINE) != 0;
+
+                symbol_cache.add_frame_symbol(get_pointer(frame), &frame_symbol);
+            }
+
+            // overflow stack has no frames and keeps its id.
+            if (frames.empty() == true)
+            {
+                stack_ids[stack.stack_id_] = memtracer::StackTable::OVERFLOW_STACK_ID;
+
+                continue;
+            }
+
+            memtracer::StackBackTrace stack_back_trace;
+
+            stack_back_trace.assign(frames.data(), static_cast<memtracer::FrameCount>(frames.size()), 64);
+
+            stack_ids[stack.stack_id_] = stack_table.intern(stack_back_trace);
+        }
+
+        memtracer::SnapshotRequest snapshot_request;
+
+        snapshot_request.snapshot_type_ = memtracer::ESnapshotType::Full;
+
+        snapshot_request.sampling_interval_ = static_cast<size_t>(event_log_file.get_header().sampling_interval_);
+
+        snapshot_request.traced_time_ = timestamp;
+
+        snapshot_request.size_class_statistics_ = state.size_class_statistics_;
+
+        for (size_t stack_id = 0; stack_id < state.stack_statistics_.size(); stack_id++)
+        {
+            const memtracer::StackStatistics& stack_statistics = state.stack_statistics_[stack_id];
+
+            if (stack_statistics.memory_allocation_count_ == 0 && state.stack_lifetimes_[stack_id].total_allocation_count_ == 0)
+            {
+                continue;
+            }
+
+            auto iterator = stack_ids.find(static_cast<uint32_t>(stack_id));
+
+            memtracer::SnapshotStack snapshot_stack;
+
+            snapshot_stack.stack_id_ = iterator != stack_ids.end() ? iterator->second : memtracer::StackTable::OVERFLOW_STACK_ID;
+
+            snapshot_stack.stack_statistics_ = stack_statistics;
+
+            // no previous snapshot, so all of it is growth.
+            snapshot_stack.memory_allocation_delta_ = static_cast<long long>(stack_statistics.memory_allocation_);
+
+            snapshot_stack.memory_allocation_count_delta_ = static_cast<long long>(stack_statistics.memory_allocation_count_);
+
+            snapshot_stack.stack_lifetime_ = state.stack_lifetimes_[stack_id];
+
+            snapshot_stack.stack_size_classes_ = state.stack_size_classes_[stack_id];
+
+            snapshot_request.snapshot_stacks_.push_back(snapshot_stack);
+        }
+
+        // stacks of a full StackTable are merged into overflow stack.
+        snapshot_request.merge_snapshot_stacks();
+
+        return memtracer::write_snapshot_file(output_path.c_str(), snapshot_request, stack_table, symbol_cache);
+    }
+
+    // live blocks by address, then their stacks outermost frame first.
+    bool write_live_blocks(const memtracer::EventLogFile& event_log_file, const ReplayState& state, uint64_t timestamp, memtracer::FileWriter& file_writer)
+    {
+        constexpr size_t buffer_size = 1024;
+
+        char buffer[buffer_size] = { 0 };
+
+        const auto write_line = [&file_writer, &buffer](int length)
+            {
+                file_writer.write(buffer, static_cast<size_t>((std::min)(std::max(length, 0), static_cast<int>(buffer_size) - 1)));
+            };
+
+        std::vector<std::pair<uint64_t, LiveBlock>> live_blocks(state.live_blocks_.begin(), state.live_blocks_.end());
+
+        std::sort(live_blocks.begin(), live_blocks.end(), [](const std::pair<uint64_t, LiveBlock>& first, const std::pair<uint64_t, LiveBlock>& second)
+            {
+                return first.first < second.first;
+            });
+
+        write_line(std::snprintf(buffer, buffer_size, "Live blocks at %.3f ms : %zu blocks, %.2f MB. Peak %.2f MB.\r\n"
+            , static_cast<double>(timestamp) / 1000000.0, live_blocks.size()
+            , static_cast<double>(state.memory_allocation_) / 1024.0 / 1024.0, static_cast<double>(state.peak_memory_allocation_) / 1024.0 / 1024.0));
+
+        if (event_log_file.get_header().sampling_interval_ != 0)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "Sampled every %llu bytes on average. Blocks are sampled ones, totals are estimates.\r\n"
+                , static_cast<unsigned long long>(event_log_file.get_header().sampling_interval_)));
+        }
+
+        write_line(std::snprintf(buffer, buffer_size, "\r\naddress, size, age (ms), stack\r\n"));
+
+        std::vector<bool> is_stack_used;
+
+        for (const std::pair<uint64_t, LiveBlock>& live_block : live_blocks)
+        {
+            write_line(std::snprintf(buffer, buffer_size, "%p, %llu, %.3f, %u\r\n"
+                , get_pointer(live_block.first), static_cast<unsigned long long>(live_block.second.size_)
+                , static_cast<double>(timestamp - live_block.second.timestamp_) / 1000000.0, live_block.second.stack_id_));
+
+            if (live_block.second.stack_id_ >= is_stack_used.size())
+            {
+                is_stack_used.resize(static_cast<size_t>(live_block.second.stack_id_) + 1, false);
+            }
+
+            is_stack_used[live_block.second.stack_id_] = true;
+        }
+
+        for (const memtracer::EventLogStack& stack : event_log_file.get_stacks())
+        {
+            if (stack.stack_id_ >= is_stack_used.size() || is_stack_used[stack.stack_id_] == false)
+            {
+                continue;
+            }
+
+            write_line(std::snprintf(buffer, buffer_size, "\r\nStack %u\r\n", stack.stack_id_));
+
+            if (stack.frames_.empty() == true)
+            {
+                write_line(std::snprintf(buffer, buffer_size, "Call stack is not recorded.\r\n"));
+
+                continue;
+            }
+
+            for (size_t i = stack.frames_.size(); i > 0; i--)
+            {
+                const memtracer::EventLogFrame* frame = event_log_file.find_frame(stack.frames_[i - 1]);
+
+                if (frame == nullptr)
+                {
+                    write_line(std::snprintf(buffer, buffer_size, "%p : Failed to get symbol info.\r\n", get_pointer(stack.frames_[i - 1])));
+                }
+                else if ((frame->flags_ & memtracer::SNAPSHOT_FILE_FRAME_HAS_LINE) != 0)
+                {
+                    write_line(std::snprintf(buffer, buffer_size, "%p - %s : %s (%u)\r\n"
+                        , get_pointer(frame->symbol_address_), frame->symbol_name_.c_str(), frame->file_name_.c_str(), frame->line_number_));
+                }
+                else
+                {
+                    write_line(std::snprintf(buffer, buffer_size, "%p - %s : Failed to get file info.\r\n", get_pointer(frame->symbol_address_), frame->symbol_name_.c_str()));
+                }
+            }
+        }
+
+        return file_writer.close();
+    }
+}
+
+// usage : replay <event log> [snapshot | live] [time ms] [output file]
+// time is from start of trace, end of log by default. output file is <event log>.mtsnap or .live.txt by default.
+#if defined(_WIN32) && defined(_UNICODE)
+int wmain(int argc, wchar_t* argv[])
+#else
+int main(int argc, char* argv[])
+#endif
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage : replay <event log> [snapshot | live] [time ms] [output file]" << std::endl;
+
+        return 1;
+    }
+
+    const tstring event_log_path = argv[1];
+
+    const tstring mode = argc > 2 ? argv[2] : TEXT("snapshot");
+
+    if (mode != TEXT("snapshot") && mode != TEXT("live"))
+    {
+        std::cerr << "Unknown replay mode." << std::endl;
+
+        return 1;
+    }
+
+    memtracer::EventLogFile event_log_file;
+
+    if (event_log_file.open(event_log_path.c_str()) == false)
+    {
+        std::cerr << "Failed to open event log." << std::endl;
+
+        return 1;
+    }
+
+    uint64_t timestamp = event_log_file.get_end_timestamp();
+
+    if (argc > 3 && tstring(argv[3]) != TEXT("end"))
+    {
+        const std::string time = memtracer::convert_to_utf8(argv[3]);
+
+        char* end = nullptr;
+
+        const double milliseconds = std::strtod(time.c_str(), &end);
+
+        if (end == time.c_str() || *end != '\0' || milliseconds < 0.0)
+        {
+            std::cerr << "Time must be milliseconds from start of trace." << std::endl;
+
+            return 1;
+        }
+
+        timestamp = static_cast<uint64_t>(milliseconds * 1000000.0);
+    }
+
+    if (event_log_file.is_complete() == false)
+    {
+        std::cerr << "Event log was not closed. Events up to its last whole block are replayed." << std::endl;
+    }
+
+    ReplayState state = {};
+
+    if (replay_events(event_log_file, timestamp, state) == false)
+    {
+        std::cerr << "Event log is broken. Events before the broken block are replayed." << std::endl;
+    }
+
+    std::fprintf(stderr, "%llu of %llu events replayed to %.3f ms. %zu live blocks, %.2f MB.\n"
+        , static_cast<unsigned long long>(state.applied_event_count_), static_cast<unsigned long long>(event_log_file.get_event_count())
+        , static_cast<double>(timestamp) / 1000000.0, state.live_blocks_.size(), static_cast<double>(state.memory_allocation_) / 1024.0 / 1024.0);
+
+    const tstring output_path = argc > 4 ? argv[4] : event_log_path + (mode == TEXT("live") ? TEXT(".live.txt") : TEXT(".mtsnap"));
+
+    bool is_written = false;
+
+    if (mode == TEXT("live"))
+    {
+        memtracer::FileWriter file_writer;
+
+        if (file_writer.open(output_path.c_str()) == false)
+        {
+            std::cerr << "Failed to create output file." << std::endl;
+
+            return 1;
+        }
+
+        is_written = write_live_blocks(event_log_file, state, timestamp, file_writer);
+    }
+    else
+    {
+        is_written = write_snapshot(event_log_file, state, timestamp, output_path);
+    }
+
+    if (is_written == false)
+    {
+        std::cerr << "Failed to write output file." << std::endl;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,15 +1,12 @@
+#include <chrono>
 #include <iostream>
-#include "..\\memtracer\\include\\memory_tracer.h"
+#include <thread>
+#include "../memtracer/include/memory_tracer_operators.h"
 
-void* operator new(size_t size)
+struct alignas(64) AlignedTestClass
 {
-    return memtracer::MemoryTracer<>::get_instance()->add_allocation(size);
-}
-
-void operator delete(void* p)
-{
-	memtracer::MemoryTracer<>::get_instance()->remove_allocation(p);
-}
+    char bytes[100];
+};
 
 class TestClass
 {
@@ -30,22 +27,430 @@ public:
     }
 };
 
+// keeps compiler from eliding new / delete pairs.
+void* volatile sink = nullptr;
+
 void ThreadTest()
 {
     std::cout << "Thread Test Function" << std::endl;
 }
 
+// frees of one site after a snapshot are negative deltas of that site in next diff.
+bool TestDiffSnapshot()
+{
+    using DiffTracer = memtracer::MemoryTracer<memtracer::TracerPolicy<16>>;
+
+    constexpr size_t block_count = 1000;
+
+    constexpr size_t block_size = 48;
+
+    DiffTracer* tracer = DiffTracer::get_instance();
+
+    tracer->set_report_path(TEXT("MemoryTracer_DiffReport"));
+
+    tracer->start();
+
+    std::vector<void*> blocks(block_count);
+
+    for (void*& block : blocks)
+    {
+        block = tracer->add_allocation(block_size);
+    }
+
+    // #0
+    const bool is_snapshot_taken = tracer->take_snapshot().get();
+
+    for (void* block : blocks)
+    {
+        tracer->remove_allocation(block);
+    }
+
+    // #1
+    const bool is_diff_taken = tracer->take_diff_snapshot().get();
+
+    tracer->stop();
+
+    memtracer::SnapshotFile snapshot_file;
+
+    if (is_snapshot_taken == false || is_diff_taken == false ||
+        snapshot_file.open(TEXT("MemoryTracer_DiffReport") PATH_SEPARATOR TEXT("MemoryTracer_Report #1.mtsnap")) == false ||
+        snapshot_file.get_header().snapshot_type_ != memtracer::SNAPSHOT_FILE_TYPE_DIFF)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < snapshot_file.get_header().stack_count_; i++)
+    {
+        const memtracer::SnapshotFileStack& stack = snapshot_file.get_stack(i);
+
+        if (stack.memory_allocation_count_delta_ == -static_cast<int64_t>(block_count))
+        {
+            return stack.memory_allocation_count_ == 0 && stack.memory_allocation_delta_ == -static_cast<int64_t>(block_count * block_size);
+        }
+    }
+
+    return false;
+}
+
+// allocates blocks from one site and frees half of them. live blocks are returned to be freed before stop.
+template <typename Tracer>
+std::vector<void*> RunShardWorkload(Tracer* tracer)
+{
+    std::vector<void*> blocks;
+
+    for (size_t i = 0; i < 4000; i++)
+    {
+        blocks.push_back(tracer->add_allocation(16 + i % 64));
+    }
+
+    std::vector<void*> live_blocks;
+
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        if (i % 2 == 0)
+        {
+            tracer->remove_allocation(blocks[i]);
+        }
+        else
+        {
+            live_blocks.push_back(blocks[i]);
+        }
+    }
+
+    return live_blocks;
+}
+
+// frees are applied by tracer threads, so live count reaches workload's after a while.
+template <typename Tracer>
+bool WaitForLiveCount(Tracer* tracer, size_t count)
+{
+    for (int i = 0; i < 500; i++)
+    {
+        if (tracer->get_totals().memory_allocation_count_ == count)
+        {
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+// totals and sites merged from several tracer threads are the same as one tracer thread's.
+bool TestShardedTotals()
+{
+    using SingleTracer = memtracer::MemoryTracer<memtracer::TracerPolicy<20, 2, 64, false>>;
+
+    using ShardedTracer = memtracer::MemoryTracer<memtracer::TracerPolicy<21, 2, 64, false>>;
+
+    SingleTracer* single_tracer = SingleTracer::get_instance();
+
+    ShardedTracer* sharded_tracer = ShardedTracer::get_instance();
+
+    single_tracer->set_tracer_thread_count(1);
+
+    sharded_tracer->set_tracer_thread_count(4);
+
+    single_tracer->start();
+
+    sharded_tracer->start();
+
+    const std::vector<void*> single_blocks = RunShardWorkload(single_tracer);
+
+    const std::vector<void*> sharded_blocks = RunShardWorkload(sharded_tracer);
+
+    const bool is_applied = WaitForLiveCount(single_tracer, single_blocks.size()) == true && WaitForLiveCount(sharded_tracer, sharded_blocks.size()) == true;
+
+    const memtracer::MemoryTotals single_totals = single_tracer->get_totals();
+
+    const memtracer::MemoryTotals sharded_totals = sharded_tracer->get_totals();
+
+    const std::vector<memtracer::SiteStatistics> single_sites = single_tracer->query_top_sites(1, memtracer::ESiteSortKey::LiveBytes);
+
+    const std::vector<memtracer::SiteStatistics> sharded_sites = sharded_tracer->query_top_sites(1, memtracer::ESiteSortKey::LiveBytes);
+
+    for (void* block : single_blocks)
+    {
+        single_tracer->remove_allocation(block);
+    }
+
+    for (void* block : sharded_blocks)
+    {
+        sharded_tracer->remove_allocation(block);
+    }
+
+    single_tracer->stop();
+
+    sharded_tracer->stop();
+
+    if (is_applied == false || single_sites.empty() == true || sharded_sites.empty() == true)
+    {
+        return false;
+    }
+
+    // sum of shard peaks is an upper bound with several tracer threads.
+    return sharded_totals.memory_allocation_ == single_totals.memory_allocation_ &&
+        sharded_totals.total_memory_allocation_ == single_totals.total_memory_allocation_ &&
+        sharded_totals.total_allocation_count_ == single_totals.total_allocation_count_ &&
+        sharded_totals.peak_memory_allocation_upper_bound_ >= single_totals.peak_memory_allocation_upper_bound_ &&
+        sharded_sites[0].memory_allocation_ == single_sites[0].memory_allocation_ &&
+        sharded_sites[0].memory_allocation_count_ == single_sites[0].memory_allocation_count_ &&
+        sharded_sites[0].total_memory_allocation_ == single_sites[0].total_memory_allocation_;
+}
+
+// allocates in bursts larger than a ring until tracer thread falls behind.
+template <typename Tracer>
+memtracer::BufferStatistics FillEventRing(Tracer* tracer, memtracer::EBufferPolicy buffer_policy)
+{
+    tracer->set_buffer_policy(buffer_policy);
+
+    tracer->start();
+
+    std::vector<void*> blocks;
+
+    blocks.reserve(memtracer::EVENT_RING_CAPACITY * 4 * 100);
+
+    memtracer::BufferStatistics buffer_statistics = { 0, 0, 0 };
+
+    for (int i = 0; i < 100 && buffer_statistics.dropped_allocation_count_ == 0 && buffer_statistics.degraded_allocation_count_ == 0; i++)
+    {
+        for (size_t j = 0; j < memtracer::EVENT_RING_CAPACITY * 4; j++)
+        {
+            blocks.push_back(tracer->add_allocation(16));
+        }
+
+        buffer_statistics = tracer->get_tracer_statistics().buffer_statistics_;
+    }
+
+    for (void* block : blocks)
+    {
+        tracer->remove_allocation(block);
+    }
+
+    tracer->stop();
+
+    return buffer_statistics;
+}
+
+// full ring is counted by drop policy, and ring above degrade count by degrade policy.
+bool TestBufferPolicy()
+{
+    using DropTracer = memtracer::MemoryTracer<memtracer::TracerPolicy<24, 2, 64, false, false>>;
+
+    using DegradeTracer = memtracer::MemoryTracer<memtracer::TracerPolicy<25, 2, 64, false>>;
+
+    const memtracer::BufferStatistics drop_statistics = FillEventRing(DropTracer::get_instance(), memtracer::EBufferPolicy::DropAndCount);
+
+    const memtracer::BufferStatistics degrade_statistics = FillEventRing(DegradeTracer::get_instance(), memtracer::EBufferPolicy::Degrade);
+
+    return drop_statistics.dropped_allocation_count_ != 0 && degrade_statistics.degraded_allocation_count_ != 0 && degrade_statistics.dropped_allocation_count_ == 0;
+}
+
+// reports of trigger test, which are more than the test takes.
+constexpr size_t TRIGGER_REPORT_CHECK_COUNT = 1024;
+
+void GetTriggerReportPath(TCHAR* snapshot_path, size_t index)
+{
+    stprintf_s(snapshot_path, MAX_PATH, TEXT("%s%sMemoryTracer_Report #%llu.mtsnap"), TEXT("MemoryTracer_TriggerReport"), PATH_SEPARATOR, static_cast<unsigned long long>(index));
+}
+
+// interval trigger takes reports, and only last max_report_count_ of them are kept with the program's one.
+bool TestReportRetention()
+{
+    using TriggerTracer = memtracer::MemoryTracer<memtracer::TracerPolicy<28, 2, 64, false>>;
+
+    TCHAR snapshot_path[MAX_PATH] = { 0 };
+
+    // reports of previous runs.
+    for (size_t i = 0; i < TRIGGER_REPORT_CHECK_COUNT; i++)
+    {
+        GetTriggerReportPath(snapshot_path, i);
+
+        memtracer::delete_file(snapshot_path);
+    }
+
+    memtracer::SnapshotTriggers snapshot_triggers = { 0, 0, false, 0, 0, 0 };
+
+    snapshot_triggers.interval_milliseconds_ = 10;
+
+    snapshot_triggers.max_report_count_ = 3;
+
+    TriggerTracer* tracer = TriggerTracer::get_instance();
+
+    tracer->set_report_path(TEXT("MemoryTracer_TriggerReport"));
+
+    tracer->set_snapshot_triggers(snapshot_triggers);
+
+    tracer->start();
+
+    const bool is_snapshot_taken = tracer->take_snapshot().get();
+
+    // about 20 intervals. retention needs more than 3 of them.
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    tracer->stop();
+
+    if (is_snapshot_taken == false)
+    {
+        return false;
+    }
+
+    size_t manual_report_count = 0;
+
+    size_t manual_report_index = 0;
+
+    std::vector<size_t> automatic_report_indices;
+
+    size_t last_index = 0;
+
+    for (size_t i = 0; i < TRIGGER_REPORT_CHECK_COUNT; i++)
+    {
+        GetTriggerReportPath(snapshot_path, i);
+
+        memtracer::SnapshotFile snapshot_file;
+
+        if (snapshot_file.open(snapshot_path) == false)
+        {
+            continue;
+        }
+
+        if (snapshot_file.get_header().trigger_ == memtracer::SNAPSHOT_FILE_TRIGGER_NONE)
+        {
+            manual_report_count++;
+
+            manual_report_index = i;
+        }
+        else
+        {
+            automatic_report_indices.push_back(i);
+        }
+
+        last_index = i;
+    }
+
+    // more reports than max_report_count_ are taken.
+    if (manual_report_count != 1 || automatic_report_indices.size() != 3 || last_index < 4)
+    {
+        return false;
+    }
+
+    // kept automatic reports are the last ones, so no report is missing after first kept one.
+    const size_t first_index = automatic_report_indices[0];
+
+    const size_t kept_count = automatic_report_indices.size() + (manual_report_index > first_index ? 1 : 0);
+
+    return last_index - first_index + 1 == kept_count;
+}
+
 int main()
 {
+    memtracer::MemoryTracer<>::get_instance()->set_event_log_path(TEXT("MemoryTracer_Events.mtlog"));
+
     memtracer::MemoryTracer<>::get_instance()->start();
 
     TestClass* a = new TestClass();
 
+    sink = a;
+
     memtracer::MemoryTracer<>::get_instance()->take_snapshot();
 
+    const std::vector<memtracer::SiteStatistics> top_sites = memtracer::MemoryTracer<>::get_instance()->query_top_sites(1, memtracer::ESiteSortKey::LiveBytes);
+
+    if (top_sites.empty() == true || top_sites[0].memory_allocation_ == 0)
+    {
+        std::cout << "Live allocation is not queried." << std::endl;
+
+        return 1;
+    }
+
+    const size_t total_allocation_count = memtracer::MemoryTracer<>::get_instance()->get_totals().total_allocation_count_;
+
+    AlignedTestClass* aligned = new AlignedTestClass();
+
+    sink = aligned;
+
+    if (reinterpret_cast<uintptr_t>(aligned) % alignof(AlignedTestClass) != 0 ||
+        memtracer::MemoryTracer<>::get_instance()->get_totals().total_allocation_count_ != total_allocation_count + 1)
+    {
+        std::cout << "Aligned allocation is not traced." << std::endl;
+
+        return 1;
+    }
+
+    delete aligned;
+
+    char* block = static_cast<char*>(memtracer::traced_calloc(4, 8));
+
+    block[31] = 'a';
+
+    block = static_cast<char*>(memtracer::traced_realloc(block, 4096));
+
+    if (block == nullptr || block[0] != 0 || block[31] != 'a')
+    {
+        std::cout << "Reallocated block is wrong." << std::endl;
+
+        return 1;
+    }
+
+    memtracer::traced_free(block);
+
+    const memtracer::ArenaStatistics arena_statistics = memtracer::MemoryTracer<>::get_instance()->get_tracer_statistics().arena_statistics_;
+
+    if (arena_statistics.used_memory_ == 0 || arena_statistics.used_memory_ > arena_statistics.mapped_memory_)
+    {
+        std::cout << "Tracer memory is not reported." << std::endl;
+
+        return 1;
+    }
+
     delete a;
 
+    if (memtracer::MemoryTracer<>::get_instance()->take_leak_snapshot().get() == false)
+    {
+        std::cout << "Leak snapshot is failed." << std::endl;
+
+        return 1;
+    }
+
     memtracer::MemoryTracer<>::get_instance()->take_snapshot();
 
     memtracer::MemoryTracer<>::get_instance()->stop();
+
+    memtracer::EventLogFile event_log_file;
+
+    if (event_log_file.open(TEXT("MemoryTracer_Events.mtlog")) == false || event_log_file.is_complete() == false || event_log_file.get_event_count() == 0)
+    {
+        std::cout << "Event log is not written." << std::endl;
+
+        return 1;
+    }
+
+    if (TestDiffSnapshot() == false)
+    {
+        std::cout << "Diff snapshot doesn't have frees of the site." << std::endl;
+
+        return 1;
+    }
+
+    if (TestShardedTotals() == false)
+    {
+        std::cout << "Totals of several tracer threads are different from one tracer thread's." << std::endl;
+
+        return 1;
+    }
+
+    if (TestBufferPolicy() == false)
+    {
+        std::cout << "Full event ring is not counted." << std::endl;
+
+        return 1;
+    }
+
+    if (TestReportRetention() == false)
+    {
+        std::cout << "Automatic reports are not retained." << std::endl;
+
+        return 1;
+    }
 }